@@ -51,6 +51,10 @@ public:
      */
   }
 
+  virtual void prefetchResources() {
+    oria::prefetchSceneResources();
+  }
+
   virtual GLFWwindow * createRenderingTarget(glm::uvec2 & outSize, glm::ivec2 & outPosition) {
     /*
     * In the Direct3D examples in the Oculus SDK, they make the point that the
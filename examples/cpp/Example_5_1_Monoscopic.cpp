@@ -15,6 +15,10 @@ public:
       Vectors::UP);
   }
 
+  virtual void prefetchResources() {
+    oria::prefetchSceneResources();
+  }
+
   virtual GLFWwindow * createRenderingTarget(glm::uvec2 & outSize, glm::ivec2 & outPosition) {
     outSize = WINDOW_SIZE;
     outPosition = WINDOW_POS;
@@ -37,6 +37,10 @@ public:
     };
   }
 
+  virtual void prefetchResources() {
+    oria::prefetchSceneResources();
+  }
+
   virtual GLFWwindow * createRenderingTarget(glm::uvec2 & outSize, glm::ivec2 & outPosition) {
     outSize = WINDOW_SIZE;
     outPosition = WINDOW_POS;
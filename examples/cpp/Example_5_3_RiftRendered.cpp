@@ -15,6 +15,10 @@ public:
       Vectors::UP);
   }
 
+  virtual void prefetchResources() {
+    oria::prefetchSceneResources();
+  }
+
   virtual void initGl() {
     GlfwApp::initGl();
 
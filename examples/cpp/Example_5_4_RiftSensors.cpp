@@ -19,6 +19,10 @@ public:
     }
   }
 
+  virtual void prefetchResources() {
+    oria::prefetchSceneResources();
+  }
+
   virtual void initGl() {
     GlfwApp::initGl();
 
@@ -51,6 +51,10 @@ public:
     glfwDestroyWindow(renderWindow);
   }
 
+  void prefetchResources() {
+    oria::prefetchSceneResources();
+  }
+
   void initGl() {
     RiftGlfwApp::initGl();
 
@@ -55,6 +55,10 @@ public:
   }
 
 
+  void prefetchResources() {
+    oria::prefetchSceneResources();
+  }
+
   void renderScene() {
     int currentEye = getCurrentEye();
     ovrTexture & eyeTex = eyeTextures[currentEye];
@@ -0,0 +1,196 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "AtlasPacker.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace oria {
+
+  static uint32_t alignUp(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  AtlasPacker::AtlasPacker(uint32_t width, uint32_t height, uint32_t gutter)
+    : width(width), height(height), gutter(gutter) {
+    reset();
+  }
+
+  void AtlasPacker::reset() {
+    skyline.clear();
+    Segment first = { 0, 0, width };
+    skyline.push_back(first);
+    used = 0;
+  }
+
+  // Finds how high a rectangle starting at the given segment would have to
+  // sit to clear every segment under it
+  bool AtlasPacker::fits(size_t index, uint32_t w, uint32_t h, uint32_t & outY) const {
+    if (skyline[index].x + w > width) {
+      return false;
+    }
+    uint32_t y = 0;
+    uint32_t remaining = w;
+    for (size_t i = index; remaining > 0; ++i) {
+      if (i == skyline.size()) {
+        return false;
+      }
+      y = std::max(y, skyline[i].y);
+      if (y + h > height) {
+        return false;
+      }
+      remaining -= std::min(remaining, skyline[i].width);
+    }
+    outY = y;
+    return true;
+  }
+
+  bool AtlasPacker::insert(uint32_t w, uint32_t h, AtlasRect & out) {
+    uint32_t alignment = std::max(gutter, 1u);
+    uint32_t reservedWidth = alignUp(w + 2 * gutter, alignment);
+    uint32_t reservedHeight = alignUp(h + 2 * gutter, alignment);
+
+    size_t best = skyline.size();
+    uint32_t bestY = 0;
+    uint32_t bestTop = UINT32_MAX;
+    uint32_t bestWidth = UINT32_MAX;
+    for (size_t i = 0; i < skyline.size(); ++i) {
+      uint32_t y;
+      if (!fits(i, reservedWidth, reservedHeight, y)) {
+        continue;
+      }
+      uint32_t top = y + reservedHeight;
+      if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth)) {
+        best = i;
+        bestY = y;
+        bestTop = top;
+        bestWidth = skyline[i].width;
+      }
+    }
+    if (best == skyline.size()) {
+      return false;
+    }
+
+    Segment placed = { skyline[best].x, bestTop, reservedWidth };
+    skyline.insert(skyline.begin() + best, placed);
+
+    // Cut away whatever the new segment now covers
+    uint32_t end = placed.x + placed.width;
+    for (size_t i = best + 1; i < skyline.size();) {
+      Segment & segment = skyline[i];
+      if (segment.x >= end) {
+        break;
+      }
+      uint32_t overlap = end - segment.x;
+      if (segment.width <= overlap) {
+        skyline.erase(skyline.begin() + i);
+        continue;
+      }
+      segment.x += overlap;
+      segment.width -= overlap;
+      break;
+    }
+
+    // Merge neighbours left at the same height
+    for (size_t i = 0; i + 1 < skyline.size();) {
+      if (skyline[i].y == skyline[i + 1].y) {
+        skyline[i].width += skyline[i + 1].width;
+        skyline.erase(skyline.begin() + i + 1);
+      } else {
+        ++i;
+      }
+    }
+
+    used += (size_t)reservedWidth * reservedHeight;
+    out.x = placed.x + gutter;
+    out.y = bestY + gutter;
+    out.width = w;
+    out.height = h;
+    return true;
+  }
+
+  float AtlasPacker::occupancy() const {
+    return (float)used / ((float)width * (float)height);
+  }
+
+  int packAtlas(const std::vector<AtlasRect> & sizes, uint32_t pageSize, uint32_t gutter,
+      std::vector<AtlasPlacement> & out) {
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      uint32_t sideA = std::max(sizes[a].width, sizes[a].height);
+      uint32_t sideB = std::max(sizes[b].width, sizes[b].height);
+      if (sideA != sideB) {
+        return sideA > sideB;
+      }
+      return sizes[a].width * sizes[a].height > sizes[b].width * sizes[b].height;
+    });
+
+    out.assign(sizes.size(), AtlasPlacement());
+    std::vector<AtlasPacker> pages;
+    for (size_t i = 0; i < order.size(); ++i) {
+      const AtlasRect & size = sizes[order[i]];
+      AtlasPlacement & placement = out[order[i]];
+      for (size_t page = 0; page < pages.size(); ++page) {
+        if (pages[page].insert(size.width, size.height, placement.rect)) {
+          placement.page = (int)page;
+          break;
+        }
+      }
+      if (placement.page < 0) {
+        AtlasPacker fresh(pageSize, pageSize, gutter);
+        if (fresh.insert(size.width, size.height, placement.rect)) {
+          placement.page = (int)pages.size();
+          pages.push_back(fresh);
+        }
+      }
+    }
+    return (int)pages.size();
+  }
+
+  void fillGutter(uint8_t * atlas, size_t stride, const AtlasRect & rect, uint32_t gutter) {
+    if (!gutter || !rect.width || !rect.height) {
+      return;
+    }
+    // Out to the sides, one texel at a time along each row
+    for (uint32_t y = rect.y; y < rect.y + rect.height; ++y) {
+      uint32_t * row = reinterpret_cast<uint32_t *>(atlas + y * stride);
+      uint32_t left = row[rect.x];
+      uint32_t right = row[rect.x + rect.width - 1];
+      for (uint32_t i = 1; i <= gutter; ++i) {
+        row[rect.x - i] = left;
+        row[rect.x + rect.width - 1 + i] = right;
+      }
+    }
+    // Then the first and last rows, now including their side gutters,
+    // out above and below, which fills the corners too
+    size_t x = rect.x - gutter;
+    size_t rowBytes = (rect.width + 2 * gutter) * 4;
+    const uint8_t * first = atlas + rect.y * stride + x * 4;
+    const uint8_t * last = atlas + (rect.y + rect.height - 1) * stride + x * 4;
+    for (uint32_t i = 1; i <= gutter; ++i) {
+      memcpy(atlas + (rect.y - i) * stride + x * 4, first, rowBytes);
+      memcpy(atlas + (rect.y + rect.height - 1 + i) * stride + x * 4, last, rowBytes);
+    }
+  }
+
+}
@@ -0,0 +1,93 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+// Pure CPU, so it includes only what it needs rather than Common.h, and
+// can be built and benchmarked on its own
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace oria {
+
+  struct AtlasRect {
+    uint32_t x{ 0 };
+    uint32_t y{ 0 };
+    uint32_t width{ 0 };
+    uint32_t height{ 0 };
+  };
+
+  /**
+   * Places rectangles into a fixed size page with the skyline bottom-left
+   * heuristic: the top edge of everything placed so far is kept as a list
+   * of horizontal segments, and each new rectangle goes wherever its top
+   * ends up lowest, preferring the tightest fit on ties.
+   *
+   * Every rectangle is surrounded by a gutter of the given width, and its
+   * reserved area is aligned to the gutter size.  With a gutter of 2^n,
+   * the first n + 1 mip levels of the page never mix texels from two
+   * images, provided the gutters are filled with fillGutter().
+   */
+  class AtlasPacker {
+    struct Segment {
+      uint32_t x;
+      uint32_t y;
+      uint32_t width;
+    };
+
+    std::vector<Segment> skyline;
+    uint32_t width;
+    uint32_t height;
+    uint32_t gutter;
+    size_t used{ 0 };
+
+    bool fits(size_t index, uint32_t w, uint32_t h, uint32_t & outY) const;
+
+  public:
+    AtlasPacker(uint32_t width, uint32_t height, uint32_t gutter = 0);
+
+    // Returns false, leaving the page untouched, if there's no room.  The
+    // rectangle returned excludes the gutter.
+    bool insert(uint32_t w, uint32_t h, AtlasRect & out);
+
+    // The fraction of the page reserved so far, gutters included
+    float occupancy() const;
+
+    void reset();
+  };
+
+  struct AtlasPlacement {
+    // -1 if the image is too big for a page even on its own
+    int page{ -1 };
+    AtlasRect rect;
+  };
+
+  // Packs a batch of sizes into as few pages as it can, biggest first,
+  // which packs far tighter than taking them in the order given.  Returns
+  // the number of pages used.
+  int packAtlas(const std::vector<AtlasRect> & sizes, uint32_t pageSize, uint32_t gutter,
+    std::vector<AtlasPlacement> & out);
+
+  // Copies the edge texels of an RGBA8 image already placed in the atlas
+  // out into its gutter, so filtering and mips near the edge see the image
+  // itself instead of its neighbours
+  void fillGutter(uint8_t * atlas, size_t stride, const AtlasRect & rect, uint32_t gutter);
+
+}
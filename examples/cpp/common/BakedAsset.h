@@ -0,0 +1,253 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+// This header is shared with the bake_assets tool, so it must not
+// depend on anything pulled in by Common.h
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Assets converted at build time into the form the GPU wants, so that
+ * loading one is a matter of pointing at the bytes and uploading them.
+ *
+ * A baked asset replaces the original file's contents, but keeps its path,
+ * so the Resource enum still finds it.  Loaders tell the two apart by the
+ * magic number at the start of the data.
+ *
+ * Layout (little endian):
+ *   header   : "ORBK", uint16 version, uint16 type, uint32 reserved x2
+ *   body     : a TextureHeader or MeshHeader, followed by the data it
+ *              references.  Offsets are from the start of the asset, and
+ *              aligned to DATA_ALIGNMENT bytes.
+ *
+ * Baked fonts keep the SDFF glyph table, but the embedded PNG atlas is
+ * replaced with a baked R8 or RG8 texture.
+ */
+class BakedAsset {
+public:
+  // "ORBK" read as a little endian integer
+  static const uint32_t MAGIC = 0x4B42524F;
+  static const uint16_t VERSION = 3;
+  static const uint32_t DATA_ALIGNMENT = 16;
+  static const uint32_t MAX_LEVELS = 16;
+  static const uint32_t MAX_LODS = 4;
+
+  enum Type {
+    TEXTURE = 1,
+    MESH = 2,
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    uint32_t reserved[2];
+  };
+
+  enum TextureFormat {
+    // Rows are bottom to top, as OpenGL expects them
+    RGBA8 = 1,
+    // Block compressed (see BlockCompression.h), with the rows of blocks
+    // also bottom to top
+    BC1 = 2,
+    BC3 = 3,
+    BC7 = 4,
+    // Uncompressed, one or two channels, for distance field font atlases
+    // (the distance, and the alpha if the atlas has any)
+    R8 = 5,
+    RG8 = 6,
+  };
+
+  struct Level {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  struct TextureHeader {
+    uint32_t format;
+    uint32_t levelCount;
+    uint32_t width;
+    uint32_t height;
+    Level levels[MAX_LEVELS];
+  };
+
+  enum MeshAttributes {
+    POSITION = 0x01,
+    NORMAL = 0x02,
+    TEXCOORD = 0x04,
+    MATERIAL = 0x08,
+  };
+
+  /**
+   * How the attributes of a vertex are stored.  Either way they're
+   * interleaved in the order position, normal, texture coordinate,
+   * material number, omitting any attribute not present.
+   */
+  enum VertexFormat {
+    // Floats: position (3), normal (3), texture coordinate (2), material
+    // number (1)
+    FLOAT_VERTICES = 0,
+    // Position as 3 half floats and 2 bytes of padding, normal as signed
+    // normalized 10-10-10-2, texture coordinate as 2 half floats, material
+    // number as a uint16 and 2 bytes of padding.  The vertex fetch expands
+    // all of them back to floats, so shaders don't need to change.
+    COMPACT_VERTICES = 1,
+  };
+
+  // A range of the indices, drawn instead of the whole mesh when it's far
+  // enough away that the simplification doesn't show
+  struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // Furthest a surface moved in simplification, in the mesh's units
+    float error;
+    uint32_t reserved;
+  };
+
+  /**
+   * Indices are triangles, uint16 if every vertex can be reached with
+   * them, otherwise uint32.  All the levels of detail share the vertices,
+   * and their indices follow each other, most detailed first.
+   */
+  struct MeshHeader {
+    uint32_t attributes;
+    uint32_t stride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    float sphere[4];
+    uint32_t vertexFormat;
+    // 2 or 4
+    uint32_t indexSize;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    // At least 1, the first being the full mesh
+    uint32_t lodCount;
+    uint32_t reserved;
+    MeshLod lods[MAX_LODS];
+  };
+
+  // Bytes per texel of the uncompressed formats, or zero for the block
+  // compressed ones
+  static uint32_t texelSize(uint32_t format) {
+    switch (format) {
+    case RGBA8:
+      return 4;
+    case RG8:
+      return 2;
+    case R8:
+      return 1;
+    }
+    return 0;
+  }
+
+  // Number of floats an attribute takes up in an interleaved vertex
+  static uint32_t attributeSize(uint32_t attribute) {
+    switch (attribute) {
+    case POSITION:
+    case NORMAL:
+      return 3;
+    case TEXCOORD:
+      return 2;
+    case MATERIAL:
+      return 1;
+    }
+    return 0;
+  }
+
+  // Offset in floats of the attribute within an interleaved vertex
+  static uint32_t attributeOffset(uint32_t attributes, uint32_t attribute) {
+    uint32_t offset = 0;
+    for (uint32_t bit = POSITION; bit < attribute; bit <<= 1) {
+      if (attributes & bit) {
+        offset += attributeSize(bit);
+      }
+    }
+    return offset;
+  }
+
+  // Bytes an attribute takes up in a vertex of the given format
+  static uint32_t attributeBytes(uint32_t format, uint32_t attribute) {
+    if (COMPACT_VERTICES != format) {
+      return attributeSize(attribute) * sizeof(float);
+    }
+    return POSITION == attribute ? 8 : 4;
+  }
+
+  // Offset in bytes of the attribute within a vertex of the given format.
+  // Passing an attribute past the last gives the stride.
+  static uint32_t attributeByteOffset(uint32_t format, uint32_t attributes, uint32_t attribute) {
+    uint32_t offset = 0;
+    for (uint32_t bit = POSITION; bit < attribute; bit <<= 1) {
+      if (attributes & bit) {
+        offset += attributeBytes(format, bit);
+      }
+    }
+    return offset;
+  }
+
+  static bool isBaked(const void * data, size_t size, Type type) {
+    if (size < sizeof(Header)) {
+      return false;
+    }
+    Header header;
+    memcpy(&header, data, sizeof(Header));
+    return MAGIC == header.magic && VERSION == header.version && type == header.type;
+  }
+
+  // The headers are copied out, since a baked font's texture needn't be aligned
+  static bool readTexture(const void * data, size_t size, TextureHeader & out) {
+    if (!isBaked(data, size, TEXTURE) || size < sizeof(Header) + sizeof(TextureHeader)) {
+      return false;
+    }
+    memcpy(&out, static_cast<const uint8_t *>(data) + sizeof(Header), sizeof(TextureHeader));
+    if (out.levelCount < 1 || out.levelCount > MAX_LEVELS) {
+      return false;
+    }
+    for (uint32_t i = 0; i < out.levelCount; ++i) {
+      if (out.levels[i].offset + out.levels[i].size > size) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static bool readMesh(const void * data, size_t size, MeshHeader & out) {
+    if (!isBaked(data, size, MESH) || size < sizeof(Header) + sizeof(MeshHeader)) {
+      return false;
+    }
+    memcpy(&out, static_cast<const uint8_t *>(data) + sizeof(Header), sizeof(MeshHeader));
+    if (out.vertexFormat > COMPACT_VERTICES || (2 != out.indexSize && 4 != out.indexSize) ||
+        out.lodCount < 1 || out.lodCount > MAX_LODS) {
+      return false;
+    }
+    for (uint32_t i = 0; i < out.lodCount; ++i) {
+      if ((uint64_t)out.lods[i].firstIndex + out.lods[i].indexCount > out.indexCount) {
+        return false;
+      }
+    }
+    return out.vertexOffset + (uint64_t)out.vertexCount * out.stride <= size &&
+      out.indexOffset + (uint64_t)out.indexCount * out.indexSize <= size;
+  }
+};
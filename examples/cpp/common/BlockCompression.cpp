@@ -0,0 +1,802 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+// Built into both the examples and the bake_assets tool, so this includes
+// only what it needs rather than Common.h
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BLOCKS_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BLOCKS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace oria {
+
+  // A 4x4 block of texels, as a structure of arrays so that the distance
+  // calculations can work on four texels at a time
+  struct Block {
+    float channel[4][16];
+  };
+
+  static void loadBlock(const uint8_t * rgba, uint32_t width, uint32_t height, size_t stride,
+      uint32_t bx, uint32_t by, Block & block) {
+    for (uint32_t y = 0; y < 4; ++y) {
+      const uint8_t * row = rgba + std::min(by * 4 + y, height - 1) * stride;
+      for (uint32_t x = 0; x < 4; ++x) {
+        const uint8_t * texel = row + std::min(bx * 4 + x, width - 1) * 4;
+        for (int c = 0; c < 4; ++c) {
+          block.channel[c][y * 4 + x] = texel[c];
+        }
+      }
+    }
+  }
+
+  // Picks the closest palette entry for every texel, comparing channels
+  // [first, first + count).  Returns the total squared error.
+  static float fitIndices(const Block & block, int first, int count,
+      const float palette[][4], int paletteSize, uint8_t indices[16]) {
+    float total = 0;
+#if defined(BLOCKS_SSE)
+    for (int i = 0; i < 16; i += 4) {
+      __m128 best = _mm_set1_ps(FLT_MAX);
+      __m128 bestIndex = _mm_setzero_ps();
+      for (int k = 0; k < paletteSize; ++k) {
+        __m128 distance = _mm_setzero_ps();
+        for (int c = first; c < first + count; ++c) {
+          __m128 diff = _mm_sub_ps(_mm_loadu_ps(&block.channel[c][i]), _mm_set1_ps(palette[k][c]));
+          distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+        }
+        __m128 closer = _mm_cmplt_ps(distance, best);
+        best = _mm_min_ps(distance, best);
+        bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)k)), _mm_andnot_ps(closer, bestIndex));
+      }
+      float errors[4], chosen[4];
+      _mm_storeu_ps(errors, best);
+      _mm_storeu_ps(chosen, bestIndex);
+      for (int j = 0; j < 4; ++j) {
+        indices[i + j] = (uint8_t)chosen[j];
+        total += errors[j];
+      }
+    }
+#elif defined(BLOCKS_NEON)
+    for (int i = 0; i < 16; i += 4) {
+      float32x4_t best = vdupq_n_f32(FLT_MAX);
+      float32x4_t bestIndex = vdupq_n_f32(0);
+      for (int k = 0; k < paletteSize; ++k) {
+        float32x4_t distance = vdupq_n_f32(0);
+        for (int c = first; c < first + count; ++c) {
+          float32x4_t diff = vsubq_f32(vld1q_f32(&block.channel[c][i]), vdupq_n_f32(palette[k][c]));
+          distance = vmlaq_f32(distance, diff, diff);
+        }
+        uint32x4_t closer = vcltq_f32(distance, best);
+        best = vminq_f32(distance, best);
+        bestIndex = vbslq_f32(closer, vdupq_n_f32((float)k), bestIndex);
+      }
+      float errors[4], chosen[4];
+      vst1q_f32(errors, best);
+      vst1q_f32(chosen, bestIndex);
+      for (int j = 0; j < 4; ++j) {
+        indices[i + j] = (uint8_t)chosen[j];
+        total += errors[j];
+      }
+    }
+#else
+    for (int i = 0; i < 16; ++i) {
+      float best = FLT_MAX;
+      for (int k = 0; k < paletteSize; ++k) {
+        float distance = 0;
+        for (int c = first; c < first + count; ++c) {
+          float diff = block.channel[c][i] - palette[k][c];
+          distance += diff * diff;
+        }
+        if (distance < best) {
+          best = distance;
+          indices[i] = (uint8_t)k;
+        }
+      }
+      total += best;
+    }
+#endif
+    return total;
+  }
+
+  // Fits a line through the texels' colors.  The ends of the line are
+  // where the texels furthest along it in either direction project to.
+  static void fitLine(const Block & block, int channels, float start[4], float end[4]) {
+    float mean[4] = { 0, 0, 0, 0 };
+    for (int c = 0; c < channels; ++c) {
+      for (int i = 0; i < 16; ++i) {
+        mean[c] += block.channel[c][i];
+      }
+      mean[c] /= 16.0f;
+    }
+
+    float covariance[4][4] = { { 0 } };
+    for (int i = 0; i < 16; ++i) {
+      for (int a = 0; a < channels; ++a) {
+        for (int b = 0; b < channels; ++b) {
+          covariance[a][b] += (block.channel[a][i] - mean[a]) * (block.channel[b][i] - mean[b]);
+        }
+      }
+    }
+
+    // Power iteration for the principal axis, starting from the extent
+    float axis[4] = { 0, 0, 0, 0 };
+    for (int c = 0; c < channels; ++c) {
+      const float * values = block.channel[c];
+      axis[c] = *std::max_element(values, values + 16) - *std::min_element(values, values + 16);
+    }
+    for (int iteration = 0; iteration < 8; ++iteration) {
+      float next[4] = { 0, 0, 0, 0 };
+      float length = 0;
+      for (int a = 0; a < channels; ++a) {
+        for (int b = 0; b < channels; ++b) {
+          next[a] += covariance[a][b] * axis[b];
+        }
+        length += next[a] * next[a];
+      }
+      if (length < 1e-12f) {
+        break;
+      }
+      length = std::sqrt(length);
+      for (int c = 0; c < channels; ++c) {
+        axis[c] = next[c] / length;
+      }
+    }
+
+    float minT = FLT_MAX, maxT = -FLT_MAX;
+    for (int i = 0; i < 16; ++i) {
+      float t = 0;
+      for (int c = 0; c < channels; ++c) {
+        t += (block.channel[c][i] - mean[c]) * axis[c];
+      }
+      minT = std::min(minT, t);
+      maxT = std::max(maxT, t);
+    }
+    for (int c = 0; c < channels; ++c) {
+      start[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+      end[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+    }
+  }
+
+  // Solves for the endpoints minimizing the error given the indices, where
+  // weights[index] is how much of the start each index blends in.  Returns
+  // false if the indices don't pin down a line.
+  static bool refineLine(const Block & block, int channels, const uint8_t indices[16],
+      const float * weights, float start[4], float end[4]) {
+    float aa = 0, ab = 0, bb = 0;
+    float ax[4] = { 0, 0, 0, 0 }, bx[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 16; ++i) {
+      float a = weights[indices[i]], b = 1.0f - a;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for (int c = 0; c < channels; ++c) {
+        ax[c] += a * block.channel[c][i];
+        bx[c] += b * block.channel[c][i];
+      }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f) {
+      return false;
+    }
+    for (int c = 0; c < channels; ++c) {
+      start[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+      end[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+    }
+    return true;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////
+  // BC1, and the color half of BC3
+
+  static uint16_t pack565(const float color[4]) {
+    int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+  }
+
+  static void unpack565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+  }
+
+  // The four color palette, computed the way the decoder does
+  static void colorPalette(uint16_t c0, uint16_t c1, float palette[4][4]) {
+    int a[3], b[3];
+    unpack565(c0, a);
+    unpack565(c1, b);
+    for (int c = 0; c < 3; ++c) {
+      palette[0][c] = (float)a[c];
+      palette[1][c] = (float)b[c];
+      palette[2][c] = (float)((2 * a[c] + b[c]) / 3);
+      palette[3][c] = (float)((a[c] + 2 * b[c]) / 3);
+    }
+  }
+
+  static void encodeColor(const Block & block, uint8_t * out) {
+    static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float start[4], end[4];
+    fitLine(block, 3, start, end);
+
+    uint16_t bestStart = 0, bestEnd = 0;
+    uint8_t best[16] = { 0 }, indices[16];
+    float bestError = FLT_MAX;
+    for (int iteration = 0; iteration < 3; ++iteration) {
+      uint16_t c0 = pack565(start), c1 = pack565(end);
+      float palette[4][4];
+      colorPalette(c0, c1, palette);
+      float error = fitIndices(block, 0, 3, palette, 4, indices);
+      if (error < bestError) {
+        bestError = error;
+        bestStart = c0;
+        bestEnd = c1;
+        memcpy(best, indices, 16);
+      }
+      if (!refineLine(block, 3, indices, WEIGHTS, start, end)) {
+        break;
+      }
+    }
+
+    // The four color mode is signalled by the first endpoint being larger
+    if (bestStart < bestEnd) {
+      static const uint8_t SWAPPED[4] = { 1, 0, 3, 2 };
+      std::swap(bestStart, bestEnd);
+      for (int i = 0; i < 16; ++i) {
+        best[i] = SWAPPED[best[i]];
+      }
+    } else if (bestStart == bestEnd) {
+      memset(best, 0, 16);
+    }
+
+    out[0] = (uint8_t)bestStart;
+    out[1] = (uint8_t)(bestStart >> 8);
+    out[2] = (uint8_t)bestEnd;
+    out[3] = (uint8_t)(bestEnd >> 8);
+    for (int y = 0; y < 4; ++y) {
+      out[4 + y] = (uint8_t)(best[y * 4] | (best[y * 4 + 1] << 2) | (best[y * 4 + 2] << 4) | (best[y * 4 + 3] << 6));
+    }
+  }
+
+  static void decodeColor(const uint8_t * in, bool allowTransparent, uint8_t texels[16][4]) {
+    uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8));
+    uint16_t c1 = (uint16_t)(in[2] | (in[3] << 8));
+    int a[3], b[3];
+    unpack565(c0, a);
+    unpack565(c1, b);
+    int palette[4][4];
+    for (int c = 0; c < 3; ++c) {
+      palette[0][c] = a[c];
+      palette[1][c] = b[c];
+      if (c0 > c1 || !allowTransparent) {
+        palette[2][c] = (2 * a[c] + b[c]) / 3;
+        palette[3][c] = (a[c] + 2 * b[c]) / 3;
+      } else {
+        palette[2][c] = (a[c] + b[c]) / 2;
+        palette[3][c] = 0;
+      }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = (c0 > c1 || !allowTransparent) ? 255 : 0;
+    for (int i = 0; i < 16; ++i) {
+      int index = (in[4 + i / 4] >> ((i % 4) * 2)) & 3;
+      for (int c = 0; c < 4; ++c) {
+        texels[i][c] = (uint8_t)palette[index][c];
+      }
+    }
+  }
+
+  ///////////////////////////////////////////////////////////////////////////
+  // The alpha half of BC3
+
+  static void alphaPalette(int a0, int a1, float palette[8][4]) {
+    palette[0][3] = (float)a0;
+    palette[1][3] = (float)a1;
+    for (int i = 1; i < 7; ++i) {
+      palette[i + 1][3] = (float)(((7 - i) * a0 + i * a1) / 7);
+    }
+  }
+
+  static void encodeAlpha(const Block & block, uint8_t * out) {
+    const float * alpha = block.channel[3];
+    int a0 = (int)*std::max_element(alpha, alpha + 16);
+    int a1 = (int)*std::min_element(alpha, alpha + 16);
+    uint8_t indices[16] = { 0 };
+    if (a0 != a1) {
+      float palette[8][4];
+      alphaPalette(a0, a1, palette);
+      fitIndices(block, 3, 1, palette, 8, indices);
+    }
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i) {
+      bits |= (uint64_t)indices[i] << (i * 3);
+    }
+    for (int i = 0; i < 6; ++i) {
+      out[2 + i] = (uint8_t)(bits >> (i * 8));
+    }
+  }
+
+  static void decodeAlpha(const uint8_t * in, uint8_t texels[16][4]) {
+    int a0 = in[0], a1 = in[1];
+    int palette[8] = { a0, a1 };
+    if (a0 > a1) {
+      for (int i = 1; i < 7; ++i) {
+        palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+      }
+    } else {
+      for (int i = 1; i < 5; ++i) {
+        palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+      }
+      palette[6] = 0;
+      palette[7] = 255;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i) {
+      bits |= (uint64_t)in[2 + i] << (i * 8);
+    }
+    for (int i = 0; i < 16; ++i) {
+      texels[i][3] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+    }
+  }
+
+  ///////////////////////////////////////////////////////////////////////////
+  // BC7 modes 5 and 6
+
+  static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+  static const int BC7_WEIGHTS2[4] = { 0, 21, 43, 64 };
+
+  static int bc7Interpolate(int e0, int e1, int weight) {
+    return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+  }
+
+  class BitWriter {
+    uint8_t * out;
+    int position{ 0 };
+  public:
+    explicit BitWriter(uint8_t * out) : out(out) {
+      memset(out, 0, 16);
+    }
+    void write(uint32_t value, int bits) {
+      for (int i = 0; i < bits; ++i, ++position) {
+        out[position >> 3] |= (uint8_t)(((value >> i) & 1) << (position & 7));
+      }
+    }
+  };
+
+  class BitReader {
+    const uint8_t * in;
+    int position{ 0 };
+  public:
+    explicit BitReader(const uint8_t * in) : in(in) {}
+    uint32_t read(int bits) {
+      uint32_t value = 0;
+      for (int i = 0; i < bits; ++i, ++position) {
+        value |= (uint32_t)((in[position >> 3] >> (position & 7)) & 1) << i;
+      }
+      return value;
+    }
+  };
+
+  // Endpoints are 7 bits per channel plus a shared low bit per endpoint
+  struct Mode6Endpoints {
+    int quantized[2][4];
+    int pbit[2];
+
+    int value(int endpoint, int c) const {
+      return (quantized[endpoint][c] << 1) | pbit[endpoint];
+    }
+  };
+
+  static void quantizeMode6(const float color[4], int pbit, int quantized[4]) {
+    for (int c = 0; c < 4; ++c) {
+      quantized[c] = std::min(std::max((int)((color[c] - pbit) / 2.0f + 0.5f), 0), 127);
+    }
+  }
+
+  static void mode6Palette(const Mode6Endpoints & endpoints, float palette[16][4]) {
+    for (int k = 0; k < 16; ++k) {
+      for (int c = 0; c < 4; ++c) {
+        palette[k][c] = (float)bc7Interpolate(endpoints.value(0, c), endpoints.value(1, c), BC7_WEIGHTS[k]);
+      }
+    }
+  }
+
+  static float encodeMode6(const Block & block, uint8_t * out) {
+    float weights[16];
+    for (int k = 0; k < 16; ++k) {
+      weights[k] = 1.0f - BC7_WEIGHTS[k] / 64.0f;
+    }
+
+    float start[4], end[4];
+    fitLine(block, 4, start, end);
+
+    // A constant alpha, above all an opaque one, has to come back exactly
+    // rather than one off.  Its low bit fixes both p-bits, and both
+    // endpoints then hold the rest of it.
+    const float * alpha = block.channel[3];
+    bool constantAlpha = *std::min_element(alpha, alpha + 16) == *std::max_element(alpha, alpha + 16);
+    int alphaValue = (int)alpha[0];
+
+    Mode6Endpoints best;
+    uint8_t bestIndices[16] = { 0 };
+    float bestError = FLT_MAX;
+    for (int iteration = 0; iteration < 2; ++iteration) {
+      // Try every combination of low bits, since each moves all four channels
+      for (int p = 0; p < 4; ++p) {
+        Mode6Endpoints candidate;
+        candidate.pbit[0] = p & 1;
+        candidate.pbit[1] = p >> 1;
+        if (constantAlpha && (candidate.pbit[0] != (alphaValue & 1) || candidate.pbit[1] != (alphaValue & 1))) {
+          continue;
+        }
+        quantizeMode6(start, candidate.pbit[0], candidate.quantized[0]);
+        quantizeMode6(end, candidate.pbit[1], candidate.quantized[1]);
+        if (constantAlpha) {
+          candidate.quantized[0][3] = candidate.quantized[1][3] = alphaValue >> 1;
+        }
+        float palette[16][4];
+        mode6Palette(candidate, palette);
+        uint8_t indices[16];
+        float error = fitIndices(block, 0, 4, palette, 16, indices);
+        if (error < bestError) {
+          bestError = error;
+          best = candidate;
+          memcpy(bestIndices, indices, 16);
+        }
+      }
+      if (!refineLine(block, 4, bestIndices, weights, start, end)) {
+        break;
+      }
+    }
+
+    // The first texel's index is stored without its top bit, so it has to
+    // be in the lower half.  Swapping the endpoints mirrors the indices.
+    if (bestIndices[0] & 8) {
+      std::swap(best.quantized[0], best.quantized[1]);
+      std::swap(best.pbit[0], best.pbit[1]);
+      for (int i = 0; i < 16; ++i) {
+        bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+      }
+    }
+
+    BitWriter writer(out);
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+      writer.write(best.quantized[0][c], 7);
+      writer.write(best.quantized[1][c], 7);
+    }
+    writer.write(best.pbit[0], 1);
+    writer.write(best.pbit[1], 1);
+    writer.write(bestIndices[0], 3);
+    for (int i = 1; i < 16; ++i) {
+      writer.write(bestIndices[i], 4);
+    }
+    return bestError;
+  }
+
+  static void decodeMode6(const uint8_t * in, uint8_t texels[16][4]) {
+    BitReader reader(in);
+    reader.read(7);
+    Mode6Endpoints endpoints;
+    for (int c = 0; c < 4; ++c) {
+      endpoints.quantized[0][c] = (int)reader.read(7);
+      endpoints.quantized[1][c] = (int)reader.read(7);
+    }
+    endpoints.pbit[0] = (int)reader.read(1);
+    endpoints.pbit[1] = (int)reader.read(1);
+    float palette[16][4];
+    mode6Palette(endpoints, palette);
+    for (int i = 0; i < 16; ++i) {
+      int index = (int)reader.read(0 == i ? 3 : 4);
+      for (int c = 0; c < 4; ++c) {
+        texels[i][c] = (uint8_t)palette[index][c];
+      }
+    }
+  }
+
+
+  static int expand7(int value) {
+    return (value << 1) | (value >> 6);
+  }
+
+  // Mode 5 keeps alpha on its own line, for blocks where it doesn't follow
+  // the color.  Both lines have 2 bit indices, and no rotation is used.
+  static float encodeMode5(const Block & block, uint8_t * out) {
+    float weights[4];
+    for (int k = 0; k < 4; ++k) {
+      weights[k] = 1.0f - BC7_WEIGHTS2[k] / 64.0f;
+    }
+
+    float start[4], end[4];
+    fitLine(block, 3, start, end);
+    int color[2][3] = { { 0 } };
+    uint8_t colorIndices[16] = { 0 };
+    float colorError = FLT_MAX;
+    for (int iteration = 0; iteration < 3; ++iteration) {
+      int quantized[2][3];
+      for (int c = 0; c < 3; ++c) {
+        quantized[0][c] = std::min((int)(start[c] * 127.0f / 255.0f + 0.5f), 127);
+        quantized[1][c] = std::min((int)(end[c] * 127.0f / 255.0f + 0.5f), 127);
+      }
+      float palette[4][4];
+      for (int k = 0; k < 4; ++k) {
+        for (int c = 0; c < 3; ++c) {
+          palette[k][c] = (float)bc7Interpolate(expand7(quantized[0][c]), expand7(quantized[1][c]), BC7_WEIGHTS2[k]);
+        }
+      }
+      uint8_t indices[16];
+      float error = fitIndices(block, 0, 3, palette, 4, indices);
+      if (error < colorError) {
+        colorError = error;
+        memcpy(color, quantized, sizeof(color));
+        memcpy(colorIndices, indices, 16);
+      }
+      if (!refineLine(block, 3, indices, weights, start, end)) {
+        break;
+      }
+    }
+
+    const float * values = block.channel[3];
+    start[3] = *std::max_element(values, values + 16);
+    end[3] = *std::min_element(values, values + 16);
+    int alpha[2] = { 0, 0 };
+    uint8_t alphaIndices[16] = { 0 };
+    float alphaError = FLT_MAX;
+    for (int iteration = 0; iteration < 2; ++iteration) {
+      int a0 = (int)(start[3] + 0.5f), a1 = (int)(end[3] + 0.5f);
+      float palette[4][4];
+      for (int k = 0; k < 4; ++k) {
+        palette[k][3] = (float)bc7Interpolate(a0, a1, BC7_WEIGHTS2[k]);
+      }
+      uint8_t indices[16];
+      float error = fitIndices(block, 3, 1, palette, 4, indices);
+      if (error < alphaError) {
+        alphaError = error;
+        alpha[0] = a0;
+        alpha[1] = a1;
+        memcpy(alphaIndices, indices, 16);
+      }
+      // Only the alpha results are used
+      if (!refineLine(block, 4, indices, weights, start, end)) {
+        break;
+      }
+    }
+
+    // As in mode 6, the first texel's indices have an implied top bit of 0
+    if (colorIndices[0] & 2) {
+      std::swap(color[0], color[1]);
+      for (int i = 0; i < 16; ++i) {
+        colorIndices[i] = (uint8_t)(3 - colorIndices[i]);
+      }
+    }
+    if (alphaIndices[0] & 2) {
+      std::swap(alpha[0], alpha[1]);
+      for (int i = 0; i < 16; ++i) {
+        alphaIndices[i] = (uint8_t)(3 - alphaIndices[i]);
+      }
+    }
+
+    BitWriter writer(out);
+    writer.write(1 << 5, 6);
+    writer.write(0, 2);
+    for (int c = 0; c < 3; ++c) {
+      writer.write(color[0][c], 7);
+      writer.write(color[1][c], 7);
+    }
+    writer.write(alpha[0], 8);
+    writer.write(alpha[1], 8);
+    for (int i = 0; i < 16; ++i) {
+      writer.write(colorIndices[i], 0 == i ? 1 : 2);
+    }
+    for (int i = 0; i < 16; ++i) {
+      writer.write(alphaIndices[i], 0 == i ? 1 : 2);
+    }
+    return colorError + alphaError;
+  }
+
+  static void decodeMode5(const uint8_t * in, uint8_t texels[16][4]) {
+    BitReader reader(in);
+    reader.read(6);
+    int rotation = (int)reader.read(2);
+    int endpoints[2][4];
+    for (int c = 0; c < 3; ++c) {
+      endpoints[0][c] = expand7((int)reader.read(7));
+      endpoints[1][c] = expand7((int)reader.read(7));
+    }
+    endpoints[0][3] = (int)reader.read(8);
+    endpoints[1][3] = (int)reader.read(8);
+    for (int i = 0; i < 16; ++i) {
+      int index = (int)reader.read(0 == i ? 1 : 2);
+      for (int c = 0; c < 3; ++c) {
+        texels[i][c] = (uint8_t)bc7Interpolate(endpoints[0][c], endpoints[1][c], BC7_WEIGHTS2[index]);
+      }
+    }
+    for (int i = 0; i < 16; ++i) {
+      int index = (int)reader.read(0 == i ? 1 : 2);
+      texels[i][3] = (uint8_t)bc7Interpolate(endpoints[0][3], endpoints[1][3], BC7_WEIGHTS2[index]);
+      if (rotation) {
+        std::swap(texels[i][3], texels[i][rotation - 1]);
+      }
+    }
+  }
+
+  static void encodeBc7(const Block & block, uint8_t * out) {
+    float error = encodeMode6(block, out);
+    const float * alpha = block.channel[3];
+    if (*std::min_element(alpha, alpha + 16) != *std::max_element(alpha, alpha + 16)) {
+      uint8_t alternative[16];
+      if (encodeMode5(block, alternative) < error) {
+        memcpy(out, alternative, 16);
+      }
+    }
+  }
+
+  // The mode is the position of the first set bit
+  static bool decodeBc7(const uint8_t * in, uint8_t texels[16][4]) {
+    if (0x40 == (in[0] & 0x7F)) {
+      decodeMode6(in, texels);
+    } else if (0x20 == (in[0] & 0x3F)) {
+      decodeMode5(in, texels);
+    } else {
+      memset(texels, 0, 16 * 4);
+      return false;
+    }
+    return true;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////
+
+  size_t blockBytes(BlockFormat format) {
+    return BLOCK_BC1 == format ? 8 : 16;
+  }
+
+  size_t compressedSize(BlockFormat format, uint32_t width, uint32_t height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+  }
+
+  void compressBlocks(const uint8_t * rgba, uint32_t width, uint32_t height, size_t stride,
+      BlockFormat format, uint8_t * out, ThreadPool * pool) {
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t bytes = blockBytes(format);
+    auto encodeRow = [&](size_t by) {
+      Block block;
+      uint8_t * target = out + by * blocksX * bytes;
+      for (uint32_t bx = 0; bx < blocksX; ++bx, target += bytes) {
+        loadBlock(rgba, width, height, stride, bx, (uint32_t)by, block);
+        switch (format) {
+        case BLOCK_BC1:
+          encodeColor(block, target);
+          break;
+        case BLOCK_BC3:
+          encodeAlpha(block, target);
+          encodeColor(block, target + 8);
+          break;
+        case BLOCK_BC7:
+          encodeBc7(block, target);
+          break;
+        }
+      }
+    };
+    if (pool && blocksY > 1) {
+      pool->parallelFor(blocksY, encodeRow);
+    } else {
+      for (uint32_t by = 0; by < blocksY; ++by) {
+        encodeRow(by);
+      }
+    }
+  }
+
+  bool decompressBlocks(const uint8_t * blocks, uint32_t width, uint32_t height,
+      BlockFormat format, uint8_t * rgba, size_t stride) {
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t bytes = blockBytes(format);
+    bool result = true;
+    for (uint32_t by = 0; by < blocksY; ++by) {
+      for (uint32_t bx = 0; bx < blocksX; ++bx, blocks += bytes) {
+        uint8_t texels[16][4];
+        switch (format) {
+        case BLOCK_BC1:
+          decodeColor(blocks, true, texels);
+          break;
+        case BLOCK_BC3:
+          decodeColor(blocks + 8, false, texels);
+          decodeAlpha(blocks, texels);
+          break;
+        case BLOCK_BC7:
+          result &= decodeBc7(blocks, texels);
+          break;
+        }
+        for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y) {
+          uint8_t * row = rgba + (by * 4 + y) * stride + bx * 16;
+          uint32_t count = std::min(4u, width - bx * 4);
+          memcpy(row, texels[y * 4], count * 4);
+        }
+      }
+    }
+    return result;
+  }
+
+  // Reverses the order of the valid rows of 2 bit color indices, one byte
+  // per row
+  static void flipColorBlock(uint8_t * block, uint32_t rows) {
+    std::reverse(block + 4, block + 4 + rows);
+  }
+
+  // Reverses the order of the valid rows of 3 bit alpha indices, 12 bits
+  // per row
+  static void flipAlphaBlock(uint8_t * block, uint32_t rows) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i) {
+      bits |= (uint64_t)block[2 + i] << (i * 8);
+    }
+    uint64_t flipped = bits;
+    for (uint32_t row = 0; row < rows; ++row) {
+      uint64_t mask = (uint64_t)0xFFF << ((rows - row - 1) * 12);
+      flipped = (flipped & ~mask) | (((bits >> (row * 12)) & 0xFFF) << ((rows - row - 1) * 12));
+    }
+    for (int i = 0; i < 6; ++i) {
+      block[2 + i] = (uint8_t)(flipped >> (i * 8));
+    }
+  }
+
+  bool flipBlocks(uint8_t * blocks, uint32_t width, uint32_t height, BlockFormat format) {
+    // The bottom levels of a mip chain fit in one row of blocks, so only
+    // their valid rows need mirroring
+    if (BLOCK_BC7 == format || (height > 4 && 0 != height % 4)) {
+      return false;
+    }
+    const uint32_t rows = std::min(height, 4u);
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t bytes = blockBytes(format);
+    const size_t rowBytes = blocksX * bytes;
+    std::vector<uint8_t> temp(rowBytes);
+    for (uint32_t by = 0; by < blocksY / 2; ++by) {
+      uint8_t * top = blocks + by * rowBytes;
+      uint8_t * bottom = blocks + (blocksY - by - 1) * rowBytes;
+      memcpy(&temp[0], top, rowBytes);
+      memcpy(top, bottom, rowBytes);
+      memcpy(bottom, &temp[0], rowBytes);
+    }
+    for (size_t i = 0; i < (size_t)blocksX * blocksY; ++i) {
+      uint8_t * block = blocks + i * bytes;
+      if (BLOCK_BC3 == format) {
+        flipAlphaBlock(block, rows);
+        block += 8;
+      }
+      flipColorBlock(block, rows);
+    }
+    return true;
+  }
+
+}
@@ -0,0 +1,70 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+// Shared with the bake_assets tool, so it must not depend on anything
+// pulled in by Common.h
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+namespace oria {
+
+  /**
+   * The block compressed formats every desktop GPU samples directly.  Each
+   * encodes a 4x4 block of texels into a fixed number of bytes.
+   *
+   *   BC1 : 8 bytes, RGB (4 bits per texel)
+   *   BC3 : 16 bytes, BC1 color plus interpolated alpha (8 bits per texel)
+   *   BC7 : 16 bytes, RGBA with far better color than BC1 (8 bits per texel)
+   *
+   * The BC7 encoder only writes mode 6 (a single RGBA line per block, with
+   * 4 bit indices), which handles photographic content well and is fast to
+   * search, and mode 5 (separate color and alpha lines) for blocks where
+   * that fits the alpha better.  The decoder likewise only understands
+   * those two modes, since it exists to check the encoder and to stand in
+   * for drivers without BPTC support.
+   */
+  enum BlockFormat {
+    BLOCK_BC1,
+    BLOCK_BC3,
+    BLOCK_BC7,
+  };
+
+  size_t blockBytes(BlockFormat format);
+  size_t compressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+  // Encodes RGBA8 pixels.  Partial blocks at the edges repeat the last row
+  // or column.  If a pool is given, rows of blocks are split across it.
+  void compressBlocks(const uint8_t * rgba, uint32_t width, uint32_t height, size_t stride,
+    BlockFormat format, uint8_t * out, ThreadPool * pool = nullptr);
+
+  // Returns false if the data uses anything this decoder doesn't handle
+  bool decompressBlocks(const uint8_t * blocks, uint32_t width, uint32_t height,
+    BlockFormat format, uint8_t * rgba, size_t stride);
+
+  // Reverses the row order of a compressed image in place, without
+  // decoding it.  Only possible for BC1 and BC3, and only when the height
+  // is a whole number of blocks or fits in one.  Returns false if it can't
+  // be done.
+  bool flipBlocks(uint8_t * blocks, uint32_t width, uint32_t height, BlockFormat format);
+
+}
@@ -25,8 +25,10 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cinttypes>
 #include <cmath>
+#include <deque>
 #include <iostream>
 #include <list>
 #include <map>
@@ -119,8 +121,23 @@ public:
 typedef std::function<void()> Lambda;
 typedef std::list<Lambda> LambdaList;
 
+#include "ThreadPool.h"
+#include "ResourcePack.h"
+#include "BakedAsset.h"
 #include "Platform.h"
+#include "ResourceWatcher.h"
 #include "Utils.h"
+#include "PixelKernels.h"
+#include "PngDecoder.h"
+#include "MipChain.h"
+#include "BlockCompression.h"
+#include "AtlasPacker.h"
+#include "PanoramaTiles.h"
+#include "EquirectCubemap.h"
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjParser.h"
 
 #include "rendering/Lights.h"
 #include "rendering/MatrixStack.h"
@@ -131,13 +148,19 @@ typedef std::list<Lambda> LambdaList;
 
 #include "opengl/Constants.h"
 #include "opengl/Textures.h"
+#include "opengl/TextureCache.h"
+#include "opengl/TextureAtlas.h"
+#include "opengl/StreamingTexture.h"
 #include "opengl/Shaders.h"
 #include "opengl/Framebuffer.h"
+#include "opengl/FrameCapture.h"
 #include "opengl/GlUtils.h"
+#include "opengl/VirtualPanorama.h"
 
 
 #include "glfw/GlfwUtils.h"
 #include "glfw/GlfwApp.h"
+#include "glfw/UploadQueue.h"
 
 #if defined(OS_WIN)
 #define OVR_OS_WIN32
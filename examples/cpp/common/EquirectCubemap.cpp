@@ -0,0 +1,270 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "EquirectCubemap.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CUBEMAP_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CUBEMAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace oria {
+
+  static const float PI = 3.14159265358979f;
+
+  // Texels are filtered as 4 floats, whatever the channel count, so every
+  // tap is a single SIMD multiply and add.  Channels are packed into the
+  // low bytes of a 32 bit word on the way in and out.
+#if defined(CUBEMAP_SSE)
+  typedef __m128 Vec4;
+  static inline Vec4 vzero() { return _mm_setzero_ps(); }
+  static inline Vec4 vmadd(Vec4 acc, Vec4 v, float w) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w))); }
+  static inline Vec4 vexpand(uint32_t texel) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i bytes = _mm_cvtsi32_si128((int)texel);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+  }
+  static inline uint32_t vpack(Vec4 v) {
+    // Both packs saturate, which takes care of the bicubic over and
+    // undershoot
+    __m128i words = _mm_packs_epi32(_mm_cvtps_epi32(v), _mm_setzero_si128());
+    return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+  }
+#elif defined(CUBEMAP_NEON)
+  typedef float32x4_t Vec4;
+  static inline Vec4 vzero() { return vdupq_n_f32(0); }
+  static inline Vec4 vmadd(Vec4 acc, Vec4 v, float w) { return vmlaq_n_f32(acc, v, w); }
+  static inline Vec4 vexpand(uint32_t texel) {
+    uint16x8_t words = vmovl_u8(vcreate_u8(texel));
+    return vcvtq_f32_u32(vmovl_u16(vget_low_u16(words)));
+  }
+  static inline uint32_t vpack(Vec4 v) {
+    int32x4_t rounded = vcvtq_s32_f32(vaddq_f32(v, vdupq_n_f32(0.5f)));
+    uint8x8_t bytes = vqmovn_u16(vcombine_u16(vqmovun_s32(rounded), vdup_n_u16(0)));
+    return vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+  }
+#else
+  struct Vec4 { float v[4]; };
+  static inline Vec4 vzero() { Vec4 r = { { 0, 0, 0, 0 } }; return r; }
+  static inline Vec4 vmadd(Vec4 acc, Vec4 v, float w) {
+    for (int i = 0; i < 4; ++i) {
+      acc.v[i] += v.v[i] * w;
+    }
+    return acc;
+  }
+  static inline Vec4 vexpand(uint32_t texel) {
+    Vec4 r;
+    for (int i = 0; i < 4; ++i) {
+      r.v[i] = (float)((texel >> (i * 8)) & 0xFF);
+    }
+    return r;
+  }
+  static inline uint32_t vpack(Vec4 v) {
+    uint32_t result = 0;
+    for (int i = 0; i < 4; ++i) {
+      float c = std::min(255.0f, std::max(0.0f, v.v[i] + 0.5f));
+      result |= (uint32_t)c << (i * 8);
+    }
+    return result;
+  }
+#endif
+
+  static inline uint32_t readTexel(const uint8_t * p, int channels) {
+    if (4 == channels) {
+      uint32_t texel;
+      memcpy(&texel, p, 4);
+      return texel;
+    }
+    uint32_t texel = 0;
+    for (int i = 0; i < channels; ++i) {
+      texel |= (uint32_t)p[i] << (i * 8);
+    }
+    return texel;
+  }
+
+  static inline void writeTexel(uint8_t * p, int channels, uint32_t texel) {
+    if (4 == channels) {
+      memcpy(p, &texel, 4);
+      return;
+    }
+    for (int i = 0; i < channels; ++i) {
+      p[i] = (uint8_t)(texel >> (i * 8));
+    }
+  }
+
+  // Direction through the center of a face texel, with s and t in [-1, 1]
+  // as in the cube map face selection table of the GL specification
+  static inline void faceDirection(int face, float s, float t, float out[3]) {
+    switch (face) {
+    case 0: out[0] = 1; out[1] = -t; out[2] = -s; break;
+    case 1: out[0] = -1; out[1] = -t; out[2] = s; break;
+    case 2: out[0] = s; out[1] = 1; out[2] = t; break;
+    case 3: out[0] = s; out[1] = -1; out[2] = -t; break;
+    case 4: out[0] = s; out[1] = -t; out[2] = 1; break;
+    default: out[0] = -s; out[1] = -t; out[2] = -1; break;
+    }
+  }
+
+  static inline void catmullRom(float t, float w[4]) {
+    w[0] = ((-0.5f * t + 1.0f) * t - 0.5f) * t;
+    w[1] = (1.5f * t - 2.5f) * t * t + 1.0f;
+    w[2] = ((-1.5f * t + 2.0f) * t + 0.5f) * t;
+    w[3] = (0.5f * t - 0.5f) * t * t;
+  }
+
+  struct Source {
+    const uint8_t * pixels;
+    size_t stride;
+    int channels;
+    int width;
+    int height;
+    // The crop spans the full circle, so columns wrap around
+    bool wraps;
+
+    int column(int x) const {
+      if (wraps) {
+        x %= width;
+        return x < 0 ? x + width : x;
+      }
+      return std::min(width - 1, std::max(0, x));
+    }
+
+    int row(int y) const {
+      return std::min(height - 1, std::max(0, y));
+    }
+
+    Vec4 texel(int x, int y) const {
+      return vexpand(readTexel(pixels + y * stride + x * channels, channels));
+    }
+
+    // Filters around a point in texel space, where texel centers sit at
+    // whole numbers
+    template <int TAPS>
+    uint32_t sample(float x, float y) const {
+      float wx[4], wy[4];
+      int xs[4], ys[4];
+      float x0 = std::floor(x), y0 = std::floor(y);
+      float tx = x - x0, ty = y - y0;
+      if (4 == TAPS) {
+        catmullRom(tx, wx);
+        catmullRom(ty, wy);
+      } else {
+        wx[0] = 1.0f - tx;
+        wx[1] = tx;
+        wy[0] = 1.0f - ty;
+        wy[1] = ty;
+      }
+      int first = (4 == TAPS) ? -1 : 0;
+      for (int i = 0; i < TAPS; ++i) {
+        xs[i] = column((int)x0 + first + i);
+        ys[i] = row((int)y0 + first + i);
+      }
+      Vec4 acc = vzero();
+      for (int j = 0; j < TAPS; ++j) {
+        for (int i = 0; i < TAPS; ++i) {
+          acc = vmadd(acc, texel(xs[i], ys[j]), wx[i] * wy[j]);
+        }
+      }
+      return vpack(acc);
+    }
+  };
+
+  template <int TAPS>
+  static void convertRow(const Source & source, const PanoramaLayout & layout, uint32_t background,
+      int face, uint32_t y, uint32_t faceSize, uint8_t * out) {
+    const float scale = 2.0f / faceSize;
+    const float t = (y + 0.5f) * scale - 1.0f;
+    // Texel centers of the panorama, relative to the crop
+    const float offsetX = layout.fullWidth * 0.5f - 0.5f - layout.cropX;
+    const float offsetY = layout.fullHeight * 0.5f - 0.5f - layout.cropY;
+    const float unitsX = layout.fullWidth / (2.0f * PI);
+    const float unitsY = layout.fullHeight / PI;
+    for (uint32_t x = 0; x < faceSize; ++x) {
+      float d[3];
+      faceDirection(face, (x + 0.5f) * scale - 1.0f, t, d);
+      float longitude = std::atan2(d[0], -d[2]);
+      float latitude = std::atan2(d[1], std::sqrt(d[0] * d[0] + d[2] * d[2]));
+      float px = longitude * unitsX + offsetX;
+      float py = offsetY - latitude * unitsY;
+      uint32_t texel = background;
+      if ((source.wraps || (px >= -0.5f && px < source.width - 0.5f)) &&
+          py >= -0.5f && py < source.height - 0.5f) {
+        texel = source.sample<TAPS>(px, py);
+      }
+      writeTexel(out + x * source.channels, source.channels, texel);
+    }
+  }
+
+  std::vector<MipLevel> equirectToCubemap(const uint8_t * pixels, size_t stride, int channels,
+      const PanoramaLayout & layout, const CubemapOptions & options) {
+    if (channels < 1 || channels > 4) {
+      throw std::runtime_error("Cubemaps need 1 to 4 channels");
+    }
+    if (!layout.cropWidth || !layout.cropHeight || !layout.fullWidth || !layout.fullHeight) {
+      throw std::runtime_error("Empty panorama");
+    }
+    uint32_t faceSize = options.faceSize ? options.faceSize : std::max(1u, layout.fullWidth / 4);
+
+    Source source;
+    source.pixels = pixels;
+    source.stride = stride;
+    source.channels = channels;
+    source.width = (int)layout.cropWidth;
+    source.height = (int)layout.cropHeight;
+    source.wraps = layout.cropWidth == layout.fullWidth;
+    uint32_t background = readTexel(options.background, channels);
+
+    std::vector<MipLevel> faces(6);
+    for (int i = 0; i < 6; ++i) {
+      faces[i].width = faces[i].height = faceSize;
+      faces[i].pixels.resize(faceSize * faceSize * channels);
+    }
+
+    // Every row of every face is independent
+    auto convert = [&](size_t index) {
+      int face = (int)(index / faceSize);
+      uint32_t y = (uint32_t)(index % faceSize);
+      uint8_t * out = &faces[face].pixels[y * faceSize * channels];
+      if (CUBEMAP_BICUBIC == options.filter) {
+        convertRow<4>(source, layout, background, face, y, faceSize, out);
+      } else {
+        convertRow<2>(source, layout, background, face, y, faceSize, out);
+      }
+    };
+    size_t rows = 6 * (size_t)faceSize;
+    if (options.pool) {
+      options.pool->parallelFor(rows, convert);
+    } else {
+      for (size_t i = 0; i < rows; ++i) {
+        convert(i);
+      }
+    }
+    return faces;
+  }
+
+}
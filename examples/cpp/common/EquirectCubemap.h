@@ -0,0 +1,65 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+// Shared with the equirect_to_cubemap tool, so it must not depend on
+// anything pulled in by Common.h
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MipChain.h"
+#include "PanoramaTiles.h"
+
+class ThreadPool;
+
+namespace oria {
+
+  enum CubemapFilter {
+    CUBEMAP_BILINEAR = 0,
+    // Catmull-Rom.  Sharper, at about three times the cost.
+    CUBEMAP_BICUBIC,
+  };
+
+  struct CubemapOptions {
+    CubemapFilter filter{ CUBEMAP_BILINEAR };
+    // Texels along each edge of a face.  Zero matches the resolution of
+    // the panorama at the equator, a quarter of its full width.
+    uint32_t faceSize{ 0 };
+    // For the parts of the sphere a cropped panorama doesn't cover, in
+    // the same channel order as the source
+    uint8_t background[4] = { 0x54, 0x54, 0x54, 0xFF };
+    // If set, the rows of all six faces are split across the pool
+    ThreadPool * pool{ nullptr };
+  };
+
+  /**
+   * Resamples an 8 bit equirectangular panorama of 1 to 4 channels into
+   * the six faces of a cubemap, with the same channels.
+   *
+   * The pixels cover the crop of the layout, top row first.  The faces
+   * come back in the order of the GL face targets (+X, -X, +Y, -Y, +Z,
+   * -Z), oriented as GL samples them, so they can be uploaded as they are
+   * without flipping.
+   */
+  std::vector<MipLevel> equirectToCubemap(const uint8_t * pixels, size_t stride, int channels,
+    const PanoramaLayout & layout, const CubemapOptions & options = CubemapOptions());
+
+}
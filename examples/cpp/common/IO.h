@@ -19,6 +19,46 @@
 
 #pragma once
 #include <iostream>
+#include <streambuf>
+
+// Exposes an existing block of memory as a read-only stream buffer, so 
+// istream based parsers can consume resources without copying them
+class MemoryStreamBuf : public std::streambuf {
+public:
+  MemoryStreamBuf(const void * data, size_t size) {
+    char * begin = const_cast<char *>(static_cast<const char *>(data));
+    setg(begin, begin, begin + size);
+  }
+
+protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+      std::ios_base::openmode which = std::ios_base::in) {
+    char * target = gptr();
+    switch (dir) {
+    case std::ios_base::beg:
+      target = eback() + off;
+      break;
+    case std::ios_base::cur:
+      target = gptr() + off;
+      break;
+    case std::ios_base::end:
+      target = egptr() + off;
+      break;
+    default:
+      break;
+    }
+    if (target < eback() || target > egptr()) {
+      return pos_type(off_type(-1));
+    }
+    setg(eback(), target, egptr());
+    return pos_type(target - eback());
+  }
+
+  pos_type seekpos(pos_type pos,
+      std::ios_base::openmode which = std::ios_base::in) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
 
 template<class To, class From> To hard_cast(From v) {
   return static_cast<To>(static_cast<void*>(v));
@@ -0,0 +1,247 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "MeshData.h"
+
+#include <openctm.h>
+
+namespace oria {
+
+  uint32_t MeshData::floatsPerVertex() const {
+    return BakedAsset::attributeOffset(attributes, BakedAsset::MATERIAL << 1);
+  }
+
+  void MeshData::bounds(float min[3], float max[3], float sphere[4]) const {
+    const uint32_t floats = floatsPerVertex();
+    const uint32_t count = vertexCount();
+    // Positions always come first in a vertex
+    for (int i = 0; i < 3; ++i) {
+      min[i] = max[i] = count ? vertices[i] : 0;
+    }
+    for (uint32_t v = 0; v < count; ++v) {
+      for (int i = 0; i < 3; ++i) {
+        min[i] = std::min(min[i], vertices[v * floats + i]);
+        max[i] = std::max(max[i], vertices[v * floats + i]);
+      }
+    }
+    float radiusSquared = 0;
+    for (int i = 0; i < 3; ++i) {
+      sphere[i] = (min[i] + max[i]) * 0.5f;
+    }
+    for (uint32_t v = 0; v < count; ++v) {
+      float distanceSquared = 0;
+      for (int i = 0; i < 3; ++i) {
+        float d = vertices[v * floats + i] - sphere[i];
+        distanceSquared += d * d;
+      }
+      radiusSquared = std::max(radiusSquared, distanceSquared);
+    }
+    sphere[3] = std::sqrt(radiusSquared);
+  }
+
+  struct MemoryReader {
+    const uint8_t * data;
+    size_t size;
+    size_t position;
+  };
+
+  static CTMuint CTMCALL readMemory(void * buffer, CTMuint count, void * userData) {
+    MemoryReader & reader = *static_cast<MemoryReader *>(userData);
+    size_t available = std::min<size_t>(count, reader.size - reader.position);
+    memcpy(buffer, reader.data + reader.position, available);
+    reader.position += available;
+    return (CTMuint)available;
+  }
+
+  // Copies one attribute of every vertex into its slot in the interleaved
+  // vertices
+  static void interleave(const CTMfloat * source, uint32_t size, uint32_t count,
+      float * dest, uint32_t floats) {
+    for (uint32_t v = 0; v < count; ++v) {
+      for (uint32_t i = 0; i < size; ++i) {
+        dest[v * floats + i] = source[v * size + i];
+      }
+    }
+  }
+
+  // Round to nearest even, with overflow going to infinity and underflow
+  // to half float denormals
+  static uint16_t toHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude >= 0x7F800000) {
+      // Infinity stays infinity, NaN stays NaN
+      return (uint16_t)(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));
+    }
+    if (magnitude >= 0x477FF000) {
+      // Rounds up past the largest half float
+      return (uint16_t)(sign | 0x7C00);
+    }
+    if (magnitude < 0x38800000) {
+      // Denormal, or zero.  Shifting the implicit bit into place gives the
+      // mantissa, with the bits shifted out deciding the rounding.
+      if (magnitude < 0x33000000) {
+        return (uint16_t)sign;
+      }
+      uint32_t shift = 126 - (magnitude >> 23);
+      uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+      uint32_t result = mantissa >> shift;
+      uint32_t rest = mantissa & ((1u << shift) - 1);
+      uint32_t half = 1u << (shift - 1);
+      if (rest > half || (rest == half && (result & 1))) {
+        ++result;
+      }
+      return (uint16_t)(sign | result);
+    }
+    // Rebias the exponent, then round away the low 13 bits of the mantissa
+    uint32_t result = magnitude - 0x38000000;
+    result += 0xFFF + ((result >> 13) & 1);
+    return (uint16_t)(sign | (result >> 13));
+  }
+
+  static uint32_t toSnorm10(float value) {
+    float clamped = std::min(1.0f, std::max(-1.0f, value));
+    return (uint32_t)(int32_t)std::floor(clamped * 511.0f + 0.5f) & 0x3FF;
+  }
+
+  template <typename T>
+  static void write(uint8_t * dest, const T & value) {
+    memcpy(dest, &value, sizeof(T));
+  }
+
+  static bool fitsHalfFloats(const MeshData & mesh) {
+    float min[3], max[3], sphere[4];
+    mesh.bounds(min, max, sphere);
+    float largest = 0;
+    for (int i = 0; i < 3; ++i) {
+      largest = std::max(largest, std::max(std::abs(min[i]), std::abs(max[i])));
+    }
+    // A half float has 10 bits of mantissa, so rounds to within 1/2048th
+    // of its magnitude
+    return largest < 65504.0f && largest / 2048.0f <= sphere[3] / 512.0f;
+  }
+
+  std::vector<uint8_t> packVertices(const MeshData & mesh, uint32_t & format) {
+    if (BakedAsset::COMPACT_VERTICES == format && !fitsHalfFloats(mesh)) {
+      format = BakedAsset::FLOAT_VERTICES;
+    }
+    if (BakedAsset::COMPACT_VERTICES != format) {
+      format = BakedAsset::FLOAT_VERTICES;
+      const uint8_t * bytes = reinterpret_cast<const uint8_t *>(mesh.vertices.data());
+      return std::vector<uint8_t>(bytes, bytes + mesh.vertices.size() * sizeof(float));
+    }
+
+    const uint32_t floats = mesh.floatsPerVertex();
+    const uint32_t count = mesh.vertexCount();
+    const uint32_t stride = BakedAsset::attributeByteOffset(format, mesh.attributes, BakedAsset::MATERIAL << 1);
+    std::vector<uint8_t> result((size_t)count * stride, 0);
+    for (uint32_t v = 0; v < count; ++v) {
+      const float * source = &mesh.vertices[(size_t)v * floats];
+      uint8_t * dest = &result[(size_t)v * stride];
+      for (int i = 0; i < 3; ++i) {
+        write(dest + i * 2, toHalf(source[i]));
+      }
+      source += 3;
+      dest += 8;
+      if (mesh.attributes & BakedAsset::NORMAL) {
+        uint32_t packed = toSnorm10(source[0]) | (toSnorm10(source[1]) << 10) | (toSnorm10(source[2]) << 20);
+        write(dest, packed);
+        source += 3;
+        dest += 4;
+      }
+      if (mesh.attributes & BakedAsset::TEXCOORD) {
+        write(dest, toHalf(source[0]));
+        write(dest + 2, toHalf(source[1]));
+        source += 2;
+        dest += 4;
+      }
+      if (mesh.attributes & BakedAsset::MATERIAL) {
+        write(dest, (uint16_t)std::min(65535.0f, std::max(0.0f, source[0])));
+      }
+    }
+    return result;
+  }
+
+  std::vector<uint8_t> packIndices(const MeshData & mesh, uint32_t & indexSize) {
+    indexSize = mesh.vertexCount() <= 0x10000 ? 2 : 4;
+    std::vector<uint8_t> result(mesh.indices.size() * indexSize);
+    if (4 == indexSize) {
+      if (!result.empty()) {
+        memcpy(&result[0], mesh.indices.data(), result.size());
+      }
+      return result;
+    }
+    for (size_t i = 0; i < mesh.indices.size(); ++i) {
+      write(&result[i * 2], (uint16_t)mesh.indices[i]);
+    }
+    return result;
+  }
+
+  MeshData decodeCtm(const uint8_t * data, size_t size, uint32_t attributes) {
+    CTMcontext context = ctmNewContext(CTM_IMPORT);
+    if (!context) {
+      throw std::runtime_error("Unable to create a CTM context");
+    }
+    MemoryReader reader = { data, size, 0 };
+    ctmLoadCustom(context, readMemory, &reader);
+    CTMenum error = ctmGetError(context);
+    if (CTM_NONE != error) {
+      ctmFreeContext(context);
+      throw std::runtime_error(std::string("Unable to decode CTM mesh: ") + ctmErrorString(error));
+    }
+
+    MeshData mesh;
+    if ((attributes & BakedAsset::NORMAL) && ctmGetInteger(context, CTM_HAS_NORMALS)) {
+      mesh.attributes |= BakedAsset::NORMAL;
+    }
+    if ((attributes & BakedAsset::TEXCOORD) && ctmGetInteger(context, CTM_UV_MAP_COUNT)) {
+      mesh.attributes |= BakedAsset::TEXCOORD;
+    }
+
+    // OpenCTM holds on to its own decoded arrays, so this is the only other
+    // copy of the vertices
+    const uint32_t vertexCount = ctmGetInteger(context, CTM_VERTEX_COUNT);
+    const uint32_t floats = mesh.floatsPerVertex();
+    mesh.vertices.resize((size_t)vertexCount * floats);
+    float * vertices = mesh.vertices.data();
+    interleave(ctmGetFloatArray(context, CTM_VERTICES), 3, vertexCount, vertices, floats);
+    if (mesh.attributes & BakedAsset::NORMAL) {
+      interleave(ctmGetFloatArray(context, CTM_NORMALS), 3, vertexCount,
+        vertices + BakedAsset::attributeOffset(mesh.attributes, BakedAsset::NORMAL), floats);
+    }
+    if (mesh.attributes & BakedAsset::TEXCOORD) {
+      interleave(ctmGetFloatArray(context, CTM_UV_MAP_1), 2, vertexCount,
+        vertices + BakedAsset::attributeOffset(mesh.attributes, BakedAsset::TEXCOORD), floats);
+    }
+    const CTMuint * indices = ctmGetIntegerArray(context, CTM_INDICES);
+    mesh.indices.assign(indices, indices + ctmGetInteger(context, CTM_TRIANGLE_COUNT) * 3);
+    ctmFreeContext(context);
+    return mesh;
+  }
+
+}
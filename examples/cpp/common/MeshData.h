@@ -0,0 +1,78 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#pragma once
+
+// Shared with the bake_assets tool, so it must not depend on anything
+// pulled in by Common.h
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BakedAsset.h"
+
+namespace oria {
+
+  /**
+   * A triangle list on the CPU, with the vertices interleaved as float
+   * vertices are in a baked mesh (see BakedAsset::VertexFormat), so it can
+   * go to the GPU as a single vertex buffer and a single index buffer.
+   */
+  struct MeshData {
+    // BakedAsset::MeshAttributes present in each vertex
+    uint32_t attributes{ BakedAsset::POSITION };
+    std::vector<float> vertices;
+    // Every level of detail, one after another
+    std::vector<uint32_t> indices;
+    // The ranges of indices making up each level of detail, most detailed
+    // first.  Empty if all the indices are a single level.
+    std::vector<BakedAsset::MeshLod> lods;
+
+    uint32_t floatsPerVertex() const;
+
+    uint32_t vertexCount() const {
+      return (uint32_t)(vertices.size() / floatsPerVertex());
+    }
+
+    // Axis aligned bounds, and a sphere centered on them that encloses
+    // every vertex, as x, y, z and radius
+    void bounds(float min[3], float max[3], float sphere[4]) const;
+  };
+
+  /**
+   * Decodes a CTM file straight out of memory into interleaved vertices.
+   * Only the attributes that are both in the file and in the mask are
+   * kept.  Throws std::runtime_error if the data can't be decoded.
+   */
+  MeshData decodeCtm(const uint8_t * data, size_t size, uint32_t attributes = ~0u);
+
+  /**
+   * Packs the vertices into a BakedAsset::VertexFormat, ready to upload.
+   * Compact vertices fall back on floats if half floats can't hold the
+   * positions to within 1/512th of the radius of the mesh, say because
+   * it's far from the origin, so the format used is written back.
+   */
+  std::vector<uint8_t> packVertices(const MeshData & mesh, uint32_t & format);
+
+  // Packs the indices as uint16 if they can all be reached with them,
+  // otherwise uint32, and sets indexSize to 2 or 4 to match
+  std::vector<uint8_t> packIndices(const MeshData & mesh, uint32_t & indexSize);
+
+}
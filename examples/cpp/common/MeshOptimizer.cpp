@@ -0,0 +1,296 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+namespace oria {
+
+  static const uint32_t UNUSED = ~0u;
+
+  VertexCacheStats analyzeVertexCache(const uint32_t * indices, size_t indexCount,
+      uint32_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats result;
+    if (!indexCount) {
+      return result;
+    }
+    // A vertex is still in the FIFO if fewer than cacheSize misses have
+    // happened since it went in
+    std::vector<uint32_t> cachedAt(vertexCount, UNUSED);
+    uint32_t misses = 0;
+    uint32_t distinct = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+      uint32_t v = indices[i];
+      if (UNUSED == cachedAt[v]) {
+        ++distinct;
+      } else if (misses - cachedAt[v] < cacheSize) {
+        continue;
+      }
+      cachedAt[v] = misses++;
+    }
+    result.acmr = (float)misses / (float)(indexCount / 3);
+    result.atvr = (float)misses / (float)distinct;
+    return result;
+  }
+
+  // Sorts runs of triangles so that the ones facing furthest out from the
+  // middle of the mesh come first.  Each run starts with a cache miss
+  // anyway, so reordering them keeps most of the cache efficiency.
+  static void sortClusters(const MeshData & mesh, std::vector<uint32_t> & indices,
+      const std::vector<size_t> & clusters) {
+    const uint32_t floats = mesh.floatsPerVertex();
+    const size_t triangleCount = indices.size() / 3;
+    auto position = [&](uint32_t v) {
+      return &mesh.vertices[(size_t)v * floats];
+    };
+
+    struct Cluster {
+      size_t first;
+      size_t end;
+      double centroid[3];
+      double normal[3];
+      double area;
+      double key;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    double meshCentroid[3] = { 0, 0, 0 };
+    double meshArea = 0;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+      Cluster & cluster = sorted[c];
+      cluster.first = clusters[c];
+      cluster.end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+      cluster.area = 0;
+      for (int i = 0; i < 3; ++i) {
+        cluster.centroid[i] = cluster.normal[i] = 0;
+      }
+      for (size_t t = cluster.first; t < cluster.end; ++t) {
+        const float * p0 = position(indices[t * 3]);
+        const float * p1 = position(indices[t * 3 + 1]);
+        const float * p2 = position(indices[t * 3 + 2]);
+        double e1[3], e2[3];
+        for (int i = 0; i < 3; ++i) {
+          e1[i] = p1[i] - p0[i];
+          e2[i] = p2[i] - p0[i];
+        }
+        // Twice the area, pointing along the face normal
+        double n[3] = {
+          e1[1] * e2[2] - e1[2] * e2[1],
+          e1[2] * e2[0] - e1[0] * e2[2],
+          e1[0] * e2[1] - e1[1] * e2[0],
+        };
+        double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (int i = 0; i < 3; ++i) {
+          cluster.centroid[i] += area * (p0[i] + p1[i] + p2[i]) / 3.0;
+          cluster.normal[i] += n[i];
+        }
+        cluster.area += area;
+      }
+      for (int i = 0; i < 3; ++i) {
+        meshCentroid[i] += cluster.centroid[i];
+      }
+      meshArea += cluster.area;
+    }
+    if (meshArea <= 0) {
+      return;
+    }
+    for (int i = 0; i < 3; ++i) {
+      meshCentroid[i] /= meshArea;
+    }
+    for (Cluster & cluster : sorted) {
+      cluster.key = 0;
+      double length = std::sqrt(cluster.normal[0] * cluster.normal[0] +
+        cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+      if (cluster.area > 0 && length > 0) {
+        for (int i = 0; i < 3; ++i) {
+          cluster.key += (cluster.centroid[i] / cluster.area - meshCentroid[i]) * cluster.normal[i] / length;
+        }
+      }
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster & a, const Cluster & b) {
+      return a.key > b.key;
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const Cluster & cluster : sorted) {
+      result.insert(result.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.end * 3);
+    }
+    indices.swap(result);
+  }
+
+  // Tipsify, over one level of detail's triangles
+  static void reorderTriangles(const MeshData & mesh, uint32_t * indices, size_t indexCount,
+      const MeshOptimizeOptions & options) {
+    const uint32_t vertexCount = mesh.vertexCount();
+    const size_t triangleCount = indexCount / 3;
+    const uint32_t cacheSize = options.cacheSize;
+    if (!triangleCount) {
+      return;
+    }
+
+    // The triangles around each vertex, and how many of them are still to
+    // be emitted
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+      if (indices[i] >= vertexCount) {
+        throw std::runtime_error("Mesh index out of range");
+      }
+      ++live[indices[i]];
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+      offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+      std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < triangleCount * 3; ++i) {
+        adjacency[cursor[indices[i]]++] = (uint32_t)(i / 3);
+      }
+    }
+
+    std::vector<uint32_t> cachedAt(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    // Where the output had to jump to a vertex that's not in the cache
+    std::vector<size_t> clusters;
+    deadEnds.reserve(triangleCount * 3);
+    uint32_t time = cacheSize + 1;
+    uint32_t nextVertex = 0;
+
+    // Falls back on recently used vertices, then on the input order
+    auto skipDeadEnd = [&]() -> int64_t {
+      while (!deadEnds.empty()) {
+        uint32_t v = deadEnds.back();
+        deadEnds.pop_back();
+        if (live[v]) {
+          return v;
+        }
+      }
+      for (; nextVertex < vertexCount; ++nextVertex) {
+        if (live[nextVertex]) {
+          return nextVertex;
+        }
+      }
+      return -1;
+    };
+
+    int64_t fanning = skipDeadEnd();
+    clusters.push_back(0);
+    while (fanning >= 0) {
+      candidates.clear();
+      for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+        uint32_t t = adjacency[a];
+        if (emitted[t]) {
+          continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+          uint32_t v = indices[t * 3 + c];
+          output.push_back(v);
+          deadEnds.push_back(v);
+          candidates.push_back(v);
+          --live[v];
+          if (time - cachedAt[v] > cacheSize) {
+            cachedAt[v] = time++;
+          }
+        }
+        emitted[t] = true;
+      }
+
+      // The next fanning vertex is the oldest one that will still be in
+      // the cache once all of its remaining triangles are emitted
+      int64_t best = -1;
+      int64_t bestPriority = -1;
+      for (uint32_t v : candidates) {
+        if (!live[v]) {
+          continue;
+        }
+        int64_t priority = 0;
+        if (time - cachedAt[v] + 2 * live[v] <= cacheSize) {
+          priority = time - cachedAt[v];
+        }
+        if (priority > bestPriority) {
+          bestPriority = priority;
+          best = v;
+        }
+      }
+      if (best < 0) {
+        best = skipDeadEnd();
+        if (best >= 0) {
+          clusters.push_back(output.size() / 3);
+        }
+      }
+      fanning = best;
+    }
+
+    if (options.overdraw && clusters.size() > 1) {
+      sortClusters(mesh, output, clusters);
+    }
+    std::copy(output.begin(), output.end(), indices);
+  }
+
+  void optimizeTriangleOrder(MeshData & mesh, const MeshOptimizeOptions & options) {
+    if (mesh.lods.empty()) {
+      reorderTriangles(mesh, mesh.indices.data(), mesh.indices.size(), options);
+      return;
+    }
+    for (const BakedAsset::MeshLod & lod : mesh.lods) {
+      reorderTriangles(mesh, mesh.indices.data() + lod.firstIndex, lod.indexCount, options);
+    }
+  }
+
+  void optimizeVertexOrder(MeshData & mesh) {
+    const uint32_t floats = mesh.floatsPerVertex();
+    const uint32_t vertexCount = mesh.vertexCount();
+    std::vector<uint32_t> remap(vertexCount, UNUSED);
+    uint32_t next = 0;
+    for (uint32_t & index : mesh.indices) {
+      if (index >= vertexCount) {
+        throw std::runtime_error("Mesh index out of range");
+      }
+      if (UNUSED == remap[index]) {
+        remap[index] = next++;
+      }
+      index = remap[index];
+    }
+
+    std::vector<float> vertices((size_t)next * floats);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+      if (UNUSED != remap[v]) {
+        std::copy(mesh.vertices.begin() + (size_t)v * floats, mesh.vertices.begin() + (size_t)(v + 1) * floats,
+          vertices.begin() + (size_t)remap[v] * floats);
+      }
+    }
+    mesh.vertices.swap(vertices);
+  }
+
+  void optimizeMesh(MeshData & mesh, const MeshOptimizeOptions & options) {
+    optimizeTriangleOrder(mesh, options);
+    optimizeVertexOrder(mesh);
+  }
+
+}
@@ -0,0 +1,70 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#pragma once
+
+// Shared with the bake_assets tool, so it must not depend on anything
+// pulled in by Common.h
+#include <cstddef>
+#include <cstdint>
+
+#include "MeshData.h"
+
+namespace oria {
+
+  struct VertexCacheStats {
+    // Average cache miss ratio, the vertices transformed per triangle.  3 
+    // is the worst case, and a large regular grid approaches 0.5.
+    float acmr{ 0 };
+    // Average transform to vertex ratio, the vertices transformed per 
+    // distinct vertex referenced.  1 is ideal.
+    float atvr{ 0 };
+  };
+
+  struct MeshOptimizeOptions {
+    // Entries in the FIFO post-transform cache to optimize for
+    uint32_t cacheSize{ 16 };
+    // Sort the clusters of triangles so the ones facing away from the 
+    // middle of the mesh draw first, hiding more of what follows.  Only 
+    // worth it for opaque meshes, and costs a little cache efficiency.
+    bool overdraw{ false };
+  };
+
+  // Simulates a FIFO post-transform cache over a triangle list
+  VertexCacheStats analyzeVertexCache(const uint32_t * indices, size_t indexCount,
+    uint32_t vertexCount, uint32_t cacheSize = 16);
+
+  /**
+   * Reorders the triangles for post-transform cache locality, with the 
+   * Tipsify algorithm of Sander, Nehab and Barczak, "Fast Triangle 
+   * Reordering for Vertex Locality and Reduced Overdraw".  It runs in 
+   * linear time, so it's cheap enough to use at load time.  Each level of
+   * detail is reordered on its own.
+   */
+  void optimizeTriangleOrder(MeshData & mesh, const MeshOptimizeOptions & options = MeshOptimizeOptions());
+
+  // Reorders the vertices into the order the triangles first use them, so
+  // vertex fetches walk through memory.  Unreferenced vertices are dropped.
+  void optimizeVertexOrder(MeshData & mesh);
+
+  // Both of the above, triangles first
+  void optimizeMesh(MeshData & mesh, const MeshOptimizeOptions & options = MeshOptimizeOptions());
+
+}
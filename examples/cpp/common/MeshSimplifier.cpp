@@ -0,0 +1,298 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "MeshSimplifier.h"
+
+namespace oria {
+
+  // A symmetric 4x4 matrix, summing the squared distances to a set of
+  // planes.  The upper triangle is stored, row by row.
+  struct Quadric {
+    double m[10];
+
+    Quadric() {
+      std::fill(m, m + 10, 0.0);
+    }
+
+    void addPlane(double a, double b, double c, double d) {
+      m[0] += a * a; m[1] += a * b; m[2] += a * c; m[3] += a * d;
+      m[4] += b * b; m[5] += b * c; m[6] += b * d;
+      m[7] += c * c; m[8] += c * d;
+      m[9] += d * d;
+    }
+
+    void add(const Quadric & other) {
+      for (int i = 0; i < 10; ++i) {
+        m[i] += other.m[i];
+      }
+    }
+
+    double error(const float * p) const {
+      double x = p[0], y = p[1], z = p[2];
+      return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+        + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+        + m[7] * z * z + 2 * m[8] * z
+        + m[9];
+    }
+  };
+
+  struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    bool operator > (const Collapse & other) const {
+      return cost > other.cost;
+    }
+  };
+
+  static void cross(const double a[3], const double b[3], double out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+  }
+
+  static void triangleNormal(const float * p0, const float * p1, const float * p2, double out[3]) {
+    double e1[3], e2[3];
+    for (int i = 0; i < 3; ++i) {
+      e1[i] = p1[i] - p0[i];
+      e2[i] = p2[i] - p0[i];
+    }
+    cross(e1, e2, out);
+  }
+
+  std::vector<uint32_t> simplifyTriangles(const MeshData & mesh, const uint32_t * indices,
+      size_t indexCount, size_t targetIndexCount, float & error) {
+    const uint32_t floats = mesh.floatsPerVertex();
+    const uint32_t vertexCount = mesh.vertexCount();
+    const size_t triangleCount = indexCount / 3;
+    auto position = [&](uint32_t v) {
+      return &mesh.vertices[(size_t)v * floats];
+    };
+    error = 0;
+
+    std::vector<uint32_t> triangles(indices, indices + triangleCount * 3);
+    std::vector<bool> removed(triangleCount, false);
+    std::vector<std::vector<uint32_t>> around(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+    // Triangles per undirected edge, keyed by the vertices, lowest first
+    std::unordered_map<uint64_t, uint32_t> edges;
+    edges.reserve(triangleCount * 3);
+    auto edgeKey = [](uint32_t a, uint32_t b) {
+      return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    };
+
+    for (size_t t = 0; t < triangleCount; ++t) {
+      const uint32_t * tri = &triangles[t * 3];
+      for (int c = 0; c < 3; ++c) {
+        if (tri[c] >= vertexCount) {
+          throw std::runtime_error("Mesh index out of range");
+        }
+        around[tri[c]].push_back((uint32_t)t);
+        ++edges[edgeKey(tri[c], tri[(c + 1) % 3])];
+      }
+      double n[3];
+      triangleNormal(position(tri[0]), position(tri[1]), position(tri[2]), n);
+      double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      if (length <= 0) {
+        continue;
+      }
+      for (int i = 0; i < 3; ++i) {
+        n[i] /= length;
+      }
+      const float * p = position(tri[0]);
+      double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+      for (int c = 0; c < 3; ++c) {
+        quadrics[tri[c]].addPlane(n[0], n[1], n[2], d);
+      }
+    }
+
+    // Vertices on an open or non-manifold edge never move
+    std::vector<bool> locked(vertexCount, false);
+    for (const auto & edge : edges) {
+      if (2 != edge.second) {
+        locked[(uint32_t)(edge.first >> 32)] = true;
+        locked[(uint32_t)edge.first] = true;
+      }
+    }
+
+    std::vector<uint32_t> version(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    // Queues the cheaper way of collapsing the edge, if either is allowed
+    auto consider = [&](uint32_t a, uint32_t b) {
+      Quadric q = quadrics[a];
+      q.add(quadrics[b]);
+      Collapse collapse;
+      collapse.cost = -1;
+      if (!locked[a]) {
+        collapse.cost = q.error(position(b));
+        collapse.from = a;
+        collapse.to = b;
+      }
+      if (!locked[b]) {
+        double cost = q.error(position(a));
+        if (collapse.cost < 0 || cost < collapse.cost) {
+          collapse.cost = cost;
+          collapse.from = b;
+          collapse.to = a;
+        }
+      }
+      if (collapse.cost >= 0) {
+        collapse.fromVersion = version[collapse.from];
+        collapse.toVersion = version[collapse.to];
+        queue.push(collapse);
+      }
+    };
+    for (const auto & edge : edges) {
+      consider((uint32_t)(edge.first >> 32), (uint32_t)edge.first);
+    }
+
+    // Moving a vertex mustn't turn any of the triangles it keeps over
+    auto flips = [&](uint32_t from, uint32_t to) {
+      for (uint32_t t : around[from]) {
+        const uint32_t * tri = &triangles[t * 3];
+        if (removed[t] || to == tri[0] || to == tri[1] || to == tri[2]) {
+          continue;
+        }
+        const float * before[3];
+        const float * after[3];
+        for (int c = 0; c < 3; ++c) {
+          before[c] = position(tri[c]);
+          after[c] = from == tri[c] ? position(to) : before[c];
+        }
+        double n0[3], n1[3];
+        triangleNormal(before[0], before[1], before[2], n0);
+        triangleNormal(after[0], after[1], after[2], n1);
+        if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0) {
+          return true;
+        }
+      }
+      return false;
+    };
+
+    size_t remaining = triangleCount;
+    double worst = 0;
+    std::vector<uint32_t> neighbors;
+    while (remaining * 3 > targetIndexCount && !queue.empty()) {
+      Collapse collapse = queue.top();
+      queue.pop();
+      uint32_t from = collapse.from, to = collapse.to;
+      if (collapse.fromVersion != version[from] || collapse.toVersion != version[to] ||
+          flips(from, to)) {
+        continue;
+      }
+
+      worst = std::max(worst, collapse.cost);
+      neighbors.clear();
+      for (uint32_t t : around[from]) {
+        uint32_t * tri = &triangles[t * 3];
+        if (removed[t]) {
+          continue;
+        }
+        if (to == tri[0] || to == tri[1] || to == tri[2]) {
+          removed[t] = true;
+          --remaining;
+          continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+          if (from == tri[c]) {
+            tri[c] = to;
+          }
+        }
+        around[to].push_back(t);
+      }
+      quadrics[to].add(quadrics[from]);
+      around[from].clear();
+      // Invalidates every queued collapse involving either vertex
+      ++version[from];
+      ++version[to];
+      locked[from] = true;
+
+      for (uint32_t t : around[to]) {
+        if (!removed[t]) {
+          neighbors.insert(neighbors.end(), &triangles[t * 3], &triangles[t * 3 + 3]);
+        }
+      }
+      std::sort(neighbors.begin(), neighbors.end());
+      neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+      for (uint32_t v : neighbors) {
+        if (v != to) {
+          consider(to, v);
+        }
+      }
+      // Drop the removed triangles, so the list doesn't keep growing
+      around[to].erase(std::remove_if(around[to].begin(), around[to].end(), [&](uint32_t t) {
+        return removed[t];
+      }), around[to].end());
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(remaining * 3);
+    for (size_t t = 0; t < triangleCount; ++t) {
+      if (!removed[t]) {
+        result.insert(result.end(), &triangles[t * 3], &triangles[t * 3 + 3]);
+      }
+    }
+    // The quadric error is a sum of squared distances to planes, so its
+    // root bounds the distance to any one of them
+    error = (float)std::sqrt(std::max(0.0, worst));
+    return result;
+  }
+
+  void buildLods(MeshData & mesh, const LodOptions & options) {
+    if (!mesh.lods.empty() || mesh.indices.empty()) {
+      return;
+    }
+    BakedAsset::MeshLod full = { 0, (uint32_t)mesh.indices.size(), 0, 0 };
+    mesh.lods.push_back(full);
+    uint32_t maxLods = std::min<uint32_t>(options.maxLods, +BakedAsset::MAX_LODS);
+    while (mesh.lods.size() < maxLods) {
+      const BakedAsset::MeshLod previous = mesh.lods.back();
+      size_t target = (size_t)(previous.indexCount / 3 * options.ratio) * 3;
+      if (target < options.minTriangles * 3) {
+        break;
+      }
+      float error;
+      std::vector<uint32_t> simplified = simplifyTriangles(mesh,
+        mesh.indices.data() + previous.firstIndex, previous.indexCount, target, error);
+      // Not worth the memory if it barely got any simpler
+      if (simplified.size() > previous.indexCount * 0.8) {
+        break;
+      }
+      // Simplified from the level before, so the errors add up
+      BakedAsset::MeshLod lod = { (uint32_t)mesh.indices.size(), (uint32_t)simplified.size(),
+        previous.error + error, 0 };
+      mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+      mesh.lods.push_back(lod);
+    }
+    if (1 == mesh.lods.size()) {
+      mesh.lods.clear();
+    }
+  }
+
+}
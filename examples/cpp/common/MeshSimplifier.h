@@ -0,0 +1,61 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#pragma once
+
+// Shared with the bake_assets tool, so it must not depend on anything
+// pulled in by Common.h
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshData.h"
+
+namespace oria {
+
+  struct LodOptions {
+    // Including the full mesh, at most BakedAsset::MAX_LODS
+    uint32_t maxLods{ BakedAsset::MAX_LODS };
+    // Triangles each level keeps, relative to the one before
+    float ratio{ 0.5f };
+    // No level is simplified below this
+    uint32_t minTriangles{ 64 };
+  };
+
+  /**
+   * Garland and Heckbert's quadric error simplification, collapsing edges
+   * onto one of their own vertices so the result can share the vertex
+   * buffer.  Triangles are removed until at most targetIndexCount indices
+   * remain, or no collapse is left that wouldn't flip a triangle.  Edges
+   * with only one triangle, which includes seams where the normals or
+   * texture coordinates split a vertex, are left in place so no cracks
+   * open up.
+   *
+   * The remaining triangles keep their order.  error gets an upper bound
+   * on how far the surface moved, in the mesh's units.
+   */
+  std::vector<uint32_t> simplifyTriangles(const MeshData & mesh, const uint32_t * indices,
+    size_t indexCount, size_t targetIndexCount, float & error);
+
+  // Appends successively simpler levels of detail to a single level mesh,
+  // stopping early if the simplification stalls
+  void buildLods(MeshData & mesh, const LodOptions & options = LodOptions());
+
+}
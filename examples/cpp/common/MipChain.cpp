@@ -0,0 +1,355 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+// Built into both the examples and the bake_assets tool, so this includes
+// only what it needs rather than Common.h
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "MipChain.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MIPS_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MIPS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace oria {
+
+  // Levels are filtered as 4 floats per texel, whatever the channel count,
+  // so every texel is a single SIMD register
+#if defined(MIPS_SSE)
+  typedef __m128 Vec4;
+  static inline Vec4 vzero() { return _mm_setzero_ps(); }
+  static inline Vec4 vload(const float * p) { return _mm_loadu_ps(p); }
+  static inline void vstore(float * p, Vec4 v) { _mm_storeu_ps(p, v); }
+  static inline Vec4 vmadd(Vec4 acc, Vec4 v, float w) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w))); }
+#elif defined(MIPS_NEON)
+  typedef float32x4_t Vec4;
+  static inline Vec4 vzero() { return vdupq_n_f32(0); }
+  static inline Vec4 vload(const float * p) { return vld1q_f32(p); }
+  static inline void vstore(float * p, Vec4 v) { vst1q_f32(p, v); }
+  static inline Vec4 vmadd(Vec4 acc, Vec4 v, float w) { return vmlaq_n_f32(acc, v, w); }
+#else
+  struct Vec4 { float v[4]; };
+  static inline Vec4 vzero() { Vec4 r = { { 0, 0, 0, 0 } }; return r; }
+  static inline Vec4 vload(const float * p) { Vec4 r = { { p[0], p[1], p[2], p[3] } }; return r; }
+  static inline void vstore(float * p, Vec4 v) { std::copy(v.v, v.v + 4, p); }
+  static inline Vec4 vmadd(Vec4 acc, Vec4 v, float w) {
+    for (int i = 0; i < 4; ++i) {
+      acc.v[i] += v.v[i] * w;
+    }
+    return acc;
+  }
+#endif
+
+  ///////////////////////////////////////////////////////////////////////////
+  // Transfer functions
+
+  static float srgbToLinear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+  }
+
+  static float linearToSrgb(float c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+  }
+
+  // 16 bits of linear precision are enough to land on the right 8 bit
+  // sRGB value even in the darkest steps, where 12 bits are not
+  struct TransferTables {
+    static const int ENCODE_SIZE = 1 << 16;
+    float decode[256];
+    float decodeLinear[256];
+    uint8_t encode[ENCODE_SIZE];
+
+    TransferTables() {
+      for (int i = 0; i < 256; ++i) {
+        decode[i] = srgbToLinear(i / 255.0f);
+        decodeLinear[i] = i / 255.0f;
+      }
+      for (int i = 0; i < ENCODE_SIZE; ++i) {
+        float value = linearToSrgb(i / (float)(ENCODE_SIZE - 1));
+        encode[i] = (uint8_t)(value * 255.0f + 0.5f);
+      }
+    }
+  };
+
+  static const TransferTables & tables() {
+    static TransferTables instance;
+    return instance;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////
+  // Filter kernels
+
+  static float sinc(float x) {
+    if (std::fabs(x) < 1e-6f) {
+      return 1.0f;
+    }
+    const float PI = 3.14159265358979f;
+    return std::sin(PI * x) / (PI * x);
+  }
+
+  // Zeroth order modified Bessel function of the first kind
+  static float bessel0(float x) {
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 32; ++k) {
+      float t = x / (2.0f * k);
+      term *= t * t;
+      sum += term;
+      if (term < sum * 1e-8f) {
+        break;
+      }
+    }
+    return sum;
+  }
+
+  // Width and alpha as in the usual offline tools
+  static const float KAISER_WIDTH = 3.0f;
+  static const float KAISER_ALPHA = 4.0f;
+
+  static float kaiser(float x) {
+    float t = x / KAISER_WIDTH;
+    if (t * t >= 1.0f) {
+      return 0.0f;
+    }
+    return sinc(x) * bessel0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / bessel0(KAISER_ALPHA);
+  }
+
+  // The source texels contributing to one output texel, and their weights.
+  // Indices past the edges are clamped.
+  struct Contribution {
+    int first;
+    std::vector<float> weights;
+  };
+
+  static std::vector<Contribution> computeContributions(uint32_t source, uint32_t target, MipFilter filter) {
+    const float scale = (float)source / target;
+    std::vector<Contribution> result(target);
+    for (uint32_t i = 0; i < target; ++i) {
+      Contribution & c = result[i];
+      float begin = i * scale, end = (i + 1) * scale;
+      if (MIP_KAISER == filter) {
+        float center = (begin + end) / 2.0f;
+        float radius = KAISER_WIDTH * scale;
+        c.first = (int)std::floor(center - radius);
+        int last = (int)std::ceil(center + radius);
+        for (int j = c.first; j <= last; ++j) {
+          // Distance in output texels
+          c.weights.push_back(kaiser((j + 0.5f - center) / scale));
+        }
+      } else {
+        // Each source texel counts by how much of it the output covers
+        c.first = (int)std::floor(begin);
+        int last = std::min((int)std::ceil(end), (int)source) - 1;
+        for (int j = c.first; j <= last; ++j) {
+          float overlap = std::min(end, j + 1.0f) - std::max(begin, (float)j);
+          c.weights.push_back(std::max(0.0f, overlap));
+        }
+      }
+      float total = 0;
+      for (size_t k = 0; k < c.weights.size(); ++k) {
+        total += c.weights[k];
+      }
+      for (size_t k = 0; k < c.weights.size(); ++k) {
+        c.weights[k] /= total;
+      }
+    }
+    return result;
+  }
+
+  static inline int clampIndex(int i, uint32_t size) {
+    return std::min(std::max(i, 0), (int)size - 1);
+  }
+
+  ///////////////////////////////////////////////////////////////////////////
+
+  // Runs f(begin, end) over ranges of rows, on the pool if there is one
+  template <typename F>
+  static void forRows(ThreadPool * pool, uint32_t rows, size_t rowWork, F f) {
+    // Aim for chunks big enough to be worth handing to another thread
+    const size_t MIN_CHUNK_WORK = 1 << 14;
+    uint32_t chunkRows = (uint32_t)std::max<size_t>(1, MIN_CHUNK_WORK / std::max<size_t>(1, rowWork));
+    uint32_t chunks = (rows + chunkRows - 1) / chunkRows;
+    if (!pool || chunks < 2) {
+      f(0, rows);
+      return;
+    }
+    pool->parallelFor(chunks, [&](size_t chunk) {
+      uint32_t begin = (uint32_t)chunk * chunkRows;
+      f(begin, std::min(rows, begin + chunkRows));
+    });
+  }
+
+  // The linear light working copy of a level
+  struct FloatImage {
+    uint32_t width{ 0 };
+    uint32_t height{ 0 };
+    std::vector<float> texels;
+
+    float * row(uint32_t y) {
+      return &texels[(size_t)y * width * 4];
+    }
+    const float * row(uint32_t y) const {
+      return &texels[(size_t)y * width * 4];
+    }
+  };
+
+  static bool isAlpha(int channels, int c) {
+    return (2 == channels || 4 == channels) && c == channels - 1;
+  }
+
+  static void decodeLevel(const uint8_t * pixels, size_t stride, int channels,
+      const MipOptions & options, FloatImage & out) {
+    const TransferTables & t = tables();
+    const float * decode[4];
+    for (int c = 0; c < 4; ++c) {
+      decode[c] = (options.srgb && !isAlpha(channels, c)) ? t.decode : t.decodeLinear;
+    }
+    out.texels.assign((size_t)out.width * out.height * 4, 0.0f);
+    forRows(options.pool, out.height, out.width, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t y = begin; y < end; ++y) {
+        const uint8_t * in = pixels + y * stride;
+        float * result = out.row(y);
+        for (uint32_t x = 0; x < out.width; ++x, in += channels, result += 4) {
+          for (int c = 0; c < channels; ++c) {
+            result[c] = decode[c][in[c]];
+          }
+        }
+      }
+    });
+  }
+
+  static void encodeLevel(const FloatImage & level, int channels, const MipOptions & options, MipLevel & out) {
+    const TransferTables & t = tables();
+    bool gamma[4];
+    for (int c = 0; c < 4; ++c) {
+      gamma[c] = options.srgb && !isAlpha(channels, c);
+    }
+    out.width = level.width;
+    out.height = level.height;
+    out.pixels.resize((size_t)level.width * level.height * channels);
+    forRows(options.pool, level.height, level.width, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t y = begin; y < end; ++y) {
+        const float * in = level.row(y);
+        uint8_t * result = &out.pixels[(size_t)y * level.width * channels];
+        for (uint32_t x = 0; x < level.width; ++x, in += 4, result += channels) {
+          for (int c = 0; c < channels; ++c) {
+            // The Kaiser filter's negative lobes can overshoot
+            float value = std::min(std::max(in[c], 0.0f), 1.0f);
+            if (gamma[c]) {
+              result[c] = t.encode[(int)(value * (TransferTables::ENCODE_SIZE - 1) + 0.5f)];
+            } else {
+              result[c] = (uint8_t)(value * 255.0f + 0.5f);
+            }
+          }
+        }
+      }
+    });
+  }
+
+  // Separable resample, horizontally into a temporary and then vertically
+  static void downsample(const FloatImage & source, FloatImage & target, const MipOptions & options) {
+    std::vector<Contribution> columns = computeContributions(source.width, target.width, options.filter);
+    std::vector<Contribution> rows = computeContributions(source.height, target.height, options.filter);
+
+    FloatImage temp;
+    temp.width = target.width;
+    temp.height = source.height;
+    temp.texels.resize((size_t)temp.width * temp.height * 4);
+    forRows(options.pool, temp.height, temp.width * 4, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t y = begin; y < end; ++y) {
+        const float * in = source.row(y);
+        float * out = temp.row(y);
+        for (uint32_t x = 0; x < temp.width; ++x) {
+          const Contribution & c = columns[x];
+          Vec4 sum = vzero();
+          for (size_t k = 0; k < c.weights.size(); ++k) {
+            int index = clampIndex(c.first + (int)k, source.width);
+            sum = vmadd(sum, vload(in + index * 4), c.weights[k]);
+          }
+          vstore(out + x * 4, sum);
+        }
+      }
+    });
+
+    target.texels.resize((size_t)target.width * target.height * 4);
+    const size_t rowFloats = (size_t)target.width * 4;
+    forRows(options.pool, target.height, rowFloats * 2, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t y = begin; y < end; ++y) {
+        const Contribution & c = rows[y];
+        float * out = target.row(y);
+        for (size_t i = 0; i < rowFloats; i += 4) {
+          vstore(out + i, vzero());
+        }
+        for (size_t k = 0; k < c.weights.size(); ++k) {
+          const float * in = temp.row(clampIndex(c.first + (int)k, temp.height));
+          float w = c.weights[k];
+          for (size_t i = 0; i < rowFloats; i += 4) {
+            vstore(out + i, vmadd(vload(out + i), vload(in + i), w));
+          }
+        }
+      }
+    });
+  }
+
+  uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while (width > 1 || height > 1) {
+      width = std::max(1u, width / 2);
+      height = std::max(1u, height / 2);
+      ++levels;
+    }
+    return levels;
+  }
+
+  std::vector<MipLevel> buildMipChain(const uint8_t * pixels, uint32_t width, uint32_t height,
+      size_t stride, int channels, const MipOptions & options) {
+    std::vector<MipLevel> result;
+    if (channels < 1 || channels > 4) {
+      throw std::runtime_error("Mip chains need 1 to 4 channels");
+    }
+    uint32_t levels = std::min(options.maxLevels, mipLevelCount(width, height));
+    if (MIP_NONE == options.filter || levels < 2) {
+      return result;
+    }
+
+    // Each level is filtered from the one above it, so the levels have to
+    // be built in order, but the rows of each one are independent
+    FloatImage current;
+    current.width = width;
+    current.height = height;
+    decodeLevel(pixels, stride, channels, options, current);
+    result.resize(levels - 1);
+    for (uint32_t i = 1; i < levels; ++i) {
+      FloatImage next;
+      next.width = std::max(1u, current.width / 2);
+      next.height = std::max(1u, current.height / 2);
+      downsample(current, next, options);
+      encodeLevel(next, channels, options, result[i - 1]);
+      std::swap(current, next);
+    }
+    return result;
+  }
+
+}
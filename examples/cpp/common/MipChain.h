@@ -0,0 +1,74 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+// Shared with the bake_assets tool, so it must not depend on anything
+// pulled in by Common.h
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+namespace oria {
+
+  enum MipFilter {
+    // Leave the texture with a single level
+    MIP_NONE = 0,
+    // Average of the texels each output texel covers.  Cheap, slightly soft.
+    MIP_BOX,
+    // Kaiser windowed sinc, as used by most offline texture tools.  Sharper,
+    // at several times the cost of the box filter.
+    MIP_KAISER,
+  };
+
+  struct MipLevel {
+    uint32_t width{ 0 };
+    uint32_t height{ 0 };
+    // Tightly packed, with the same channels as the source image
+    std::vector<uint8_t> pixels;
+  };
+
+  struct MipOptions {
+    MipFilter filter{ MIP_BOX };
+    // Filter the color channels in linear light.  Averaging the encoded
+    // values directly darkens every level below the first.
+    bool srgb{ true };
+    // Including the base level
+    uint32_t maxLevels{ 16 };
+    // If set, the rows of each level are split across the pool
+    ThreadPool * pool{ nullptr };
+  };
+
+  /**
+   * Builds the levels below an 8 bit image of 1 to 4 channels, halving
+   * each dimension (rounding down, to a minimum of one) until both reach
+   * one.  The base level isn't copied, so the result starts at level 1.
+   *
+   * With 2 or 4 channels the last one is treated as linear alpha.  Row
+   * order doesn't matter, since the filters are symmetric.
+   */
+  std::vector<MipLevel> buildMipChain(const uint8_t * pixels, uint32_t width, uint32_t height,
+    size_t stride, int channels, const MipOptions & options = MipOptions());
+
+  // The number of levels a full chain for an image of this size has
+  uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+}
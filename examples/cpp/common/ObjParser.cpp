@@ -0,0 +1,518 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "ObjParser.h"
+#include "ThreadPool.h"
+
+namespace oria {
+
+  // Smaller files aren't worth the overhead of splitting
+  static const size_t CHUNK_BYTES = 1 << 22;
+  static const int32_t NO_INDEX = -1;
+
+  // Position, texture coordinate and normal numbers of a face corner,
+  // counted from zero, or NO_INDEX.  Relative (negative) numbers can't be
+  // resolved until the chunks before are counted, so they're stored
+  // relative to the start of the chunk and flagged.
+  struct ObjCorner {
+    int32_t index[3];
+    uint8_t relative;
+  };
+
+  struct ObjFace {
+    uint32_t cornerCount;
+    // Into the chunk's materials, or NO_INDEX for whatever was in use at
+    // the end of the chunk before
+    int32_t material;
+  };
+
+  struct ObjChunk {
+    std::vector<float> positions;
+    std::vector<float> texCoords;
+    std::vector<float> normals;
+    std::vector<ObjCorner> corners;
+    std::vector<ObjFace> faces;
+    // In order of first use in the chunk
+    std::vector<std::string> materials;
+    int32_t lastMaterial{ NO_INDEX };
+  };
+
+  static inline bool isBlank(char c) {
+    return ' ' == c || '\t' == c || '\r' == c;
+  }
+
+  static inline const char * skipBlanks(const char * p, const char * end) {
+    while (p < end && isBlank(*p)) {
+      ++p;
+    }
+    return p;
+  }
+
+  static inline bool isDigit(char c) {
+    return (unsigned)(c - '0') < 10;
+  }
+
+  static inline const char * parseInt(const char * p, const char * end, int32_t & out) {
+    bool negative = p < end && '-' == *p;
+    if (p < end && ('-' == *p || '+' == *p)) {
+      ++p;
+    }
+    if (p == end || !isDigit(*p)) {
+      throw std::runtime_error("Bad OBJ index");
+    }
+    int64_t value = 0;
+    while (p < end && isDigit(*p)) {
+      value = std::min<int64_t>(value * 10 + (*p++ - '0'), INT32_MAX);
+    }
+    out = (int32_t)(negative ? -value : value);
+    return p;
+  }
+
+  /**
+   * Up to 19 significant digits are gathered into an integer, which a
+   * power of ten then scales.  Within 10^22 the power is exact in a double,
+   * so the result is the closest double, and rounding that to a float is
+   * off by at most an ulp from strtof.  Several times faster, and it
+   * doesn't need the data null terminated.
+   */
+  static inline const char * parseFloat(const char * p, const char * end, float & out) {
+    static const double POWERS[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    p = skipBlanks(p, end);
+    bool negative = p < end && '-' == *p;
+    if (p < end && ('-' == *p || '+' == *p)) {
+      ++p;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for (; p < end && isDigit(*p); ++p, any = true) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += (0 != mantissa);
+      } else {
+        ++exponent;
+      }
+    }
+    if (p < end && '.' == *p) {
+      for (++p; p < end && isDigit(*p); ++p, any = true) {
+        if (digits < 19) {
+          mantissa = mantissa * 10 + (*p - '0');
+          digits += (0 != mantissa);
+          --exponent;
+        }
+      }
+    }
+    if (!any) {
+      throw std::runtime_error("Bad OBJ number");
+    }
+    if (p < end && ('e' == *p || 'E' == *p)) {
+      int32_t power;
+      p = parseInt(p + 1, end, power);
+      exponent += std::max(-1000, std::min(1000, power));
+    }
+    double value = (double)mantissa;
+    if (0 == mantissa) {
+      value = 0;
+    } else if (exponent < 0 && exponent >= -22) {
+      value /= POWERS[-exponent];
+    } else if (exponent >= 0 && exponent <= 22) {
+      value *= POWERS[exponent];
+    } else {
+      value *= std::pow(10.0, exponent);
+    }
+    out = (float)(negative ? -value : value);
+    return p;
+  }
+
+  // Parses count floats into the end of out.  Any beyond are ignored, any
+  // missing are zero.
+  static inline void parseFloats(const char * p, const char * end, int count, std::vector<float> & out) {
+    for (int i = 0; i < count; ++i) {
+      float value = 0;
+      p = skipBlanks(p, end);
+      if (p < end && '#' != *p) {
+        p = parseFloat(p, end, value);
+      }
+      out.push_back(value);
+    }
+  }
+
+  // Resolves a 1 based, possibly negative (relative) OBJ number against the
+  // number of elements the chunk has seen so far
+  static inline int32_t cornerIndex(int32_t number, size_t count, uint8_t bit, uint8_t & relative) {
+    if (number > 0) {
+      return number - 1;
+    }
+    if (number < 0) {
+      relative |= bit;
+      return (int32_t)count + number;
+    }
+    throw std::runtime_error("Bad OBJ index 0");
+  }
+
+  static void parseFace(const char * p, const char * end, ObjChunk & chunk, int32_t material) {
+    ObjFace face = { 0, material };
+    while (true) {
+      p = skipBlanks(p, end);
+      if (p == end || '#' == *p) {
+        break;
+      }
+      ObjCorner corner = { { NO_INDEX, NO_INDEX, NO_INDEX }, 0 };
+      int32_t number;
+      p = parseInt(p, end, number);
+      corner.index[0] = cornerIndex(number, chunk.positions.size() / 3, 1, corner.relative);
+      if (p < end && '/' == *p) {
+        ++p;
+        if (p < end && '/' != *p) {
+          p = parseInt(p, end, number);
+          corner.index[1] = cornerIndex(number, chunk.texCoords.size() / 2, 2, corner.relative);
+        }
+        if (p < end && '/' == *p) {
+          p = parseInt(p + 1, end, number);
+          corner.index[2] = cornerIndex(number, chunk.normals.size() / 3, 4, corner.relative);
+        }
+      }
+      if (p < end && !isBlank(*p)) {
+        throw std::runtime_error("Bad OBJ face");
+      }
+      chunk.corners.push_back(corner);
+      ++face.cornerCount;
+    }
+    chunk.faces.push_back(face);
+  }
+
+  static void parseChunk(const char * p, const char * end, ObjChunk & chunk) {
+    std::unordered_map<std::string, int32_t> materials;
+    int32_t material = NO_INDEX;
+    while (p < end) {
+      const char * lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+      if (!lineEnd) {
+        lineEnd = end;
+      }
+      p = skipBlanks(p, lineEnd);
+      size_t length = lineEnd - p;
+      if (length > 1 && 'v' == p[0] && isBlank(p[1])) {
+        parseFloats(p + 2, lineEnd, 3, chunk.positions);
+      } else if (length > 2 && 'v' == p[0] && 'n' == p[1] && isBlank(p[2])) {
+        parseFloats(p + 3, lineEnd, 3, chunk.normals);
+      } else if (length > 2 && 'v' == p[0] && 't' == p[1] && isBlank(p[2])) {
+        parseFloats(p + 3, lineEnd, 2, chunk.texCoords);
+      } else if (length > 1 && 'f' == p[0] && isBlank(p[1])) {
+        parseFace(p + 2, lineEnd, chunk, material);
+      } else if (length > 6 && 0 == memcmp(p, "usemtl", 6) && isBlank(p[6])) {
+        const char * name = skipBlanks(p + 7, lineEnd);
+        const char * nameEnd = name;
+        while (nameEnd < lineEnd && !isBlank(*nameEnd)) {
+          ++nameEnd;
+        }
+        auto inserted = materials.insert(std::make_pair(std::string(name, nameEnd), (int32_t)materials.size()));
+        if (inserted.second) {
+          chunk.materials.push_back(inserted.first->first);
+        }
+        material = chunk.lastMaterial = inserted.first->second;
+      }
+      if (lineEnd == end) {
+        break;
+      }
+      p = lineEnd + 1;
+    }
+  }
+
+  // The key a vertex is de-duplicated by
+  struct ObjVertex {
+    int32_t position;
+    int32_t texCoord;
+    int32_t normal;
+    int32_t material;
+
+    bool operator == (const ObjVertex & other) const {
+      return position == other.position && texCoord == other.texCoord &&
+        normal == other.normal && material == other.material;
+    }
+  };
+
+  /**
+   * Open addressing with linear probing, holding only the vertex numbers.
+   * The keys stay in the vertex list, in order of first use, which is the
+   * order the vertices come out in.
+   */
+  class ObjVertexMap {
+    std::vector<uint32_t> slots;
+    size_t mask;
+
+    static size_t hash(const ObjVertex & v) {
+      uint64_t h = (uint64_t)(uint32_t)v.position * 0x9E3779B97F4A7C15ull;
+      h ^= ((uint64_t)(uint32_t)v.texCoord << 32 | (uint32_t)v.normal) * 0xC2B2AE3D27D4EB4Full;
+      h ^= (uint64_t)(uint32_t)v.material * 0x165667B19E3779F9ull;
+      return (size_t)(h ^ (h >> 29));
+    }
+
+    void grow() {
+      std::vector<uint32_t> old;
+      old.swap(slots);
+      slots.assign(old.size() * 2, UINT32_MAX);
+      mask = slots.size() - 1;
+      for (uint32_t index : old) {
+        if (UINT32_MAX != index) {
+          size_t slot = hash(vertices[index]) & mask;
+          while (UINT32_MAX != slots[slot]) {
+            slot = (slot + 1) & mask;
+          }
+          slots[slot] = index;
+        }
+      }
+    }
+
+  public:
+    std::vector<ObjVertex> vertices;
+
+    explicit ObjVertexMap(size_t expected) {
+      size_t capacity = 1024;
+      while (capacity < expected * 2) {
+        capacity *= 2;
+      }
+      slots.assign(capacity, UINT32_MAX);
+      mask = capacity - 1;
+      vertices.reserve(expected);
+    }
+
+    uint32_t find(const ObjVertex & vertex) {
+      size_t slot = hash(vertex) & mask;
+      while (UINT32_MAX != slots[slot]) {
+        if (vertices[slots[slot]] == vertex) {
+          return slots[slot];
+        }
+        slot = (slot + 1) & mask;
+      }
+      uint32_t index = (uint32_t)vertices.size();
+      slots[slot] = index;
+      vertices.push_back(vertex);
+      if (vertices.size() * 2 > slots.size()) {
+        grow();
+      }
+      return index;
+    }
+  };
+
+  static void appendAll(std::vector<float> & out, const std::vector<ObjChunk> & chunks, std::vector<float> ObjChunk::* member) {
+    size_t total = 0;
+    for (const ObjChunk & chunk : chunks) {
+      total += (chunk.*member).size();
+    }
+    out.reserve(total);
+    for (const ObjChunk & chunk : chunks) {
+      out.insert(out.end(), (chunk.*member).begin(), (chunk.*member).end());
+    }
+  }
+
+  static inline int32_t resolve(const ObjCorner & corner, int i, size_t base, size_t count) {
+    int32_t index = corner.index[i];
+    if (NO_INDEX == index && !(corner.relative & (1 << i))) {
+      return NO_INDEX;
+    }
+    int64_t resolved = (corner.relative & (1 << i)) ? (int64_t)base + index : index;
+    if (resolved < 0 || resolved >= (int64_t)count) {
+      throw std::runtime_error("Bad OBJ index " + std::to_string(resolved + 1));
+    }
+    return (int32_t)resolved;
+  }
+
+  MeshData decodeObj(const uint8_t * data, size_t size, uint32_t attributes, ThreadPool * pool) {
+    const char * text = reinterpret_cast<const char *>(data);
+    const char * textEnd = text + size;
+
+    // Split on line ends, so every chunk can be parsed on its own
+    std::vector<const char *> bounds(1, text);
+    size_t chunkBytes = pool ? CHUNK_BYTES : size;
+    while (textEnd - bounds.back() > (ptrdiff_t)chunkBytes) {
+      const char * split = bounds.back() + chunkBytes;
+      const char * lineEnd = static_cast<const char *>(memchr(split, '\n', textEnd - split));
+      if (!lineEnd) {
+        break;
+      }
+      bounds.push_back(lineEnd + 1);
+    }
+    bounds.push_back(textEnd);
+
+    std::vector<ObjChunk> chunks(bounds.size() - 1);
+    auto parse = [&](size_t i) {
+      parseChunk(bounds[i], bounds[i + 1], chunks[i]);
+    };
+    if (pool && chunks.size() > 1) {
+      pool->parallelFor(chunks.size(), parse);
+    } else {
+      for (size_t i = 0; i < chunks.size(); ++i) {
+        parse(i);
+      }
+    }
+
+    std::vector<float> positions, texCoords, normals;
+    appendAll(positions, chunks, &ObjChunk::positions);
+    appendAll(texCoords, chunks, &ObjChunk::texCoords);
+    appendAll(normals, chunks, &ObjChunk::normals);
+    size_t cornerTotal = 0;
+    for (const ObjChunk & chunk : chunks) {
+      cornerTotal += chunk.corners.size();
+    }
+
+    // Material numbers are global, in order of first use across the file
+    std::unordered_map<std::string, int32_t> materialNumbers;
+    for (const ObjChunk & chunk : chunks) {
+      for (const std::string & name : chunk.materials) {
+        materialNumbers.insert(std::make_pair(name, (int32_t)materialNumbers.size()));
+      }
+    }
+
+    MeshData mesh;
+    mesh.attributes = BakedAsset::POSITION | (attributes & BakedAsset::NORMAL);
+    if (!texCoords.empty()) {
+      mesh.attributes |= attributes & BakedAsset::TEXCOORD;
+    }
+    if (!materialNumbers.empty()) {
+      mesh.attributes |= attributes & BakedAsset::MATERIAL;
+    }
+    const bool keepNormals = 0 != (mesh.attributes & BakedAsset::NORMAL);
+    const bool keepTexCoords = 0 != (mesh.attributes & BakedAsset::TEXCOORD);
+    const bool keepMaterials = 0 != (mesh.attributes & BakedAsset::MATERIAL);
+
+    // De-duplicating is inherently serial, but only touches integers
+    ObjVertexMap vertexMap(cornerTotal / 2);
+    // Summed for vertices the file gave no normal
+    std::vector<float> faceNormals;
+    std::vector<uint32_t> & indices = mesh.indices;
+    indices.reserve(cornerTotal * 3 / 2);
+    size_t positionBase = 0, texCoordBase = 0, normalBase = 0;
+    const size_t positionCount = positions.size() / 3;
+    const size_t texCoordCount = texCoords.size() / 2;
+    const size_t normalCount = normals.size() / 3;
+    int32_t material = 0;
+    std::vector<uint32_t> face;
+    for (const ObjChunk & chunk : chunks) {
+      std::vector<int32_t> chunkMaterials;
+      for (const std::string & name : chunk.materials) {
+        chunkMaterials.push_back(materialNumbers[name]);
+      }
+      const ObjCorner * corner = chunk.corners.data();
+      for (const ObjFace & objFace : chunk.faces) {
+        if (NO_INDEX != objFace.material) {
+          material = chunkMaterials[objFace.material];
+        }
+        face.clear();
+        for (uint32_t c = 0; c < objFace.cornerCount; ++c, ++corner) {
+          ObjVertex vertex;
+          vertex.position = resolve(*corner, 0, positionBase, positionCount);
+          vertex.texCoord = keepTexCoords ? resolve(*corner, 1, texCoordBase, texCoordCount) : NO_INDEX;
+          vertex.normal = keepNormals ? resolve(*corner, 2, normalBase, normalCount) : NO_INDEX;
+          vertex.material = keepMaterials ? material : 0;
+          face.push_back(vertexMap.find(vertex));
+        }
+        if (keepNormals) {
+          faceNormals.resize(vertexMap.vertices.size() * 3, 0.0f);
+        }
+        for (size_t i = 2; i < face.size(); ++i) {
+          uint32_t triangle[3] = { face[0], face[i - 1], face[i] };
+          indices.insert(indices.end(), triangle, triangle + 3);
+          if (!keepNormals) {
+            continue;
+          }
+          const float * a = &positions[vertexMap.vertices[triangle[0]].position * 3];
+          const float * b = &positions[vertexMap.vertices[triangle[1]].position * 3];
+          const float * c = &positions[vertexMap.vertices[triangle[2]].position * 3];
+          float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+          float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+          float n[3] = {
+            e1[1] * e2[2] - e1[2] * e2[1],
+            e1[2] * e2[0] - e1[0] * e2[2],
+            e1[0] * e2[1] - e1[1] * e2[0]
+          };
+          for (int j = 0; j < 3; ++j) {
+            if (NO_INDEX == vertexMap.vertices[triangle[j]].normal) {
+              for (int k = 0; k < 3; ++k) {
+                faceNormals[triangle[j] * 3 + k] += n[k];
+              }
+            }
+          }
+        }
+      }
+      positionBase += chunk.positions.size() / 3;
+      texCoordBase += chunk.texCoords.size() / 2;
+      normalBase += chunk.normals.size() / 3;
+      if (NO_INDEX != chunk.lastMaterial) {
+        material = chunkMaterials[chunk.lastMaterial];
+      }
+    }
+
+    // Every vertex is written independently
+    const std::vector<ObjVertex> & vertices = vertexMap.vertices;
+    const uint32_t floats = mesh.floatsPerVertex();
+    mesh.vertices.resize(vertices.size() * floats);
+    const size_t BLOCK = 1 << 16;
+    auto write = [&](size_t block) {
+      size_t last = std::min(vertices.size(), (block + 1) * BLOCK);
+      for (size_t v = block * BLOCK; v < last; ++v) {
+        const ObjVertex & key = vertices[v];
+        float * out = &mesh.vertices[v * floats];
+        memcpy(out, &positions[key.position * 3], 3 * sizeof(float));
+        out += 3;
+        if (keepNormals) {
+          if (NO_INDEX != key.normal) {
+            memcpy(out, &normals[key.normal * 3], 3 * sizeof(float));
+          } else {
+            const float * n = &faceNormals[v * 3];
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            float scale = length > 0 ? 1.0f / length : 0.0f;
+            for (int k = 0; k < 3; ++k) {
+              out[k] = n[k] * scale;
+            }
+          }
+          out += 3;
+        }
+        if (keepTexCoords) {
+          out[0] = NO_INDEX != key.texCoord ? texCoords[key.texCoord * 2] : 0.0f;
+          out[1] = NO_INDEX != key.texCoord ? texCoords[key.texCoord * 2 + 1] : 0.0f;
+          out += 2;
+        }
+        if (keepMaterials) {
+          out[0] = (float)key.material;
+        }
+      }
+    };
+    size_t blocks = (vertices.size() + BLOCK - 1) / BLOCK;
+    if (pool && blocks > 1) {
+      pool->parallelFor(blocks, write);
+    } else {
+      for (size_t i = 0; i < blocks; ++i) {
+        write(i);
+      }
+    }
+    return mesh;
+  }
+
+}
@@ -0,0 +1,52 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#pragma once
+
+// Shared with the bake_assets tool, so it must not depend on anything
+// pulled in by Common.h
+#include <cstddef>
+#include <cstdint>
+
+#include "MeshData.h"
+
+class ThreadPool;
+
+namespace oria {
+
+  /**
+   * Decodes a Wavefront OBJ file straight out of memory into a triangle
+   * list, with the same attributes oglplus::shapes::ObjMesh gives a
+   * ShapeWrapper.  Polygons are triangulated as fans, and corners that
+   * share every attribute share a vertex.  Material numbers are assigned in
+   * order of the first appearance of each 'usemtl', and vertices the file
+   * gave no normal get the average normal of the faces around them.
+   *
+   * Only the attributes in the mask are kept.  Normals are always there if
+   * asked for, texture coordinates and materials only if the file has them.
+   *
+   * Files of more than a few megabytes are split into chunks of whole lines
+   * that are parsed in parallel on the pool, if there is one.  Throws
+   * std::runtime_error if the data can't be decoded.
+   */
+  MeshData decodeObj(const uint8_t * data, size_t size, uint32_t attributes = ~0u,
+    ThreadPool * pool = nullptr);
+
+}
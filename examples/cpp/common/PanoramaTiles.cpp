@@ -0,0 +1,105 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "PanoramaTiles.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace oria {
+
+  static const float PI = 3.14159265358979f;
+
+  // Points sampled along each edge of a tile to find its extent.  Tiles
+  // near the poles bow outward, so the corners alone aren't enough.
+  static const int EDGE_SAMPLES = 5;
+
+  void PanoramaLayout::direction(float x, float y, float out[3]) const {
+    float longitude = (x / fullWidth - 0.5f) * 2.0f * PI;
+    float latitude = (0.5f - y / fullHeight) * PI;
+    float horizontal = cos(latitude);
+    out[0] = horizontal * sin(longitude);
+    out[1] = sin(latitude);
+    out[2] = -horizontal * cos(longitude);
+  }
+
+  static float angleBetween(const float a[3], const float b[3]) {
+    float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    return acos(std::max(-1.0f, std::min(1.0f, dot)));
+  }
+
+  PanoramaTiles::PanoramaTiles(const PanoramaLayout & layout, uint32_t tileSize)
+    : layout(layout), tileSize(tileSize) {
+    columns = (layout.cropWidth + tileSize - 1) / tileSize;
+    rows = (layout.cropHeight + tileSize - 1) / tileSize;
+    bounds.resize(columns * rows);
+    for (uint32_t y = 0; y < rows; ++y) {
+      for (uint32_t x = 0; x < columns; ++x) {
+        AtlasRect rect = tileRect(x, y);
+        float left = (float)(layout.cropX + rect.x);
+        float top = (float)(layout.cropY + rect.y);
+        Bounds & tile = bounds[y * columns + x];
+        layout.direction(left + rect.width * 0.5f, top + rect.height * 0.5f, tile.center);
+        tile.radius = 0;
+        for (int i = 0; i <= EDGE_SAMPLES; ++i) {
+          float t = (float)i / EDGE_SAMPLES;
+          float edges[4][2] = {
+            { left + t * rect.width, top },
+            { left + t * rect.width, top + rect.height },
+            { left, top + t * rect.height },
+            { left + rect.width, top + t * rect.height },
+          };
+          for (int e = 0; e < 4; ++e) {
+            float point[3];
+            layout.direction(edges[e][0], edges[e][1], point);
+            tile.radius = std::max(tile.radius, angleBetween(tile.center, point));
+          }
+        }
+      }
+    }
+  }
+
+  AtlasRect PanoramaTiles::tileRect(uint32_t x, uint32_t y) const {
+    AtlasRect rect;
+    rect.x = x * tileSize;
+    rect.y = y * tileSize;
+    rect.width = std::min(tileSize, layout.cropWidth - rect.x);
+    rect.height = std::min(tileSize, layout.cropHeight - rect.y);
+    return rect;
+  }
+
+  void PanoramaTiles::visibleTiles(const float viewDirection[3], float halfFov,
+      std::vector<TileRequest> & out) const {
+    out.clear();
+    for (uint32_t y = 0; y < rows; ++y) {
+      for (uint32_t x = 0; x < columns; ++x) {
+        const Bounds & tile = bounds[y * columns + x];
+        float angle = angleBetween(viewDirection, tile.center);
+        if (angle - tile.radius < halfFov) {
+          TileRequest request = { x, y, angle };
+          out.push_back(request);
+        }
+      }
+    }
+    std::sort(out.begin(), out.end(), [](const TileRequest & a, const TileRequest & b) {
+      return a.angle < b.angle;
+    });
+  }
+
+}
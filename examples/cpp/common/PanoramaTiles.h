@@ -0,0 +1,107 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+// Pure CPU, so it includes only what it needs rather than Common.h, and
+// can be built and tested on its own
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AtlasPacker.h"
+
+namespace oria {
+
+  /**
+   * Where an equirectangular image sits on the sphere.  Photo spheres
+   * often cover only part of it, described by the GPano crop fields; an
+   * uncropped panorama has the crop equal to the full size.
+   *
+   * Coordinates are texels of the full panorama, top row first as in the
+   * image file.  Longitude runs from -180 degrees at the left edge through
+   * -Z at the center to +180 at the right, increasing toward +X.
+   * Latitude runs from +90 (+Y) at the top to -90 at the bottom.
+   */
+  struct PanoramaLayout {
+    uint32_t fullWidth{ 0 };
+    uint32_t fullHeight{ 0 };
+    uint32_t cropX{ 0 };
+    uint32_t cropY{ 0 };
+    uint32_t cropWidth{ 0 };
+    uint32_t cropHeight{ 0 };
+
+    // The unit vector through a point of the full panorama
+    void direction(float x, float y, float out[3]) const;
+  };
+
+  struct TileRequest {
+    uint32_t x;
+    uint32_t y;
+    // Between the view direction and the tile's center, in radians
+    float angle;
+  };
+
+  /**
+   * Cuts the cropped area of a panorama into square tiles, and works out
+   * which of them can be seen looking in a given direction.  Only the crop
+   * is tiled, so the empty part of the sphere costs nothing.
+   */
+  class PanoramaTiles {
+    struct Bounds {
+      float center[3];
+      // The widest angle from the center to any part of the tile
+      float radius;
+    };
+
+    PanoramaLayout layout;
+    uint32_t tileSize;
+    uint32_t columns;
+    uint32_t rows;
+    std::vector<Bounds> bounds;
+
+  public:
+    PanoramaTiles(const PanoramaLayout & layout, uint32_t tileSize);
+
+    const PanoramaLayout & getLayout() const {
+      return layout;
+    }
+
+    uint32_t getTileSize() const {
+      return tileSize;
+    }
+
+    uint32_t getColumns() const {
+      return columns;
+    }
+
+    uint32_t getRows() const {
+      return rows;
+    }
+
+    // The texels of the crop a tile covers, relative to the crop's corner.
+    // Tiles on the right and bottom edges may be smaller than the rest.
+    AtlasRect tileRect(uint32_t x, uint32_t y) const;
+
+    // Every tile any part of which lies within halfFov radians of the view
+    // direction, nearest first
+    void visibleTiles(const float viewDirection[3], float halfFov, std::vector<TileRequest> & out) const;
+  };
+
+}
@@ -0,0 +1,279 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "Common.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIXELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET(isa)
+#else
+#include <cpuid.h>
+#define TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace oria { namespace pixels {
+
+  typedef void(*SwapRowsFn)(uint8_t * a, uint8_t * b, size_t bytes);
+  typedef void(*ExpandRowFn)(const uint8_t * src, uint8_t * dst, size_t width, bool rgba);
+
+  ///////////////////////////////////////////////////////////////////////////
+  // Scalar
+
+  static void swapRowsScalar(uint8_t * a, uint8_t * b, size_t bytes) {
+    uint8_t temp[256];
+    while (bytes) {
+      size_t chunk = std::min(bytes, sizeof(temp));
+      memcpy(temp, a, chunk);
+      memcpy(a, b, chunk);
+      memcpy(b, temp, chunk);
+      a += chunk;
+      b += chunk;
+      bytes -= chunk;
+    }
+  }
+
+  static void expandRowScalar(const uint8_t * src, uint8_t * dst, size_t width, bool rgba) {
+    int first = rgba ? 2 : 0;
+    int last = rgba ? 0 : 2;
+    for (size_t i = 0; i < width; ++i, src += 3, dst += 4) {
+      dst[0] = src[first];
+      dst[1] = src[1];
+      dst[2] = src[last];
+      dst[3] = 0xFF;
+    }
+  }
+
+#ifdef PIXELS_X86
+  ///////////////////////////////////////////////////////////////////////////
+  // x86.  SSE2 is part of the x86-64 baseline, but the byte shuffles need
+  // SSSE3, so the SSE2 path only accelerates the row swaps.
+
+  static void swapRowsSse2(uint8_t * a, uint8_t * b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+      __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+      __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+      _mm_storeu_si128((__m128i *)(a + i), vb);
+      _mm_storeu_si128((__m128i *)(b + i), va);
+    }
+    swapRowsScalar(a + i, b + i, bytes - i);
+  }
+
+  TARGET("avx2") static void swapRowsAvx2(uint8_t * a, uint8_t * b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+      __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+      __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+      _mm256_storeu_si256((__m256i *)(a + i), vb);
+      _mm256_storeu_si256((__m256i *)(b + i), va);
+    }
+    swapRowsSse2(a + i, b + i, bytes - i);
+  }
+
+  // Spreads the first four BGR pixels of a 16 byte register out to 32 bit
+  // lanes, leaving the alpha byte zero
+  TARGET("ssse3") static __m128i expandMaskSsse3(bool rgba) {
+    return rgba ?
+      _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  }
+
+  TARGET("ssse3") static void expandRowSsse3(const uint8_t * src, uint8_t * dst, size_t width, bool rgba) {
+    const __m128i mask = expandMaskSsse3(rgba);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    size_t i = 0;
+    // Each load reads 16 bytes to use 12, so stop short of the row end
+    for (; i + 6 <= width; i += 4) {
+      __m128i bgr = _mm_loadu_si128((const __m128i *)(src + i * 3));
+      __m128i result = _mm_or_si128(_mm_shuffle_epi8(bgr, mask), alpha);
+      _mm_storeu_si128((__m128i *)(dst + i * 4), result);
+    }
+    expandRowScalar(src + i * 3, dst + i * 4, width - i, rgba);
+  }
+
+  static void cpuid(int info[4], int leaf) {
+#ifdef _MSC_VER
+    __cpuidex(info, leaf, 0);
+#else
+    unsigned int regs[4] = { 0 };
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+    memcpy(info, regs, sizeof(regs));
+#endif
+  }
+
+  static bool hasSsse3() {
+    int info[4];
+    cpuid(info, 1);
+    return 0 != (info[2] & (1 << 9));
+  }
+
+  static bool hasAvx2() {
+    int info[4];
+    cpuid(info, 0);
+    if (info[0] < 7) {
+      return false;
+    }
+    // The OS also has to be saving the YMM registers on context switches
+    cpuid(info, 1);
+    const int OSXSAVE = 1 << 27, AVX = 1 << 28;
+    if ((info[2] & (OSXSAVE | AVX)) != (OSXSAVE | AVX)) {
+      return false;
+    }
+#ifdef _MSC_VER
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    unsigned long long xcr0 = ((unsigned long long)edx << 32) | eax;
+#endif
+    if ((xcr0 & 6) != 6) {
+      return false;
+    }
+    cpuid(info, 7);
+    return 0 != (info[1] & (1 << 5));
+  }
+#endif
+
+#ifdef PIXELS_NEON
+  ///////////////////////////////////////////////////////////////////////////
+  // NEON
+
+  static void swapRowsNeon(uint8_t * a, uint8_t * b, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+      uint8x16_t va = vld1q_u8(a + i);
+      uint8x16_t vb = vld1q_u8(b + i);
+      vst1q_u8(a + i, vb);
+      vst1q_u8(b + i, va);
+    }
+    swapRowsScalar(a + i, b + i, bytes - i);
+  }
+
+  static void expandRowNeon(const uint8_t * src, uint8_t * dst, size_t width, bool rgba) {
+    size_t i = 0;
+    // De-interleaving loads and interleaving stores do all the work
+    for (; i + 16 <= width; i += 16) {
+      uint8x16x3_t bgr = vld3q_u8(src + i * 3);
+      uint8x16x4_t result;
+      result.val[0] = rgba ? bgr.val[2] : bgr.val[0];
+      result.val[1] = bgr.val[1];
+      result.val[2] = rgba ? bgr.val[0] : bgr.val[2];
+      result.val[3] = vdupq_n_u8(0xFF);
+      vst4q_u8(dst + i * 4, result);
+    }
+    expandRowScalar(src + i * 3, dst + i * 4, width - i, rgba);
+  }
+#endif
+
+  ///////////////////////////////////////////////////////////////////////////
+
+  struct Kernels {
+    const char * name{ "scalar" };
+    SwapRowsFn swapRows{ swapRowsScalar };
+    ExpandRowFn expandRow{ expandRowScalar };
+
+    // RIFT_SIMD=scalar|sse2|ssse3 caps the path used, for comparing results
+    Kernels() {
+      const char * override = getenv("RIFT_SIMD");
+      std::string cap(override ? override : "");
+      if ("scalar" == cap) {
+        return;
+      }
+#if defined(PIXELS_X86)
+      name = "sse2";
+      swapRows = swapRowsSse2;
+      if ("sse2" == cap) {
+        return;
+      }
+      if (hasSsse3()) {
+        name = "ssse3";
+        expandRow = expandRowSsse3;
+      }
+      // The expansion is bound by memory bandwidth, and measured no faster 
+      // with 256 bit shuffles (which only work within 128 bit lanes anyway)
+      if ("ssse3" != cap && hasAvx2()) {
+        name = "avx2";
+        swapRows = swapRowsAvx2;
+      }
+#elif defined(PIXELS_NEON)
+      name = "neon";
+      swapRows = swapRowsNeon;
+      expandRow = expandRowNeon;
+#endif
+    }
+  };
+
+  static const Kernels & kernels() {
+    static Kernels instance;
+    return instance;
+  }
+
+  const char * simdPath() {
+    return kernels().name;
+  }
+
+  void flipVertical(void * pixels, size_t stride, size_t rowBytes, size_t rows) {
+    uint8_t * top = static_cast<uint8_t *>(pixels);
+    uint8_t * bottom = top + (rows ? rows - 1 : 0) * stride;
+    SwapRowsFn swapRows = kernels().swapRows;
+    for (; top < bottom; top += stride, bottom -= stride) {
+      swapRows(top, bottom, rowBytes);
+    }
+  }
+
+  // libc's memcpy is already vectorized, so the rows are copied with it
+  void blitRows(const void * src, size_t srcStride, void * dst, size_t dstStride,
+      size_t rowBytes, size_t rows, bool flip) {
+    const uint8_t * in = static_cast<const uint8_t *>(src);
+    uint8_t * out = static_cast<uint8_t *>(dst);
+    for (size_t y = 0; y < rows; ++y) {
+      size_t target = flip ? rows - y - 1 : y;
+      memcpy(out + target * dstStride, in + y * srcStride, rowBytes);
+    }
+  }
+
+  static void expand(const void * src, size_t srcStride, void * dst, size_t dstStride,
+      size_t width, size_t height, bool flip, bool rgba) {
+    const uint8_t * in = static_cast<const uint8_t *>(src);
+    uint8_t * out = static_cast<uint8_t *>(dst);
+    ExpandRowFn expandRow = kernels().expandRow;
+    for (size_t y = 0; y < height; ++y) {
+      size_t target = flip ? height - y - 1 : y;
+      expandRow(in + y * srcStride, out + target * dstStride, width, rgba);
+    }
+  }
+
+  void bgrToRgba(const void * src, size_t srcStride, void * dst, size_t dstStride,
+      size_t width, size_t height, bool flip) {
+    expand(src, srcStride, dst, dstStride, width, height, flip, true);
+  }
+
+  void bgrToBgra(const void * src, size_t srcStride, void * dst, size_t dstStride,
+      size_t width, size_t height, bool flip) {
+    expand(src, srcStride, dst, dstStride, width, height, flip, false);
+  }
+
+} } // namespaces
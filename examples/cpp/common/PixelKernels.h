@@ -0,0 +1,52 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Vectorized helpers for shuffling 8 bit pixel data around on the CPU, for
+ * things like camera frames that arrive upside down and in BGR order.
+ *
+ * Strides are in bytes, and may differ from the row size (OpenCV's
+ * Mat::step, for instance).  Where a function takes a flip argument, the
+ * destination rows are written in the reverse order, so the flip comes
+ * for free with the copy.
+ *
+ * The fastest path the CPU supports (AVX2, SSSE3, SSE2 or NEON) is picked
+ * at runtime, with a scalar fallback everywhere else.
+ */
+namespace oria { namespace pixels {
+
+  // Reverses the order of the rows of an image in place
+  void flipVertical(void * pixels, size_t stride, size_t rowBytes, size_t rows);
+
+  // Copies a block of rows between images with different strides
+  void blitRows(const void * src, size_t srcStride, void * dst, size_t dstStride,
+    size_t rowBytes, size_t rows, bool flip = false);
+
+  // Expands packed BGR to RGBA or BGRA, with opaque alpha
+  void bgrToRgba(const void * src, size_t srcStride, void * dst, size_t dstStride,
+    size_t width, size_t height, bool flip = false);
+  void bgrToBgra(const void * src, size_t srcStride, void * dst, size_t dstStride,
+    size_t width, size_t height, bool flip = false);
+
+  // The instruction set the kernels are using, for logging
+  const char * simdPath();
+
+} } // namespaces
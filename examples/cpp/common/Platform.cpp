@@ -18,6 +18,7 @@
  ************************************************************************************/
 
 #include "Common.h"
+#include <fstream>
 
 #ifdef OS_WIN
 #pragma warning (disable : 4996)
@@ -91,21 +92,249 @@ void Platform::say(std::ostream & out, const char * message, ...) {
   out << std::string(SAY_BUFFER) << std::endl;
 }
 
-std::string Platform::getResourceString(Resource resource) {
+struct ResourceStats {
+  unsigned loads{ 0 };
+  uint64_t bytes{ 0 };
+  // Time spent actually reading, on whichever thread did it
+  double readSeconds{ 0 };
+  // Time the caller of getResourceView was held up, including waits on 
+  // prefetches that hadn't finished
+  double blockedSeconds{ 0 };
+  double decodeSeconds{ 0 };
+};
+
+struct CacheStats {
+  unsigned hits{ 0 };
+  unsigned misses{ 0 };
+};
+
+typedef std::chrono::high_resolution_clock StatsClock;
+typedef std::map<Resource, ResourceStats> ResourceStatsMap;
+typedef std::map<std::string, CacheStats> CacheStatsMap;
+
+static std::mutex & getStatsMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+static double secondsSince(const StatsClock::time_point & start) {
+  std::chrono::duration<double> elapsed = StatsClock::now() - start;
+  return elapsed.count();
+}
+
+static ResourceStatsMap & getResourceStats() {
+  static ResourceStatsMap map;
+  return map;
+}
+
+static CacheStatsMap & getCacheStats() {
+  static CacheStatsMap map;
+  return map;
+}
+
+// Only pays for the dump if someone asked for it
+static void registerStatsDump() {
+  static std::once_flag registered;
+  std::call_once(registered, []{
+    const char * path = getenv("RIFT_RESOURCE_STATS");
+    if (!path) {
+      return;
+    }
+    std::string target(path);
+    Platform::addShutdownHook([target]{
+      if ("-" == target) {
+        Platform::writeResourceStats(std::cout);
+        return;
+      }
+      std::ofstream out(target.c_str());
+      if (!out) {
+        SAY_ERR("Unable to write resource stats to %s", target.c_str());
+        return;
+      }
+      Platform::writeResourceStats(out);
+    });
+  });
+}
+
+void Platform::recordResourceDecode(Resource resource, double seconds) {
+  registerStatsDump();
+  std::lock_guard<std::mutex> lock(getStatsMutex());
+  getResourceStats()[resource].decodeSeconds += seconds;
+}
+
+void Platform::recordCacheLookup(const char * cache, bool hit) {
+  registerStatsDump();
+  std::lock_guard<std::mutex> lock(getStatsMutex());
+  CacheStats & stats = getCacheStats()[cache];
+  if (hit) {
+    ++stats.hits;
+  } else {
+    ++stats.misses;
+  }
+}
+
+static std::string jsonString(const std::string & str) {
+  std::string result("\"");
+  std::for_each(str.begin(), str.end(), [&](char c) {
+    if ('"' == c || '\\' == c) {
+      result += '\\';
+    }
+    result += c;
+  });
+  return result + "\"";
+}
+
+// Resources are listed most expensive first
+void Platform::writeResourceStats(std::ostream & out) {
+  typedef std::pair<Resource, ResourceStats> Entry;
+  std::vector<Entry> entries;
+  CacheStatsMap caches;
+  {
+    std::lock_guard<std::mutex> lock(getStatsMutex());
+    ResourceStatsMap & map = getResourceStats();
+    entries.assign(map.begin(), map.end());
+    caches = getCacheStats();
+  }
+  std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+    return a.second.blockedSeconds + a.second.decodeSeconds >
+      b.second.blockedSeconds + b.second.decodeSeconds;
+  });
+
+  out << "{\n  \"resources\": [";
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const ResourceStats & stats = entries[i].second;
+    out << (i ? ",\n" : "\n") << "    { \"path\": "
+      << jsonString(Resources::getResourcePath(entries[i].first))
+      << ", \"loads\": " << stats.loads
+      << ", \"bytes\": " << stats.bytes
+      << ", \"readMs\": " << stats.readSeconds * 1000.0
+      << ", \"blockedMs\": " << stats.blockedSeconds * 1000.0
+      << ", \"decodeMs\": " << stats.decodeSeconds * 1000.0 << " }";
+  }
+  out << "\n  ],\n  \"caches\": {";
+  for (CacheStatsMap::const_iterator itr = caches.begin(); itr != caches.end(); ++itr) {
+    out << (caches.begin() == itr ? "\n" : ",\n") << "    " << jsonString(itr->first)
+      << ": { \"hits\": " << itr->second.hits
+      << ", \"misses\": " << itr->second.misses << " }";
+  }
+  out << "\n  }\n}" << std::endl;
+}
+
+typedef std::map<Resource, ResourceFuture> PrefetchMap;
+
+static std::mutex & getPrefetchMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+static PrefetchMap & getPrefetchMap() {
+  static PrefetchMap map;
+  return map;
+}
+
+// Hands a prefetched resource over to the first caller that asks for it
+static bool takePrefetched(Resource resource, ResourceFuture & out) {
+  std::lock_guard<std::mutex> lock(getPrefetchMutex());
+  PrefetchMap & map = getPrefetchMap();
+  PrefetchMap::iterator itr = map.find(resource);
+  if (map.end() == itr) {
+    return false;
+  }
+  out = itr->second;
+  map.erase(itr);
+  return true;
+}
+
+static ResourceView readResourceData(Resource resource) {
+  ResourceView result;
+  const ResourcePack & pack = ResourcePack::instance();
+  if (pack.isOpen() && pack.find(Resources::getResourcePath(resource), result)) {
+    return result;
+  }
+
+  // Not packed, so fall back on a single copy into memory owned by the view
   size_t size = Resources::getResourceSize(resource);
-  char * data = new char[size];
-  Resources::getResourceData(resource, data);
-  std::string dataStr(data, size);
-  delete[] data;
-  return dataStr;
+  std::shared_ptr<std::vector<uint8_t>> data(new std::vector<uint8_t>(size));
+  if (size) {
+    Resources::getResourceData(resource, &(*data)[0]);
+  }
+  return ResourceView(data);
+}
+
+static ResourceView readResource(Resource resource) {
+  StatsClock::time_point start = StatsClock::now();
+  ResourceView result = readResourceData(resource);
+  double seconds = secondsSince(start);
+  std::lock_guard<std::mutex> lock(getStatsMutex());
+  ResourceStats & stats = getResourceStats()[resource];
+  ++stats.loads;
+  stats.bytes += result.size;
+  stats.readSeconds += seconds;
+  return result;
+}
+
+ResourceView Platform::getResourceView(Resource resource) {
+#ifdef RIFT_DEBUG
+  ResourceWatcher::instance().track(resource);
+#endif
+  registerStatsDump();
+  StatsClock::time_point start = StatsClock::now();
+  ResourceView result;
+  ResourceFuture prefetched;
+  if (takePrefetched(resource, prefetched)) {
+    result = prefetched.get();
+  } else {
+    result = readResource(resource);
+  }
+  double seconds = secondsSince(start);
+  std::lock_guard<std::mutex> lock(getStatsMutex());
+  getResourceStats()[resource].blockedSeconds += seconds;
+  return result;
+}
+
+// Starts reading the resources on the worker pool.  Subsequent requests
+// for them complete from memory, or wait on the read if it's still running.
+std::vector<ResourceFuture> Platform::prefetchResources(std::initializer_list<Resource> resources) {
+  static std::once_flag registeredShutdown;
+  std::call_once(registeredShutdown, []{
+    Platform::addShutdownHook([]{
+      std::lock_guard<std::mutex> lock(getPrefetchMutex());
+      getPrefetchMap().clear();
+    });
+  });
+
+  std::vector<ResourceFuture> result;
+  std::lock_guard<std::mutex> lock(getPrefetchMutex());
+  PrefetchMap & map = getPrefetchMap();
+  std::for_each(resources.begin(), resources.end(), [&](Resource resource) {
+    PrefetchMap::iterator itr = map.find(resource);
+    if (map.end() != itr) {
+      result.push_back(itr->second);
+      return;
+    }
+    ResourceFuture future = ThreadPool::instance().submit([resource] {
+      ResourceView view = readResource(resource);
+      // Views into the mapped pack are only addresses until they're 
+      // touched, so fault the pages in here rather than on the GL thread
+      volatile uint8_t sink = 0;
+      for (size_t i = 0; i < view.size; i += 4096) {
+        sink ^= view.data[i];
+      }
+      return view;
+    }).share();
+    map[resource] = future;
+    result.push_back(future);
+  });
+  return result;
+}
+
+std::string Platform::getResourceString(Resource resource) {
+  return getResourceView(resource).toString();
 }
 
 std::vector<uint8_t> Platform::getResourceByteVector(Resource resource) {
-  size_t size = Resources::getResourceSize(resource);
-  std::vector<uint8_t> data; 
-  data.resize(size);
-  Resources::getResourceData(resource, &data[0]);
-  return data;
+  ResourceView view = getResourceView(resource);
+  return std::vector<uint8_t>(view.begin(), view.end());
 }
 
 std::stringstream Platform::getResourceStream(Resource resource) {
@@ -19,6 +19,8 @@
 
 #pragma once
 
+typedef std::shared_future<ResourceView> ResourceFuture;
+
 class Platform {
 
 public:
@@ -34,6 +36,8 @@ public:
   static void fail(const char * file, int line, const char * message, ...);
   static void say(std::ostream & out, const char * message, ...);
   static std::string format(const char * formatString, ...);
+  static ResourceView getResourceView(Resource resource);
+  static std::vector<ResourceFuture> prefetchResources(std::initializer_list<Resource> resources);
   static std::string getResourceString(Resource resource);
   static std::vector<uint8_t> getResourceByteVector(Resource resource);
   static std::stringstream getResourceStream(Resource resource);
@@ -43,6 +47,29 @@ public:
 
   static void addShutdownHook(std::function<void()> f);
   static void runShutdownHooks();
+
+  // Load accounting, written out as JSON by the shutdown hooks to the file 
+  // named by the RIFT_RESOURCE_STATS environment variable ('-' for stdout)
+  static void recordResourceDecode(Resource resource, double seconds);
+  static void recordCacheLookup(const char * cache, bool hit);
+  static void writeResourceStats(std::ostream & out);
+};
+
+// Charges the time until it goes out of scope to decoding the resource
+class DecodeTimer {
+  typedef std::chrono::high_resolution_clock Clock;
+  Resource resource;
+  Clock::time_point start;
+
+public:
+  explicit DecodeTimer(Resource resource)
+    : resource(resource), start(Clock::now()) {
+  }
+
+  ~DecodeTimer() {
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    Platform::recordResourceDecode(resource, elapsed.count());
+  }
 };
 
 #define FAIL(...) Platform::fail(__FILE__, __LINE__, __VA_ARGS__)
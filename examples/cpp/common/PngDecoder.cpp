@@ -0,0 +1,140 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#include "Common.h"
+
+#ifndef HAVE_OPENCV
+#include <png.h>
+#endif
+
+namespace oria {
+
+  // Enough for the loads running on the worker pool at once
+  static const size_t MAX_POOLED_BUFFERS = 8;
+  // A 2048x2048 RGBA image.  Anything bigger, such as a panorama, is rare
+  // enough that keeping its memory around for good isn't worth it.
+  static const size_t MAX_POOLED_BUFFER_BYTES = 16 * 1024 * 1024;
+
+  PixelBufferPtr acquirePixelBuffer() {
+    typedef std::vector<uint8_t> Buffer;
+    static std::mutex mutex;
+    static std::vector<Buffer *> pool;
+
+    Buffer * buffer = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!pool.empty()) {
+        buffer = pool.back();
+        pool.pop_back();
+      }
+    }
+    if (!buffer) {
+      buffer = new Buffer();
+    }
+    return PixelBufferPtr(buffer, [](Buffer * released) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (pool.size() < MAX_POOLED_BUFFERS && released->capacity() <= MAX_POOLED_BUFFER_BYTES) {
+        pool.push_back(released);
+      } else {
+        delete released;
+      }
+    });
+  }
+
+#ifndef HAVE_OPENCV
+  struct PngSource {
+    const uint8_t * data;
+    size_t size;
+    size_t offset;
+  };
+
+  static void readPngData(png_structp png, png_bytep out, png_size_t count) {
+    PngSource & source = *static_cast<PngSource *>(png_get_io_ptr(png));
+    if (count > source.size - source.offset) {
+      png_error(png, "Truncated PNG");
+    }
+    memcpy(out, source.data + source.offset, count);
+    source.offset += count;
+  }
+
+  // C++ exceptions can't unwind through libpng, so the error is kept for
+  // after the jump back
+  static void pngError(png_structp png, png_const_charp message) {
+    *static_cast<std::string *>(png_get_error_ptr(png)) = message;
+    png_longjmp(png, 1);
+  }
+
+  static void pngWarning(png_structp, png_const_charp) {
+  }
+
+  bool isPng(const void * data, size_t size) {
+    return size >= 8 && 0 == png_sig_cmp(static_cast<png_const_bytep>(data), 0, 8);
+  }
+
+  DecodedImage decodePng(const void * data, size_t size, std::vector<uint8_t> & buffer, bool flip) {
+    if (!isPng(data, size)) {
+      FAIL("Not a PNG image");
+    }
+    // Constructed before the jump target, so a longjmp can't skip them
+    std::string error;
+    std::vector<png_bytep> rows;
+    DecodedImage result;
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &error, pngError, pngWarning);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!info) {
+      png_destroy_read_struct(&png, nullptr, nullptr);
+      FAIL("Unable to allocate the PNG decoder");
+    }
+    if (setjmp(png_jmpbuf(png))) {
+      png_destroy_read_struct(&png, &info, nullptr);
+      FAIL("Unable to decode PNG image: %s", error.c_str());
+    }
+
+    PngSource source = { static_cast<const uint8_t *>(data), size, 0 };
+    png_set_read_fn(png, &source, readPngData);
+    png_read_info(png, info);
+    png_set_strip_16(png);
+    png_set_packing(png);
+    png_set_palette_to_rgb(png);
+    png_set_expand_gray_1_2_4_to_8(png);
+    if (png_get_valid(png, info, PNG_INFO_tRNS)) {
+      png_set_tRNS_to_alpha(png);
+    }
+    png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    result.width = png_get_image_width(png, info);
+    result.height = png_get_image_height(png, info);
+    result.channels = png_get_channels(png, info);
+    result.stride = png_get_rowbytes(png, info);
+    buffer.resize(result.stride * result.height);
+    result.pixels = buffer.data();
+    rows.resize(result.height);
+    for (uint32_t y = 0; y < result.height; ++y) {
+      rows[y] = result.pixels + (flip ? result.height - 1 - y : y) * result.stride;
+    }
+    png_read_image(png, rows.data());
+    png_read_end(png, nullptr);
+    png_destroy_read_struct(&png, &info, nullptr);
+    return result;
+  }
+#endif
+
+}
@@ -0,0 +1,57 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#pragma once
+
+namespace oria {
+
+  /**
+   * Scratch pixel buffers for decoding images that are uploaded and then
+   * thrown away.  Released buffers go back to a small shared pool with
+   * their capacity intact, so loading a run of textures doesn't allocate
+   * (and page in) a fresh buffer for every one.
+   */
+  typedef std::shared_ptr<std::vector<uint8_t>> PixelBufferPtr;
+  PixelBufferPtr acquirePixelBuffer();
+
+#ifndef HAVE_OPENCV
+  // An 8 bit image decoded into memory owned by someone else
+  struct DecodedImage {
+    uint32_t width{ 0 };
+    uint32_t height{ 0 };
+    // In bytes.  Rows are tightly packed.
+    size_t stride{ 0 };
+    // 1 (gray), 2 (gray and alpha), 3 (RGB) or 4 (RGBA).  Palettes, low
+    // bit depths and transparency chunks are expanded, 16 bit channels
+    // are cut to 8.
+    int channels{ 0 };
+    uint8_t * pixels{ nullptr };
+  };
+
+  bool isPng(const void * data, size_t size);
+
+  // Reads straight from the encoded bytes with libpng and decodes in a
+  // single pass into the buffer, which is grown if it's too small.  With
+  // flip set the bottom row comes first, as GL expects.  Builds with
+  // OpenCV decode through it instead, and don't link libpng.
+  DecodedImage decodePng(const void * data, size_t size, std::vector<uint8_t> & buffer, bool flip = true);
+#endif
+
+}
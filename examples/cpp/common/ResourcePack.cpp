@@ -0,0 +1,195 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "Common.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifndef OS_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ResourcePack::~ResourcePack() {
+  close();
+}
+
+bool ResourcePack::open(const std::string & path) {
+  close();
+#ifdef OS_WIN
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+    NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (INVALID_HANDLE_VALUE == file) {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(file, &fileSize);
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (NULL == mapping) {
+    CloseHandle(file);
+    return false;
+  }
+  base = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!base) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  fileHandle = file;
+  mappingHandle = mapping;
+  length = (size_t)fileSize.QuadPart;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat fileStat;
+  if (0 != fstat(fd, &fileStat) || 0 == fileStat.st_size) {
+    ::close(fd);
+    return false;
+  }
+  void * mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file
+  ::close(fd);
+  if (MAP_FAILED == mapped) {
+    return false;
+  }
+  base = (const uint8_t *)mapped;
+  length = (size_t)fileStat.st_size;
+#endif
+
+  if (!parse()) {
+    SAY_ERR("Invalid resource pack %s", path.c_str());
+    close();
+    return false;
+  }
+
+#ifndef OS_WIN
+  // A compressed pack is small enough that it's cheaper to pull the whole 
+  // thing in with one sequential read than to fault it in piecemeal
+  if (compressed) {
+    posix_madvise((void*)base, length, POSIX_MADV_WILLNEED);
+  }
+#endif
+  return true;
+}
+
+void ResourcePack::close() {
+  entries.clear();
+  compressed = false;
+  if (!base) {
+    return;
+  }
+#ifdef OS_WIN
+  UnmapViewOfFile(base);
+  CloseHandle(mappingHandle);
+  CloseHandle(fileHandle);
+  mappingHandle = fileHandle = nullptr;
+#else
+  munmap((void*)base, length);
+#endif
+  base = nullptr;
+  length = 0;
+}
+
+bool ResourcePack::parse() {
+  if (length < sizeof(Header)) {
+    return false;
+  }
+  Header header;
+  memcpy(&header, base, sizeof(Header));
+  if (header.magic != MAGIC || header.version != VERSION) {
+    return false;
+  }
+
+  size_t cursor = sizeof(Header);
+  for (uint32_t i = 0; i < header.count; ++i) {
+    Entry entry;
+    uint32_t pathLength;
+    if (cursor + sizeof(Entry) + sizeof(uint32_t) > length) {
+      return false;
+    }
+    memcpy(&entry, base + cursor, sizeof(Entry));
+    cursor += sizeof(Entry);
+    memcpy(&pathLength, base + cursor, sizeof(uint32_t));
+    cursor += sizeof(uint32_t);
+    if (cursor + pathLength > length || entry.offset + entry.storedSize > length) {
+      return false;
+    }
+    std::string path((const char *)base + cursor, pathLength);
+    cursor += pathLength;
+    if (entry.flags & COMPRESSED) {
+#ifndef HAVE_ZLIB
+      SAY_ERR("Resource pack contains compressed entries, but zlib support wasn't built");
+      return false;
+#endif
+      compressed = true;
+    }
+    entries[path] = entry;
+  }
+  return true;
+}
+
+bool ResourcePack::find(const std::string & path, ResourceView & out) const {
+  EntryMap::const_iterator itr = entries.find(path);
+  if (entries.end() == itr) {
+    return false;
+  }
+  const Entry & entry = itr->second;
+  if (!(entry.flags & COMPRESSED)) {
+    out = ResourceView(base + entry.offset, (size_t)entry.size);
+    return true;
+  }
+
+#ifdef HAVE_ZLIB
+  std::shared_ptr<std::vector<uint8_t>> inflated(
+    new std::vector<uint8_t>((size_t)entry.size));
+  uLongf inflatedSize = (uLongf)entry.size;
+  int result = uncompress(&(*inflated)[0], &inflatedSize,
+    base + entry.offset, (uLong)entry.storedSize);
+  if (Z_OK != result || inflatedSize != entry.size) {
+    FAIL("Unable to inflate resource %s (%d)", path.c_str(), result);
+  }
+  out = ResourceView(inflated);
+  return true;
+#else
+  return false;
+#endif
+}
+
+ResourcePack & ResourcePack::instance() {
+  static ResourcePack pack;
+  static std::once_flag opened;
+  std::call_once(opened, [&]{
+    const char * path = getenv("RIFT_RESOURCE_PACK");
+#ifdef RESOURCE_PACK_FILE
+    if (!path) {
+      path = RESOURCE_PACK_FILE;
+    }
+#endif
+    if (path && pack.open(path)) {
+      SAY("Mapped %d resources from %s", (int)pack.count(), path);
+    }
+  });
+  return pack;
+}
@@ -0,0 +1,166 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+// This header is shared with the pack_resources tool, so it must not
+// depend on anything pulled in by Common.h
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Matches the platform detection in Config.h, which the tool doesn't see
+#if !defined(OS_WIN) && (defined(WIN64) || defined(WIN32))
+#define OS_WIN
+#endif
+
+/**
+ * A read-only window onto the contents of a resource.  Views into the
+ * memory mapped resource pack are valid for the lifetime of the process.
+ * Views that had to be read into heap memory hold a reference to that
+ * memory, so copying the view is always cheap and always safe.
+ */
+struct ResourceView {
+  const uint8_t * data{ nullptr };
+  size_t size{ 0 };
+  std::shared_ptr<const void> owner;
+
+  ResourceView() {
+  }
+
+  ResourceView(const void * data, size_t size)
+    : data(static_cast<const uint8_t *>(data)), size(size) {
+  }
+
+  explicit ResourceView(std::shared_ptr<std::vector<uint8_t>> buffer)
+    : data(buffer->empty() ? nullptr : &(*buffer)[0]), size(buffer->size()), owner(buffer) {
+  }
+
+  bool empty() const {
+    return 0 == size;
+  }
+
+  const uint8_t * begin() const {
+    return data;
+  }
+
+  const uint8_t * end() const {
+    return data + size;
+  }
+
+  const char * chars() const {
+    return reinterpret_cast<const char *>(data);
+  }
+
+  std::string toString() const {
+    return std::string(chars(), size);
+  }
+};
+
+/**
+ * A single file containing all of the example resources, memory mapped
+ * once and then handed out as ResourceViews.
+ *
+ * Layout (little endian):
+ *   header   : "ORPK", uint32 version, uint32 entry count, uint32 reserved
+ *   entries  : uint64 offset, uint64 size, uint64 stored size, uint32 flags,
+ *              uint32 reserved, uint32 path length, path bytes
+ *   data     : each entry's content, aligned to DATA_ALIGNMENT bytes
+ *
+ * Entries are keyed by the resource path relative to the resource root,
+ * which is what Resources::getResourcePath() returns.
+ *
+ * Entries flagged as COMPRESSED hold a zlib stream of 'stored size' bytes
+ * which inflates to 'size' bytes.  Views of those entries own their
+ * inflated copy.  Small or incompressible entries are always stored raw.
+ */
+class ResourcePack {
+public:
+  // "ORPK" read as a little endian integer
+  static const uint32_t MAGIC = 0x4B50524F;
+  static const uint32_t VERSION = 2;
+  static const uint32_t DATA_ALIGNMENT = 16;
+  // Entries smaller than this aren't worth the cost of inflating
+  static const uint32_t MIN_COMPRESSED_SIZE = 4096;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+  };
+
+  enum EntryFlags {
+    COMPRESSED = 0x01,
+  };
+
+  struct Entry {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t storedSize;
+    uint32_t flags;
+    uint32_t reserved;
+  };
+
+private:
+  typedef std::unordered_map<std::string, Entry> EntryMap;
+
+  const uint8_t * base{ nullptr };
+  size_t length{ 0 };
+  EntryMap entries;
+  bool compressed{ false };
+#ifdef OS_WIN
+  void * fileHandle{ nullptr };
+  void * mappingHandle{ nullptr };
+#endif
+
+public:
+  ResourcePack() {
+  }
+  ~ResourcePack();
+
+  bool open(const std::string & path);
+  void close();
+
+  bool isOpen() const {
+    return nullptr != base;
+  }
+
+  size_t count() const {
+    return entries.size();
+  }
+
+  bool isCompressed() const {
+    return compressed;
+  }
+
+  // Thread safe, so batches of compressed entries can be inflated in parallel
+  bool find(const std::string & path, ResourceView & out) const;
+
+  // The process wide pack, opened on first use
+  static ResourcePack & instance();
+
+private:
+  bool parse();
+  ResourcePack(const ResourcePack &);
+  ResourcePack & operator=(const ResourcePack &);
+};
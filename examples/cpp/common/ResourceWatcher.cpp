@@ -0,0 +1,135 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "Common.h"
+
+#if defined(RIFT_DEBUG) && defined(OS_LINUX)
+#define WATCH_RESOURCES 1
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ResourceWatcher::ResourceWatcher() {
+#ifdef WATCH_RESOURCES
+  notifier = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notifier < 0) {
+    SAY_ERR("Unable to watch resources for changes");
+  }
+#endif
+}
+
+ResourceWatcher::~ResourceWatcher() {
+#ifdef WATCH_RESOURCES
+  if (notifier >= 0) {
+    close(notifier);
+  }
+#endif
+}
+
+std::string ResourceWatcher::getResourceFile(Resource resource) {
+#ifdef RESOURCE_ROOT
+  return std::string(RESOURCE_ROOT) + "/" + Resources::getResourcePath(resource);
+#else
+  return std::string(PROJECT_DIR) + "/resources/" + Resources::getResourcePath(resource);
+#endif
+}
+
+void ResourceWatcher::track(Resource resource) {
+#ifdef WATCH_RESOURCES
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!loaded.insert(resource).second || notifier < 0) {
+    return;
+  }
+
+  std::string file = getResourceFile(resource);
+  paths[file] = resource;
+
+  // Editors frequently save by replacing the file, which would orphan a
+  // watch on the file itself, so watch the containing directory instead
+  std::string directory = file.substr(0, file.find_last_of('/'));
+  int watch = inotify_add_watch(notifier, directory.c_str(),
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  if (watch >= 0) {
+    watches[watch] = directory;
+  }
+#endif
+}
+
+void ResourceWatcher::onChange(Resource resource, Callback callback) {
+#ifdef WATCH_RESOURCES
+  track(resource);
+  std::lock_guard<std::mutex> lock(mutex);
+  callbacks.insert(CallbackMap::value_type(resource, callback));
+#endif
+}
+
+void ResourceWatcher::poll() {
+#ifdef WATCH_RESOURCES
+  if (notifier < 0) {
+    return;
+  }
+
+  // Collapse the burst of events a single save generates into one reload
+  std::set<Resource> changed;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(notifier, buffer, sizeof(buffer))) > 0) {
+      for (char * ptr = buffer; ptr < buffer + length; ) {
+        const struct inotify_event * event = (const struct inotify_event *)ptr;
+        ptr += sizeof(struct inotify_event) + event->len;
+        WatchMap::const_iterator watch = watches.find(event->wd);
+        if (watches.end() == watch || !event->len) {
+          continue;
+        }
+        PathMap::const_iterator path = paths.find(watch->second + "/" + event->name);
+        if (paths.end() != path) {
+          changed.insert(path->second);
+        }
+      }
+    }
+  }
+
+  std::for_each(changed.begin(), changed.end(), [&](Resource resource) {
+    std::vector<Callback> toRun;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto range = callbacks.equal_range(resource);
+      for (CallbackMap::iterator itr = range.first; itr != range.second; ++itr) {
+        toRun.push_back(itr->second);
+      }
+    }
+    SAY("Reloading %s", Resources::getResourcePath(resource).c_str());
+    std::for_each(toRun.begin(), toRun.end(), [&](const Callback & callback) {
+      try {
+        callback();
+      } catch (std::exception & error) {
+        // Leave the old object in place, and keep running
+        SAY_ERR(error.what());
+      }
+    });
+  });
+#endif
+}
+
+ResourceWatcher & ResourceWatcher::instance() {
+  static ResourceWatcher watcher;
+  return watcher;
+}
@@ -0,0 +1,68 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * Debug build support for editing resources while an example is running.
+ *
+ * Every resource the app loads is tracked, and on Linux the directories
+ * containing them are watched with inotify.  Objects built from a resource
+ * register a reload callback, which poll() runs on the calling (render)
+ * thread, so callbacks are free to make GL calls.  Only the objects that
+ * depend on the modified files are rebuilt.
+ *
+ * In release builds, or on platforms without inotify, this does nothing.
+ */
+class ResourceWatcher {
+public:
+  typedef std::function<void()> Callback;
+
+private:
+  typedef std::multimap<Resource, Callback> CallbackMap;
+  typedef std::map<std::string, Resource> PathMap;
+  typedef std::map<int, std::string> WatchMap;
+
+  std::mutex mutex;
+  std::set<Resource> loaded;
+  CallbackMap callbacks;
+  PathMap paths;
+  WatchMap watches;
+  int notifier{ -1 };
+
+public:
+  ResourceWatcher();
+  ~ResourceWatcher();
+
+  // Record that the app has loaded the resource, and start watching its file
+  void track(Resource resource);
+
+  // Run the callback on the render thread whenever the resource changes
+  void onChange(Resource resource, Callback callback);
+
+  // Dispatch any pending changes.  Call between frames on the GL thread.
+  void poll();
+
+  const std::set<Resource> & getLoaded() const {
+    return loaded;
+  }
+
+  static std::string getResourceFile(Resource resource);
+  static ResourceWatcher & instance();
+};
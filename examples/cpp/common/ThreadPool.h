@@ -0,0 +1,181 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+// Self contained so that the offline tools can share it
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads for CPU bound jobs (decompression, image
+ * decoding and the like).  Nothing here touches OpenGL, so results have to
+ * be handed back to the GL thread by the caller.
+ */
+class ThreadPool {
+  typedef std::function<void()> Task;
+  typedef std::unique_lock<std::mutex> Locker;
+
+  std::vector<std::thread> workers;
+  std::queue<Task> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping{ false };
+
+public:
+  explicit ThreadPool(size_t threadCount = 0) {
+    if (0 == threadCount) {
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+      workers.push_back(std::thread([this]{
+        workerLoop();
+      }));
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      Locker lock(mutex);
+      stopping = true;
+    }
+    condition.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i].join();
+    }
+  }
+
+  size_t size() const {
+    return workers.size();
+  }
+
+  template <typename F>
+  auto submit(F f) -> std::future<decltype(f())> {
+    typedef decltype(f()) Result;
+    std::shared_ptr<std::packaged_task<Result()>> task(
+      new std::packaged_task<Result()>(f));
+    std::future<Result> result = task->get_future();
+    {
+      Locker lock(mutex);
+      tasks.push([task]{
+        (*task)();
+      });
+    }
+    condition.notify_one();
+    return result;
+  }
+
+  /**
+   * Calls f(i) for every i in [0, count) and returns once all of them have
+   * completed.  The calling thread works through the range as well, so this
+   * is safe to call from inside a pool task.  The first exception thrown by
+   * any call is rethrown here.
+   */
+  template <typename F>
+  void parallelFor(size_t count, F f) {
+    struct State {
+      std::atomic<size_t> next;
+      std::atomic<size_t> completed;
+      std::mutex mutex;
+      std::condition_variable done;
+      std::exception_ptr error;
+    };
+    if (0 == count) {
+      return;
+    }
+
+    std::shared_ptr<State> state(new State());
+    state->next = 0;
+    state->completed = 0;
+    std::function<void()> work = [state, count, f] {
+      size_t index;
+      while ((index = state->next++) < count) {
+        try {
+          f(index);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          if (!state->error) {
+            state->error = std::current_exception();
+          }
+        }
+        if (++state->completed == count) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          state->done.notify_all();
+        }
+      }
+    };
+
+    size_t helpers = std::min(count - 1, workers.size());
+    {
+      Locker lock(mutex);
+      for (size_t i = 0; i < helpers; ++i) {
+        tasks.push(work);
+      }
+    }
+    condition.notify_all();
+
+    work();
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->done.wait(lock, [&]{
+        return state->completed == count;
+      });
+    }
+    if (state->error) {
+      std::rethrow_exception(state->error);
+    }
+  }
+
+  // The shared, process wide pool
+  static ThreadPool & instance() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+private:
+  void workerLoop() {
+    while (true) {
+      Task task;
+      {
+        Locker lock(mutex);
+        condition.wait(lock, [&]{
+          return stopping || !tasks.empty();
+        });
+        if (stopping && tasks.empty()) {
+          return;
+        }
+        task = tasks.front();
+        tasks.pop();
+      }
+      task();
+    }
+  }
+
+  ThreadPool(const ThreadPool &);
+  ThreadPool & operator=(const ThreadPool &);
+};
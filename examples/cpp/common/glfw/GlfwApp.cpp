@@ -71,6 +71,7 @@ GlfwApp::~GlfwApp() {
 
 int GlfwApp::run() {
   try {
+    prefetchResources();
     preCreate();
     window = createRenderingTarget(windowSize, windowPosition);
     postCreate();
@@ -86,14 +87,29 @@ int GlfwApp::run() {
       shutdownGl();
     });
 
+    const char * capturePath = getenv("RIFT_CAPTURE");
+    if (capturePath) {
+      capture.reset(new FrameCapture(getCaptureSize(), capturePath));
+      const char * frames = getenv("RIFT_CAPTURE_FRAMES");
+      if (frames) {
+        captureLimit = strtoull(frames, nullptr, 10);
+      }
+    }
+
     int framecount = 0;
     long start = Platform::elapsedMillis();
     while (!glfwWindowShouldClose(window)) {
       glfwPollEvents();
+#ifdef RIFT_DEBUG
+      // Rebuild anything whose source files were edited since the last frame
+      ResourceWatcher::instance().poll();
+#endif
       ++frame;
       update();
       draw();
+      captureFrame();
       finishFrame();
+      TextureCache::instance().endFrame();
       long now = Platform::elapsedMillis();
       ++framecount;
       if ((now - start) >= 2000) {
@@ -116,6 +132,9 @@ int GlfwApp::getFrame() const {
   return this->frame;
 }
 
+void GlfwApp::prefetchResources() {
+}
+
 void GlfwApp::preCreate() {
   glfwWindowHint(GLFW_DEPTH_BITS, 16);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -191,6 +210,8 @@ void GlfwApp::initGl() {
 }
 
 void GlfwApp::shutdownGl() {
+  // Finishes writing whatever is still in flight
+  capture.reset();
   Platform::runShutdownHooks();
 }
 
@@ -243,23 +264,41 @@ void GlfwApp::renderStringAt(const std::string & string, float x, float y) {
 }
 
 void GlfwApp::screenshot() {
-  //#ifdef HAVE_OPENCV
-  //    //use fast 4-byte alignment (default anyway) if possible
-  //    glFlush();
-  //    cv::Mat img(windowSize.y, windowSize.x, CV_8UC3);
-  //    glPixelStorei(GL_PACK_ALIGNMENT, (img.step & 3) ? 1 : 4);
-  //    glPixelStorei(GL_PACK_ROW_LENGTH, img.step / img.elemSize());
-  //    glReadPixels(0, 0, img.cols, img.rows, GL_BGR, GL_UNSIGNED_BYTE, img.data);
-  //    cv::flip(img, img, 0);
-  //
-  //    static int counter = 0;
-  //    static char buffer[128];
-  //    sprintf(buffer, "screenshot%05i.png", counter++);
-  //    bool success = cv::imwrite(buffer, img);
-  //    if (!success) {
-  //      throw std::runtime_error("Failed to write image");
-  //    }
-  //#endif
+  // Key events arrive before the frame is drawn, so take it afterwards
+  screenshotRequested = true;
+}
+
+glm::uvec2 GlfwApp::getCaptureSize() {
+  return windowSize;
+}
+
+void GlfwApp::readCaptureFrame(FrameCapture & capture) {
+  capture.read(0, uvec2(0), windowSize);
+}
+
+// Called between drawing a frame and presenting it
+void GlfwApp::captureFrame() {
+  if (screenshotRequested) {
+    screenshotRequested = false;
+    static uint64_t counter = 0;
+    // Waits for the image to be written, which is fine for a screenshot
+    FrameCapture shot(getCaptureSize(), "screenshot%05d.png", 1, 1);
+    shot.setFrameNumber(counter++);
+    shot.beginFrame();
+    readCaptureFrame(shot);
+    shot.endFrame();
+  }
+
+  if (!capture) {
+    return;
+  }
+  if (capture->beginFrame()) {
+    readCaptureFrame(*capture);
+    capture->endFrame();
+  }
+  if (captureLimit && capture->getFrameCount() >= captureLimit) {
+    glfwSetWindowShouldClose(window, 1);
+  }
 }
 
 
@@ -25,6 +25,12 @@ private:
   glm::uvec2    windowSize;
   glm::ivec2    windowPosition;
   int           frame{ 0 };
+  // Recording of every frame, started by setting RIFT_CAPTURE to a path
+  // FrameCapture understands.  If RIFT_CAPTURE_FRAMES is set as well, the
+  // application exits after that many, for golden image runs.
+  std::unique_ptr<FrameCapture> capture;
+  uint64_t      captureLimit{ 0 };
+  bool          screenshotRequested{ false };
 
 protected:
   float         windowAspect{ 1.0f };
@@ -45,6 +51,9 @@ protected:
   const glm::ivec2 & getPosition() const;
   GLFWwindow * getWindow();
 
+  // Called before the window is created, so that assets can be read in
+  // the background meanwhile.  Does nothing by default.
+  virtual void prefetchResources();
   virtual void preCreate();
   virtual void postCreate();
   virtual void initGl();
@@ -62,6 +71,9 @@ protected:
   virtual void viewport(const glm::vec2 & size, const glm::vec2 & pos = vec2(0));
   virtual void renderStringAt(const std::string & string, float x, float y);
   virtual void renderStringAt(const std::string & string, const glm::vec2 & position);
+  // What a captured frame holds, the window by default
+  virtual glm::uvec2 getCaptureSize();
+  virtual void readCaptureFrame(FrameCapture & capture);
 
 private:
 
@@ -73,5 +85,6 @@ private:
   friend void ScrollCallback(GLFWwindow * window, double x, double y);
 
   virtual void screenshot();
+  void captureFrame();
 };
 
@@ -0,0 +1,159 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "Common.h"
+
+namespace oria {
+
+  UploadQueue::UploadQueue(GLFWwindow * shareWith) {
+    glfwWindowHint(GLFW_VISIBLE, 0);
+    window = glfwCreateWindow(1, 1, "Uploads", nullptr, shareWith);
+    glfwWindowHint(GLFW_VISIBLE, 1);
+    if (!window) {
+      FAIL("Unable to create the upload context");
+    }
+    thread = std::thread(&UploadQueue::uploadLoop, this);
+  }
+
+  UploadQueue::~UploadQueue() {
+    {
+      Locker lock(mutex);
+      stopping = true;
+    }
+    condition.notify_all();
+    thread.join();
+    // Whatever finished but was never polled is dropped
+    while (!completions.empty()) {
+      if (completions.front().fence) {
+        glDeleteSync(completions.front().fence);
+      }
+      completions.pop();
+    }
+    glfwDestroyWindow(window);
+  }
+
+  void UploadQueue::enqueue(const Task & job, const Task & onReady) {
+    {
+      Locker lock(mutex);
+      jobs.push(std::make_pair(job, onReady));
+    }
+    condition.notify_one();
+  }
+
+  void UploadQueue::uploadLoop() {
+    glfwMakeContextCurrent(window);
+    // Each thread requires its own glewInit call
+    glewInit();
+    while (true) {
+      std::pair<Task, Task> job;
+      {
+        Locker lock(mutex);
+        condition.wait(lock, [&]{
+          return stopping || !jobs.empty();
+        });
+        if (stopping) {
+          break;
+        }
+        job = jobs.front();
+        jobs.pop();
+      }
+
+      Completion completion;
+      completion.onReady = job.second;
+      try {
+        job.first();
+      } catch (...) {
+        completion.error = std::current_exception();
+      }
+      // The flush makes sure the fence reaches the GPU, or the render
+      // thread could wait on it forever
+      completion.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      glFlush();
+
+      Locker lock(mutex);
+      completions.push(completion);
+    }
+    glfwMakeContextCurrent(nullptr);
+  }
+
+  int UploadQueue::poll() {
+    std::vector<Completion> ready;
+    {
+      Locker lock(mutex);
+      while (!completions.empty()) {
+        Completion & completion = completions.front();
+        GLenum status = glClientWaitSync(completion.fence, 0, 0);
+        if (GL_ALREADY_SIGNALED != status && GL_CONDITION_SATISFIED != status) {
+          break;
+        }
+        glDeleteSync(completion.fence);
+        ready.push_back(completion);
+        completions.pop();
+      }
+    }
+    // A failure mustn't cost the jobs after it their callbacks, so only
+    // the first one is rethrown, at the end
+    std::exception_ptr error;
+    for (size_t i = 0; i < ready.size(); ++i) {
+      if (ready[i].error) {
+        if (!error) {
+          error = ready[i].error;
+        }
+        continue;
+      }
+      try {
+        ready[i].onReady();
+      } catch (...) {
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return (int)ready.size();
+  }
+
+  void UploadQueue::loadTexture(Resource resource, std::function<void(TexturePtr, uvec2)> onReady, MipFilter mips) {
+    struct Loaded {
+      TexturePtr texture;
+      uvec2 size;
+    };
+    submit([=] {
+      Loaded loaded;
+      ResourceView data = Platform::getResourceView(resource);
+      DecodeTimer timer(resource);
+      loaded.texture = load2dTexture(data, loaded.size, mips);
+      return loaded;
+    }, [=](const Loaded & loaded) {
+      onReady(loaded.texture, loaded.size);
+    });
+  }
+
+  void UploadQueue::loadShape(const std::vector<const GLchar*> & names, Resource resource, ProgramPtr program,
+      std::function<void(ShapeWrapperPtr)> onReady) {
+    submit([=] {
+      return prepareShape(names, resource, program);
+    }, [=](const std::function<ShapeWrapperPtr()> & build) {
+      onReady(build());
+    });
+  }
+
+}
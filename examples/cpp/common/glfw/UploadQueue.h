@@ -0,0 +1,88 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+namespace oria {
+
+  /**
+   * Loads textures and meshes on a thread of its own, so big uploads don't
+   * stall the thread feeding the Rift.
+   *
+   * The thread owns a hidden window whose context shares objects with the
+   * app's.  Each job runs with that context current and is followed by a
+   * fence.  Once poll() on the render thread sees the fence signaled, the
+   * job's result is handed to its callback there, in submission order.
+   *
+   * Vertex arrays aren't shared between contexts, so mesh jobs only decode
+   * on the upload thread, and the shape itself is built in poll().
+   *
+   * The queue must be created and destroyed on the main thread, since
+   * that's where GLFW creates windows.
+   */
+  class UploadQueue {
+    typedef std::function<void()> Task;
+    typedef std::unique_lock<std::mutex> Locker;
+
+    struct Completion {
+      GLsync fence;
+      Task onReady;
+      std::exception_ptr error;
+    };
+
+    GLFWwindow * window{ nullptr };
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::queue<std::pair<Task, Task>> jobs;
+    std::queue<Completion> completions;
+    bool stopping{ false };
+
+    void uploadLoop();
+    void enqueue(const Task & job, const Task & onReady);
+
+  public:
+    explicit UploadQueue(GLFWwindow * shareWith);
+    ~UploadQueue();
+
+    // Runs job() on the upload thread, and later onReady(result) on the
+    // thread calling poll().  Anything thrown by the job is rethrown from
+    // poll(), once every other job it collected has had its onReady() run.
+    template <typename Job, typename Ready>
+    void submit(Job job, Ready onReady) {
+      typedef decltype(job()) Result;
+      std::shared_ptr<Result> result(new Result());
+      enqueue([=] {
+        *result = job();
+      }, [=] {
+        onReady(*result);
+      });
+    }
+
+    void loadTexture(Resource resource, std::function<void(TexturePtr, uvec2)> onReady,
+      MipFilter mips = MIP_NONE);
+    void loadShape(const std::vector<const GLchar*> & names, Resource resource, ProgramPtr program,
+      std::function<void(ShapeWrapperPtr)> onReady);
+
+    // Call once per frame on the render thread.  Returns the number of
+    // jobs completed.
+    int poll();
+  };
+
+}
@@ -59,16 +59,16 @@ struct QuadBuilder {
 };
 
 void readPngToTexture(const char * data, size_t size,  TexturePtr & texture, glm::vec2 & textureSize) {
-  using namespace oglplus;
-  std::vector<uint8_t> pngData(size);
-  memcpy(&pngData[0], data, size);
-  ImagePtr image = oria::loadImage(pngData);
-  textureSize = glm::vec2(image->Width(), image->Height());
-  texture = oria::load2dTextureFromPngData(pngData);
+  // Straight out of the font data, which the asset baker may have 
+  // replaced with a pre-decoded atlas
+  uvec2 size2d;
+  texture = oria::loadDistanceFieldTexture(ResourceView(data, size), size2d);
+  textureSize = glm::vec2(size2d);
 }
 
 void Font::read(const void * data, size_t size) {
-  std::istringstream in(std::string(static_cast<const char*>(data), size));
+  MemoryStreamBuf buffer(data, size);
+  std::istream in(&buffer);
 //  SignedDistanceFontFile sdff;
 //  sdff.read(in);
 
@@ -0,0 +1,317 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#include "Common.h"
+
+#ifdef HAVE_OPENCV
+#include <opencv2/opencv.hpp>
+#else
+#include <png.h>
+#endif
+
+static bool endsWith(const std::string & str, const std::string & suffix) {
+  return str.size() >= suffix.size() &&
+    0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix);
+}
+
+FrameCapture::FrameCapture(const uvec2 & size, const std::string & path, int frameRate, int slotCount)
+  : path(path), size(size), frameRate(frameRate), slots(slotCount) {
+  // Enough to keep every worker busy, with the next frame queued behind
+  maxEncoding = 2 * (int)ThreadPool::instance().size();
+  if (endsWith(path, ".png")) {
+    format = PNG;
+    parsePattern();
+  } else if (endsWith(path, ".y4m")) {
+    format = Y4M;
+    // 4:2:0 needs whole chroma samples
+    this->size &= ~uvec2(1);
+    stream = fopen(path.c_str(), "wb");
+    if (!stream) {
+      FAIL("Unable to open %s for capture", path.c_str());
+    }
+    fprintf(stream, "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 C420jpeg\n", this->size.x, this->size.y, frameRate);
+  } else {
+    FAIL("Unknown capture format for %s", path.c_str());
+  }
+
+  size_t bytes = this->size.x * this->size.y * 4;
+  for (size_t i = 0; i < slots.size(); ++i) {
+    glGenBuffers(1, &slots[i].buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameCapture::~FrameCapture() {
+  retire(true);
+  {
+    Locker lock(mutex);
+    idle.wait(lock, [&]{
+      return 0 == encoding;
+    });
+  }
+  for (size_t i = 0; i < slots.size(); ++i) {
+    glDeleteBuffers(1, &slots[i].buffer);
+  }
+  if (stream) {
+    fclose(stream);
+  }
+  if (dropped) {
+    SAY("Captured %d frames to %s, dropped %d", (int)captured, path.c_str(), (int)dropped);
+  }
+}
+
+// The path comes from the user, so it isn't trusted as a format string
+void FrameCapture::parsePattern() {
+  size_t percent = path.find('%');
+  size_t end = percent;
+  if (std::string::npos != percent) {
+    ++end;
+    if (end < path.size() && '0' == path[end]) {
+      fill = '0';
+      ++end;
+    }
+    while (end < path.size() && path[end] >= '0' && path[end] <= '9') {
+      width = width * 10 + (path[end++] - '0');
+    }
+  }
+  if (std::string::npos == percent || end >= path.size() || 'd' != path[end] ||
+      std::string::npos != path.find('%', end) || width > 20) {
+    FAIL("%s needs a single %%d for the frame number, such as capture/frame%%05d.png", path.c_str());
+  }
+  prefix = path.substr(0, percent);
+  suffix = path.substr(end + 1);
+}
+
+bool FrameCapture::beginFrame() {
+  poll();
+  ++frameCount;
+  {
+    Locker lock(mutex);
+    if (encoding >= maxEncoding) {
+      ++dropped;
+      return false;
+    }
+  }
+  // Slots in flight are the fenced ones
+  for (size_t i = 0; i < slots.size(); ++i) {
+    if (!slots[i].fence) {
+      writing = (int)i;
+      slots[i].sequence = captured++;
+      return true;
+    }
+  }
+  ++dropped;
+  return false;
+}
+
+void FrameCapture::read(GLuint framebuffer, const uvec2 & position, const uvec2 & readSize) {
+  if (-1 == writing) {
+    return;
+  }
+  uvec2 clipped = glm::min(readSize, size - glm::min(position, size));
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glReadBuffer(framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[writing].buffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glPixelStorei(GL_PACK_ROW_LENGTH, size.x);
+  size_t offset = (position.y * size.x + position.x) * 4;
+  glReadPixels(0, 0, clipped.x, clipped.y, GL_RGBA, GL_UNSIGNED_BYTE, (void *)offset);
+  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void FrameCapture::read(FramebufferWrapper & framebuffer, const uvec2 & position) {
+  read(oglplus::GetName(framebuffer.fbo), position, framebuffer.size);
+}
+
+void FrameCapture::endFrame() {
+  if (-1 == writing) {
+    return;
+  }
+  slots[writing].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  reading.push_back(writing);
+  writing = -1;
+}
+
+void FrameCapture::poll() {
+  retire(false);
+}
+
+// Copies finished reads out of their buffers, in order, and queues them
+// for encoding.  Waiting is only for the destructor.
+void FrameCapture::retire(bool wait) {
+  static const GLuint64 ONE_SECOND = 1000000000;
+  const size_t bytes = size.x * size.y * 4;
+  while (!reading.empty()) {
+    Slot & slot = slots[reading.front()];
+    GLenum status = glClientWaitSync(slot.fence,
+      wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? ONE_SECOND : 0);
+    if (wait && GL_TIMEOUT_EXPIRED == status) {
+      continue;
+    }
+    if (GL_ALREADY_SIGNALED != status && GL_CONDITION_SATISFIED != status) {
+      break;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    reading.pop_front();
+
+    PixelBufferPtr pixels = acquirePixelBuffer();
+    pixels->resize(bytes);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void * mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    if (!mapped) {
+      FAIL("Unable to map capture buffer");
+    }
+    memcpy(&(*pixels)[0], mapped, bytes);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    encode(slot.sequence, pixels);
+  }
+}
+
+void FrameCapture::encode(uint64_t sequence, PixelBufferPtr pixels) {
+  {
+    Locker lock(mutex);
+    ++encoding;
+  }
+  ThreadPool::instance().submit([=] {
+    try {
+      if (PNG == format) {
+        writePng(sequence, &(*pixels)[0]);
+      } else {
+        writeY4m(sequence, &(*pixels)[0]);
+      }
+    } catch (std::exception & error) {
+      SAY_ERR("Frame capture failed: %s", error.what());
+    }
+    Locker lock(mutex);
+    if (0 == --encoding) {
+      idle.notify_all();
+    }
+  });
+}
+
+void FrameCapture::writePng(uint64_t sequence, const uint8_t * pixels) {
+  std::string number = std::to_string(sequence);
+  if (number.size() < width) {
+    number.insert(0, width - number.size(), fill);
+  }
+  const std::string filename = prefix + number + suffix;
+#ifdef HAVE_OPENCV
+  cv::Mat rgba(size.y, size.x, CV_8UC4, const_cast<uint8_t *>(pixels));
+  cv::Mat bgr;
+  cv::cvtColor(rgba, bgr, cv::COLOR_RGBA2BGR);
+  cv::flip(bgr, bgr, 0);
+  if (!cv::imwrite(filename, bgr)) {
+    FAIL("Unable to write %s", filename.c_str());
+  }
+#else
+  png_image image;
+  memset(&image, 0, sizeof(image));
+  image.version = PNG_IMAGE_VERSION;
+  image.width = size.x;
+  image.height = size.y;
+  image.format = PNG_FORMAT_RGB;
+  // Drop the alpha, which is rarely meaningful in a framebuffer, and
+  // write the rows bottom up, which flips them back the right way
+  std::vector<uint8_t> rgb(size.x * size.y * 3);
+  for (size_t i = 0, count = size.x * size.y; i < count; ++i) {
+    memcpy(&rgb[i * 3], pixels + i * 4, 3);
+  }
+  int stride = -(int)(size.x * 3);
+  if (!png_image_write_to_file(&image, filename.c_str(), 0, &rgb[0], stride, nullptr)) {
+    FAIL("Unable to write %s: %s", filename.c_str(), image.message);
+  }
+#endif
+}
+
+// Full range BT.601, as the C420jpeg tag says, in 16 bit fixed point
+static inline uint8_t lumaOf(const uint8_t * p) {
+  return (uint8_t)((19595 * p[0] + 38470 * p[1] + 7471 * p[2] + 32768) >> 16);
+}
+
+void FrameCapture::writeY4m(uint64_t sequence, const uint8_t * pixels) {
+  PixelBufferPtr yuv;
+  std::exception_ptr error;
+  try {
+    yuv = convertY4m(pixels);
+  } catch (...) {
+    // Still takes its place in the sequence, or every later frame would
+    // wait on it forever
+    error = std::current_exception();
+    ++dropped;
+  }
+
+  // Converted in any order, but written in sequence
+  {
+    Locker lock(mutex);
+    pendingWrites[sequence] = yuv;
+    while (!pendingWrites.empty() && pendingWrites.begin()->first == nextWrite) {
+      const PixelBufferPtr & frame = pendingWrites.begin()->second;
+      if (frame) {
+        fputs("FRAME\n", stream);
+        fwrite(&(*frame)[0], 1, frame->size(), stream);
+      }
+      pendingWrites.erase(pendingWrites.begin());
+      ++nextWrite;
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+PixelBufferPtr FrameCapture::convertY4m(const uint8_t * pixels) {
+  const uint32_t width = size.x, height = size.y;
+  const uint32_t chromaWidth = width / 2, chromaHeight = height / 2;
+  PixelBufferPtr yuv = acquirePixelBuffer();
+  yuv->resize(width * height + chromaWidth * chromaHeight * 2);
+  uint8_t * luma = &(*yuv)[0];
+  uint8_t * cb = luma + width * height;
+  uint8_t * cr = cb + chromaWidth * chromaHeight;
+  const size_t stride = width * 4;
+  // GL rows run bottom up, Y4M top down
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t * row = pixels + (height - 1 - y) * stride;
+    for (uint32_t x = 0; x < width; ++x) {
+      luma[y * width + x] = lumaOf(row + x * 4);
+    }
+  }
+  for (uint32_t y = 0; y < chromaHeight; ++y) {
+    const uint8_t * top = pixels + (height - 1 - y * 2) * stride;
+    const uint8_t * bottom = top - stride;
+    for (uint32_t x = 0; x < chromaWidth; ++x) {
+      int sum[3];
+      for (int c = 0; c < 3; ++c) {
+        sum[c] = top[x * 8 + c] + top[x * 8 + 4 + c] + bottom[x * 8 + c] + bottom[x * 8 + 4 + c];
+      }
+      // Sums of four samples, so the averaging folds into the shift
+      int blue = (-11059 * sum[0] - 21709 * sum[1] + 32768 * sum[2] + (128 << 18) + (1 << 17)) >> 18;
+      int red = (32768 * sum[0] - 27439 * sum[1] - 5329 * sum[2] + (128 << 18) + (1 << 17)) >> 18;
+      cb[y * chromaWidth + x] = (uint8_t)std::min(255, std::max(0, blue));
+      cr[y * chromaWidth + x] = (uint8_t)std::min(255, std::max(0, red));
+    }
+  }
+  return yuv;
+}
@@ -0,0 +1,138 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+
+#pragma once
+
+/**
+ * Records what the application renders, without stalling it.
+ *
+ * Each frame is read back with glReadPixels into one of a ring of pixel
+ * pack buffers, so the read is queued on the GPU rather than waited on,
+ * and fenced.  A few frames later, once its fence has signaled, the frame
+ * is copied out of the buffer and handed to the worker pool, which
+ * encodes it.  If the GPU falls so far behind that every buffer is still
+ * in flight, or the encoders so far behind that two frames per worker are
+ * waiting on them, the frame is dropped rather than waiting.
+ *
+ * The output is picked by the extension of the path:
+ *
+ *  .png  One image per frame.  The path holds a single %d for the frame
+ *        number, optionally padded as in printf, such as
+ *        "capture/frame%05d.png", and the images are encoded in parallel.
+ *        Frames are numbered in the order captured, so dropped frames
+ *        leave no gaps.
+ *  .y4m  A single uncompressed YUV 4:2:0 stream, which ffmpeg and most
+ *        players read directly.  Frames are converted in parallel and
+ *        written in order.
+ *
+ * GlfwApp starts one from the RIFT_CAPTURE environment variable.  All of
+ * the methods belong to the GL thread, and the object must be destroyed
+ * while the context is still current, which waits for every frame in
+ * flight to be written.
+ */
+class FrameCapture {
+  enum Format {
+    PNG,
+    Y4M,
+  };
+
+  struct Slot {
+    GLuint buffer{ 0 };
+    GLsync fence{ 0 };
+    // In the order captured, which skips dropped frames
+    uint64_t sequence{ 0 };
+  };
+
+  typedef std::unique_lock<std::mutex> Locker;
+
+  Format format;
+  std::string path;
+  // A .png path split around its frame number, which is padded to the
+  // width with the fill character
+  std::string prefix;
+  std::string suffix;
+  size_t width{ 0 };
+  char fill{ ' ' };
+  uvec2 size;
+  int frameRate;
+  std::vector<Slot> slots;
+  // Slots in flight, oldest first
+  std::deque<int> reading;
+  int writing{ -1 };
+  uint64_t captured{ 0 };
+  uint64_t frameCount{ 0 };
+  // Also counts frames the workers failed to convert
+  std::atomic<uint64_t> dropped{ 0 };
+
+  // Shared with the workers
+  std::mutex mutex;
+  std::condition_variable idle;
+  int encoding{ 0 };
+  int maxEncoding{ 0 };
+  FILE * stream{ nullptr };
+  uint64_t nextWrite{ 0 };
+  std::map<uint64_t, PixelBufferPtr> pendingWrites;
+
+  void parsePattern();
+  void retire(bool wait);
+  void encode(uint64_t sequence, PixelBufferPtr pixels);
+  void writePng(uint64_t sequence, const uint8_t * pixels);
+  void writeY4m(uint64_t sequence, const uint8_t * pixels);
+  PixelBufferPtr convertY4m(const uint8_t * pixels);
+
+public:
+  FrameCapture(const uvec2 & size, const std::string & path, int frameRate = 75, int slotCount = 3);
+  ~FrameCapture();
+
+  // Starts reading back a frame, returning false if it has to be dropped
+  bool beginFrame();
+
+  // The number the next frame captured is written under, for .png
+  // captures.  They start at 0.
+  void setFrameNumber(uint64_t number) {
+    captured = number;
+  }
+
+  // Reads the color buffer of a framebuffer, 0 being the window's back
+  // buffer, into the frame with its lower left corner at the given place
+  void read(GLuint framebuffer, const uvec2 & position, const uvec2 & size);
+  void read(FramebufferWrapper & framebuffer, const uvec2 & position = uvec2(0));
+
+  void endFrame();
+
+  // Hands any frames the GPU has finished with to the encoders.  Called
+  // by beginFrame(), but worth calling every frame regardless.
+  void poll();
+
+  const uvec2 & getSize() const {
+    return size;
+  }
+
+  // Frames started, including any dropped
+  uint64_t getFrameCount() const {
+    return frameCount;
+  }
+
+  uint64_t getDroppedCount() const {
+    return dropped;
+  }
+};
+
+typedef std::shared_ptr<FrameCapture> FrameCapturePtr;
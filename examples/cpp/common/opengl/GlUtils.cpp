@@ -20,7 +20,6 @@
 #include "Common.h"
 
 #include "Font.h"
-#include <openctmpp.h>
 #pragma warning( disable : 4068 4244 4267 4065 4101 4244)
 #include <oglplus/bound/buffer.hpp>
 #include <oglplus/shapes/cube.hpp>
@@ -30,156 +29,31 @@
 #include <oglplus/shapes/sky_box.hpp>
 #include <oglplus/shapes/plane.hpp>
 #include <oglplus/opt/list_init.hpp>
-#include <oglplus/shapes/obj_mesh.hpp>
 
 namespace oglplus {
   namespace shapes {
 
-    /// Class providing attributes and instructions for drawing of mesh loaded from obj
-    class CtmMesh
+    /// Drawing instructions for an indexed triangle list.  It has no 
+    /// attributes or indices of its own: InterleavedShape uploads those 
+    /// itself and only hands this to ShapeWrapper for drawing.  The index 
+    /// type is all ShapeWrapper takes from IndexArray.
+    template <typename Index>
+    class IndexedTriangles
       : public DrawingInstructionWriter
       , public DrawMode
     {
     public:
-      typedef std::vector<GLuint> IndexArray;
+      typedef std::vector<Index> IndexArray;
 
     private:
-      struct _loading_options
-      {
-        bool load_normals;
-        bool load_tangents;
-        bool load_bitangents;
-        bool load_texcoords;
-        bool load_materials;
-
-        _loading_options(bool load_all = true)
-        {
-          All(load_all);
-        }
-
-        _loading_options& All(bool load_all = true)
-        {
-          load_normals = load_all;
-          load_tangents = load_all;
-          load_bitangents = load_all;
-          load_texcoords = load_all;
-          load_materials = load_all;
-          return *this;
-        }
-
-        _loading_options& Nothing(void)
-        {
-          return All(false);
-        }
-
-        _loading_options& Normals(bool load = true)
-        {
-          load_normals = load;
-          return *this;
-        }
-
-        _loading_options& Tangents(bool load = true)
-        {
-          load_tangents = load;
-          return *this;
-        }
-
-        _loading_options& Bitangents(bool load = true)
-        {
-          load_bitangents = load;
-          return *this;
-        }
-
-        _loading_options& TexCoords(bool load = true)
-        {
-          load_texcoords = load;
-          return *this;
-        }
-
-        _loading_options& Materials(bool load = true)
-        {
-          load_materials = load;
-          return *this;
-        }
-      };
-
-      /// The type of the index container returned by Indices()
-      // vertex positions
-      std::vector<float> _pos_data;
-      // vertex normals
-      std::vector<float> _nml_data;
-      // vertex tex coords
-      std::vector<float> _tex_data;
-      IndexArray _idx_data;
-      unsigned int _prim_count;
-
-
-      struct _vert_indices
-      {
-        GLuint _pos;
-        GLuint _nml;
-        GLuint _tex;
-        GLuint _mtl;
-
-        _vert_indices(void)
-          : _pos(0)
-          , _nml(0)
-          , _tex(0)
-          , _mtl(0)
-        { }
-      };
-
-      bool _load_index(
-        GLuint& value,
-        GLuint count,
-        std::string::const_iterator& i,
-        std::string::const_iterator& e
-        );
-
-      void _call_load_meshes(
-        Resource resource,
-        aux::AnyInputIter<const char*> names_begin,
-        aux::AnyInputIter<const char*> names_end,
-        _loading_options opts
-        ) {
-
-        CTMimporter importer;
-        importer.LoadData(Platform::getResourceString(resource));
-        int vertexCount = importer.GetInteger(CTM_VERTEX_COUNT);
-        {
-          const float * ctmData = importer.GetFloatArray(CTM_VERTICES);
-          _pos_data = std::vector<float>(ctmData, ctmData + (vertexCount * 3));
-        }
-
-        if (opts.load_texcoords && importer.GetInteger(CTM_UV_MAP_COUNT)) {
-          const float * ctmData = importer.GetFloatArray(CTM_UV_MAP_1);
-          _tex_data = std::vector<float>(ctmData, ctmData + (vertexCount * 2));
-        }
-
-        if (opts.load_normals && importer.GetInteger(CTM_HAS_NORMALS)) {
-          const float * ctmData = importer.GetFloatArray(CTM_NORMALS);
-          _nml_data = std::vector<float>(ctmData, ctmData + (vertexCount * 3));
-        }
-
-        {
-          _prim_count = importer.GetInteger(CTM_TRIANGLE_COUNT);
-          int indexCount = 3 * _prim_count;
-          const CTMuint * ctmIntData = importer.GetIntegerArray(CTM_INDICES);
-          _idx_data = IndexArray(ctmIntData, ctmIntData + indexCount);
-        }
-      }
+      GLuint _index_count;
+      Spheref _bounding_sphere;
 
     public:
-      typedef _loading_options LoadingOptions;
-
-      CtmMesh(
-        Resource resource,
-        LoadingOptions opts = LoadingOptions()
-        )
-      {
-        const char** p = nullptr;
-        _call_load_meshes(resource, p, p, opts);
-      }
+      IndexedTriangles(GLuint index_count, const Spheref & bounding_sphere)
+        : _index_count(index_count)
+        , _bounding_sphere(bounding_sphere)
+      { }
 
       /// Returns the winding direction of faces
       FaceOrientation FaceWinding(void) const
@@ -187,104 +61,30 @@ namespace oglplus {
         return FaceOrientation::CCW;
       }
 
-      typedef GLuint(CtmMesh::*VertexAttribFunc)(std::vector<GLfloat>&) const;
-
-      /// Makes the vertex positions and returns the number of values per vertex
       template <typename T>
       GLuint Positions(std::vector<T>& dest) const
-      {
-        dest.clear();
-        dest.insert(dest.begin(), _pos_data.begin(), _pos_data.end());
-        return 3;
-      }
-
-      /// Makes the vertex normals and returns the number of values per vertex
-      template <typename T>
-      GLuint Normals(std::vector<T>& dest) const
-      {
-        dest.clear();
-        dest.insert(dest.begin(), _nml_data.begin(), _nml_data.end());
-        return 3;
-      }
-
-      /// Makes the vertex tangents and returns the number of values per vertex
-      template <typename T>
-      GLuint Tangents(std::vector<T>& dest) const
       {
         dest.clear();
         return 3;
       }
 
-      /// Makes the vertex bi-tangents and returns the number of values per vertex
-      template <typename T>
-      GLuint Bitangents(std::vector<T>& dest) const
-      {
-        dest.clear();
-        return 3;
-      }
-
-      /// Makes the texture coordinates returns the number of values per vertex
-      template <typename T>
-      GLuint TexCoordinates(std::vector<T>& dest) const
-      {
-        dest.clear();
-        dest.insert(dest.begin(), _tex_data.begin(), _tex_data.end());
-        return 2;
-      }
-
       typedef VertexAttribsInfo<
-        CtmMesh,
-        std::tuple<
-        VertexPositionsTag,
-        VertexNormalsTag,
-        VertexTangentsTag,
-        VertexBitangentsTag,
-        VertexTexCoordinatesTag
-        >
+        IndexedTriangles,
+        std::tuple<VertexPositionsTag>
       > VertexAttribs;
 
-      Spheref MakeBoundingSphere(void) const {
-          GLfloat min_x = _pos_data[3], max_x = _pos_data[3];
-          GLfloat min_y = _pos_data[4], max_y = _pos_data[4];
-          GLfloat min_z = _pos_data[5], max_z = _pos_data[5];
-          for (std::size_t v = 0, vn = _pos_data.size() / 3; v != vn; ++v)
-          {
-            GLfloat x = _pos_data[v * 3 + 0];
-            GLfloat y = _pos_data[v * 3 + 1];
-            GLfloat z = _pos_data[v * 3 + 2];
-
-            if (min_x > x) min_x = x;
-            if (min_y > y) min_y = y;
-            if (min_z > z) min_z = z;
-            if (max_x < x) max_x = x;
-            if (max_y < y) max_y = y;
-            if (max_z < z) max_z = z;
-          }
-
-          Vec3f c(
-            (min_x + max_x) * 0.5f,
-            (min_y + max_y) * 0.5f,
-            (min_z + max_z) * 0.5f
-            );
-
-          return Spheref(
-            c.x(), c.y(), c.z(),
-            Distance(c, Vec3f(min_x, min_y, min_z))
-            );
-      }
-
       /// Queries the bounding sphere coordinates and dimensions
       template <typename T>
       void BoundingSphere(oglplus::Sphere<T>& bounding_sphere) const
       {
-        bounding_sphere = oglplus::Sphere<T>(MakeBoundingSphere());
+        bounding_sphere = oglplus::Sphere<T>(_bounding_sphere);
       }
 
-
-      /// Returns element indices that are used with the drawing instructions
+      /// Always empty, the index buffer is already in place
       const IndexArray & Indices(Default = Default()) const
       {
-        return _idx_data;
+        static const IndexArray NO_INDICES;
+        return NO_INDICES;
       }
 
       /// Returns the instructions for rendering of faces
@@ -294,7 +94,7 @@ namespace oglplus {
         operation.method = DrawOperation::Method::DrawElements;
         operation.mode = primitive;
         operation.first = 0;
-        operation.count = _prim_count * 3;
+        operation.count = _index_count;
         operation.restart_index = DrawOperation::NoRestartIndex();
         operation.phase = 0;
         this->AddInstruction(instr, operation);
@@ -307,6 +107,122 @@ namespace oglplus {
         return Instructions(PrimitiveType::Triangles);
       }
     };
+
+    /// The BakedAsset::MeshAttributes bit that feeds the named attribute
+    inline uint32_t MeshAttributeFor(const std::string & name)
+    {
+      if ("Position" == name) return BakedAsset::POSITION;
+      if ("Normal" == name) return BakedAsset::NORMAL;
+      if ("TexCoord" == name) return BakedAsset::TEXCOORD;
+      if ("Material" == name) return BakedAsset::MATERIAL;
+      return 0;
+    }
+
+    /// The levels of detail of a shape, for renderGeometry to pick from.  
+    /// ShapeWrapper has nothing virtual to hang them off, so they're 
+    /// looked up by the shape instead.
+    struct ShapeLods
+    {
+      std::vector<BakedAsset::MeshLod> lods;
+      GLenum index_type;
+      GLuint index_size;
+      Spheref bounding_sphere;
+    };
+
+    inline std::map<const ShapeWrapper *, ShapeLods> & ShapeLodRegistry()
+    {
+      static std::map<const ShapeWrapper *, ShapeLods> registry;
+      return registry;
+    }
+
+    /// A mesh whose vertices are already interleaved, in one of the 
+    /// BakedAsset::VertexFormats, uploaded as one vertex buffer and one 
+    /// index buffer with a single BufferData each.  ShapeWrapper would 
+    /// otherwise copy every attribute out into a vector of its own, and 
+    /// give each its own float buffer.
+    /// Every level of detail shares the vertex buffer, their indices are 
+    /// one after another in the index buffer.  Draw() always draws the 
+    /// first.
+    template <typename Index>
+    class InterleavedShape : public ShapeWrapper
+    {
+      Buffer _vertices;
+      Buffer _indices;
+
+      static void _attrib_pointer(GLuint location, uint32_t format, uint32_t attribute,
+        GLsizei stride, size_t offset)
+      {
+        const void * pointer = (const void *)offset;
+        if (BakedAsset::COMPACT_VERTICES != format) {
+          glVertexAttribPointer(location, BakedAsset::attributeSize(attribute), GL_FLOAT, GL_FALSE, stride, pointer);
+          return;
+        }
+        switch (attribute) {
+        case BakedAsset::POSITION:
+          glVertexAttribPointer(location, 3, GL_HALF_FLOAT, GL_FALSE, stride, pointer);
+          break;
+        case BakedAsset::NORMAL:
+          glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, pointer);
+          break;
+        case BakedAsset::TEXCOORD:
+          glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, stride, pointer);
+          break;
+        case BakedAsset::MATERIAL:
+          // Converted to float, not normalized, so the shader sees the number
+          glVertexAttribPointer(location, 1, GL_UNSIGNED_SHORT, GL_FALSE, stride, pointer);
+          break;
+        }
+      }
+
+    public:
+      InterleavedShape(
+        const std::vector<const GLchar*> & names,
+        uint32_t attributes,
+        uint32_t format,
+        const void * vertices,
+        size_t vertex_bytes,
+        const void * indices,
+        GLuint index_count,
+        const std::vector<BakedAsset::MeshLod> & lods,
+        const Spheref & bounding_sphere,
+        const ProgramOps & prog
+        ) : ShapeWrapper(std::vector<const GLchar*>(),
+              IndexedTriangles<Index>(lods.empty() ? index_count : lods[0].indexCount, bounding_sphere), prog)
+      {
+        GLsizei stride = BakedAsset::attributeByteOffset(format, attributes, BakedAsset::MATERIAL << 1);
+        Use();
+        _vertices.Bind(Buffer::Target::Array);
+        glBufferData(GL_ARRAY_BUFFER, vertex_bytes, vertices, GL_STATIC_DRAW);
+        for (const GLchar * name : names) {
+          uint32_t attribute = MeshAttributeFor(name);
+          GLint location = glGetAttribLocation(GetGLName(prog), name);
+          // Names the mesh or the program don't have are left disabled,
+          // and read as the default attribute value
+          if (!(attributes & attribute) || location < 0) {
+            continue;
+          }
+          _attrib_pointer(location, format, attribute, stride,
+            BakedAsset::attributeByteOffset(format, attributes, attribute));
+          glEnableVertexAttribArray(location);
+        }
+        // Part of the vertex array state, so it stays bound with it
+        _indices.Bind(Buffer::Target::ElementArray);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(Index), indices, GL_STATIC_DRAW);
+        NoVertexArray().Bind();
+        if (lods.size() > 1) {
+          ShapeLods & entry = ShapeLodRegistry()[this];
+          entry.lods = lods;
+          entry.index_type = sizeof(Index) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+          entry.index_size = sizeof(Index);
+          entry.bounding_sphere = bounding_sphere;
+        }
+      }
+
+      ~InterleavedShape()
+      {
+        ShapeLodRegistry().erase(this);
+      }
+    };
   } // shapes
 } // oglplus
 
@@ -323,10 +239,13 @@ namespace oria {
 
   Text::FontPtr getFont(Resource fontName) {
     static std::map<Resource, Text::FontPtr> fonts;
-    if (fonts.find(fontName) == fonts.end()) {
-      std::string fontData = Platform::getResourceString(fontName);
+    bool cached = fonts.find(fontName) != fonts.end();
+    Platform::recordCacheLookup("fonts", cached);
+    if (!cached) {
+      ResourceView fontData = Platform::getResourceView(fontName);
+      DecodeTimer timer(fontName);
       Text::FontPtr result(new Text::Font());
-      result->read((const void*)fontData.data(), fontData.size());
+      result->read(fontData.data, fontData.size);
       fonts[fontName] = result;
     }
     return fonts[fontName];
@@ -376,6 +295,54 @@ namespace oria {
     }
   }
 
+  /**
+   * The coarsest level of detail whose error stays under a pixel, going by
+   * how large a unit at the near side of the bounding sphere appears in
+   * the current viewport
+   */
+  static size_t selectLod(const oglplus::shapes::ShapeLods & shapeLods) {
+    const mat4 & modelview = Stacks::modelview().top();
+    const mat4 & projection = Stacks::projection().top();
+    const oglplus::Spheref & sphere = shapeLods.bounding_sphere;
+    vec4 center = modelview * vec4(sphere.X(), sphere.Y(), sphere.Z(), 1);
+    float scale = std::max(glm::length(vec3(modelview[0])),
+      std::max(glm::length(vec3(modelview[1])), glm::length(vec3(modelview[2]))));
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    float pixelsPerUnit = scale * projection[1][1] * viewport[3] * 0.5f;
+    // Perspective, rather than orthographic
+    if (0 != projection[2][3]) {
+      float distance = -center.z - sphere.Radius() * scale;
+      if (distance <= 0) {
+        return 0;
+      }
+      pixelsPerUnit /= distance;
+    }
+    size_t result = 0;
+    for (size_t i = 1; i < shapeLods.lods.size(); ++i) {
+      if (shapeLods.lods[i].error * pixelsPerUnit > 1.0f) {
+        break;
+      }
+      result = i;
+    }
+    return result;
+  }
+
+  // Draws the shape, at the level of detail that suits its size on screen
+  // if it has more than one.  The shape's vertex array must be bound.
+  static void drawShape(oglplus::ShapeWrapper & shape) {
+    auto & registry = oglplus::shapes::ShapeLodRegistry();
+    auto itr = registry.find(&shape);
+    if (registry.end() == itr) {
+      shape.Draw();
+      return;
+    }
+    const oglplus::shapes::ShapeLods & shapeLods = itr->second;
+    const BakedAsset::MeshLod & lod = shapeLods.lods[selectLod(shapeLods)];
+    glDrawElements(GL_TRIANGLES, lod.indexCount, shapeLods.index_type,
+      (const void *)((size_t)lod.firstIndex * shapeLods.index_size));
+  }
+
   typedef std::function<void()> Lambda;
   typedef std::list<Lambda> LambdaList;
   template <typename Iter>
@@ -390,7 +357,7 @@ namespace oria {
     });
 
     shape->Use();
-    shape->Draw();
+    drawShape(*shape);
 
     oglplus::NoProgram().Bind();
     oglplus::NoVertexArray().Bind();
@@ -471,6 +438,10 @@ namespace oria {
   }
 
   void renderSkybox(Resource firstImageResource) {
+    renderSkybox(loadCubemapTexture(firstImageResource, true, MIP_BOX));
+  }
+
+  void renderSkybox(TexturePtr texture) {
     using namespace oglplus;
 
     static ProgramPtr program;
@@ -484,7 +455,6 @@ namespace oria {
       });
     }
 
-    TexturePtr texture = loadCubemapTexture(firstImageResource);
     texture->Bind(TextureTarget::CubeMap);
     MatrixStack & mv = Stacks::modelview();
     mv.withPush([&]{
@@ -506,8 +476,7 @@ namespace oria {
     if (!program) {
       program = loadProgram(Resource::SHADERS_TEXTURED_VS, Resource::SHADERS_TEXTURED_FS);
       shape = ShapeWrapperPtr(new shapes::ShapeWrapper(List("Position")("TexCoord").Get(), shapes::Plane(), *program));
-      texture = load2dTexture(Resource::IMAGES_FLOOR_PNG);
-      Context::Bound(TextureTarget::_2D, *texture).MinFilter(TextureMinFilter::LinearMipmapNearest).GenerateMipmap();
+      texture = load2dTexture(Resource::IMAGES_FLOOR_PNG, MIP_KAISER);
       Platform::addShutdownHook([&]{
         program.reset();
         shape.reset();
@@ -527,14 +496,95 @@ namespace oria {
     DefaultTexture().Bind(TextureTarget::_2D);
   }
 
-  ShapeWrapperPtr loadShape(const std::initializer_list<const GLchar*>& names, Resource resource) {
+  static bool isBakedMesh(const ResourceView & data) {
+    return BakedAsset::isBaked(data.data, data.size, BakedAsset::MESH);
+  }
+
+  static ShapeWrapperPtr createShape(const std::vector<const GLchar*> & names, uint32_t attributes, uint32_t format,
+      const void * vertices, size_t vertexBytes, uint32_t indexSize, const void * indices, uint32_t indexCount,
+      const std::vector<BakedAsset::MeshLod> & lods, const float sphere[4], ProgramPtr program) {
     using namespace oglplus;
-    return ShapeWrapperPtr(new shapes::ShapeWrapper(names, shapes::CtmMesh(resource)));
+    Spheref bounds(sphere[0], sphere[1], sphere[2], sphere[3]);
+    if (2 == indexSize) {
+      return ShapeWrapperPtr(new shapes::InterleavedShape<GLushort>(names, attributes, format,
+        vertices, vertexBytes, indices, indexCount, lods, bounds, *program));
+    }
+    return ShapeWrapperPtr(new shapes::InterleavedShape<GLuint>(names, attributes, format,
+      vertices, vertexBytes, indices, indexCount, lods, bounds, *program));
+  }
+
+  // A decoded mesh, packed the way a baked one would be
+  struct PackedMesh {
+    uint32_t attributes;
+    uint32_t format;
+    std::vector<uint8_t> vertices;
+    uint32_t indexSize;
+    std::vector<uint8_t> indices;
+    uint32_t indexCount;
+    std::vector<BakedAsset::MeshLod> lods;
+    float min[3], max[3], sphere[4];
+
+    // Half the bandwidth and memory of float vertices, wherever the
+    // positions fit in half floats
+    PackedMesh(const MeshData & mesh)
+      : attributes(mesh.attributes), format(BakedAsset::COMPACT_VERTICES),
+        indexCount((uint32_t)mesh.indices.size()), lods(mesh.lods) {
+      mesh.bounds(min, max, sphere);
+      vertices = packVertices(mesh, format);
+      indices = packIndices(mesh, indexSize);
+    }
+  };
+
+  // Builds the LODs of a mesh loaded at run time, reorders each for the
+  // post-transform cache, and packs the result for upload.  Baked meshes
+  // get all of this from the baker instead.
+  static std::shared_ptr<PackedMesh> packMesh(MeshData && mesh) {
+    buildLods(mesh);
+    optimizeMesh(mesh);
+    return std::make_shared<PackedMesh>(mesh);
+  }
+
+  // Uploads straight out of the resource, the baker has already laid the 
+  // vertices out the way the GPU wants them
+  static ShapeWrapperPtr createBakedShape(const std::vector<const GLchar*> & names, const ResourceView & data, ProgramPtr program) {
+    BakedAsset::MeshHeader header;
+    if (!BakedAsset::readMesh(data.data, data.size, header)) {
+      FAIL("Invalid baked mesh");
+    }
+    return createShape(names, header.attributes, header.vertexFormat,
+      data.data + header.vertexOffset, (size_t)header.vertexCount * header.stride,
+      header.indexSize, data.data + header.indexOffset, header.indexCount,
+      std::vector<BakedAsset::MeshLod>(header.lods, header.lods + header.lodCount), header.sphere, program);
   }
 
   ShapeWrapperPtr loadShape(const std::initializer_list<const GLchar*>& names, Resource resource, ProgramPtr program) {
+    return prepareShape(names, resource, program)();
+  }
+
+  std::function<ShapeWrapperPtr()> prepareShape(const std::vector<const GLchar*> & names, Resource resource, ProgramPtr program) {
     using namespace oglplus;
-    return ShapeWrapperPtr(new shapes::ShapeWrapper(names, shapes::CtmMesh(resource), *program));
+    ResourceView data = Platform::getResourceView(resource);
+    DecodeTimer timer(resource);
+    if (isBakedMesh(data)) {
+      return [=]{
+        return createBakedShape(names, data, program);
+      };
+    }
+    // Attributes the shape won't use aren't worth decoding or uploading
+    uint32_t attributes = BakedAsset::POSITION;
+    for (const GLchar * name : names) {
+      attributes |= shapes::MeshAttributeFor(name);
+    }
+    std::shared_ptr<PackedMesh> mesh;
+    try {
+      mesh = packMesh(decodeCtm(data.data, data.size, attributes));
+    } catch (const std::runtime_error & error) {
+      FAIL("Unable to load mesh %d: %s", (int)resource, error.what());
+    }
+    return [=]{
+      return createShape(names, mesh->attributes, mesh->format, mesh->vertices.data(), mesh->vertices.size(),
+        mesh->indexSize, mesh->indices.data(), mesh->indexCount, mesh->lods, mesh->sphere, program);
+    };
   }
 
   void renderManikin() {
@@ -598,9 +648,22 @@ namespace oria {
       });
 
       program = loadProgram(Resource::SHADERS_LITMATERIALS_VS, Resource::SHADERS_LITCOLORED_FS);
-      std::stringstream stream = Platform::getResourceStream(Resource::MESHES_ARTIFICIAL_HORIZON_OBJ);
-      shapes::ObjMesh mesh(stream);
-      shape = ShapeWrapperPtr(new shapes::ShapeWrapper({ "Position", "Normal", "Material" }, mesh, *program));
+      ResourceView data = Platform::getResourceView(Resource::MESHES_ARTIFICIAL_HORIZON_OBJ);
+      DecodeTimer timer(Resource::MESHES_ARTIFICIAL_HORIZON_OBJ);
+      if (isBakedMesh(data)) {
+        shape = createBakedShape({ "Position", "Normal", "Material" }, data, program);
+      } else {
+        std::shared_ptr<PackedMesh> mesh;
+        try {
+          mesh = packMesh(decodeObj(data.data, data.size, BakedAsset::POSITION | BakedAsset::NORMAL | BakedAsset::MATERIAL,
+            &ThreadPool::instance()));
+        } catch (const std::runtime_error & error) {
+          FAIL("Unable to load the artificial horizon: %s", error.what());
+        }
+        shape = createShape({ "Position", "Normal", "Material" }, mesh->attributes, mesh->format,
+          mesh->vertices.data(), mesh->vertices.size(), mesh->indexSize, mesh->indices.data(), mesh->indexCount,
+          mesh->lods, mesh->sphere, program);
+      }
       Uniform<Vec4f>(*program, "Materials[0]").Set(materials);
     }
 
@@ -634,6 +697,27 @@ namespace oria {
   }
 
 
+  // Start reading the assets behind the render helpers above in the 
+  // background, so that the first frame that uses them doesn't stall on I/O.
+  // Only apps that draw them should call this, from prefetchResources(),
+  // since an entry nobody takes stays in memory until shutdown.
+  void prefetchSceneResources() {
+    Platform::prefetchResources({
+      Resource::SHADERS_CUBEMAP_VS, Resource::SHADERS_CUBEMAP_FS,
+      Resource::SHADERS_TEXTURED_VS, Resource::SHADERS_TEXTURED_FS,
+      Resource::SHADERS_LIT_VS, Resource::SHADERS_LITCOLORED_FS,
+      Resource::IMAGES_SKY_CITY_XNEG_PNG,
+      static_cast<Resource>(Resource::IMAGES_SKY_CITY_XNEG_PNG + 1),
+      static_cast<Resource>(Resource::IMAGES_SKY_CITY_XNEG_PNG + 2),
+      static_cast<Resource>(Resource::IMAGES_SKY_CITY_XNEG_PNG + 3),
+      static_cast<Resource>(Resource::IMAGES_SKY_CITY_XNEG_PNG + 4),
+      static_cast<Resource>(Resource::IMAGES_SKY_CITY_XNEG_PNG + 5),
+      Resource::IMAGES_FLOOR_PNG,
+      Resource::MESHES_MANIKIN_CTM,
+      Resource::MESHES_RIFT_CTM,
+    });
+  }
+
   void __stdcall debugCallback(
     GLenum source,
     GLenum type,
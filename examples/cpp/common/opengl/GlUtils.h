@@ -29,6 +29,10 @@ namespace oria {
   }
 
   ShapeWrapperPtr loadShape(const std::initializer_list<const GLchar*>& names, Resource resource, ProgramPtr program);
+  // Decodes a mesh, which is safe off the GL thread, and returns the 
+  // function that turns it into a shape.  That has to run on the thread 
+  // that draws it, since vertex arrays aren't shared between contexts.
+  std::function<ShapeWrapperPtr()> prepareShape(const std::vector<const GLchar*> & names, Resource resource, ProgramPtr program);
   ShapeWrapperPtr loadSphere(const std::initializer_list<const GLchar*>& names, ProgramPtr program);
   ShapeWrapperPtr loadSkybox(ProgramPtr program);
   ShapeWrapperPtr loadPlane(ProgramPtr program, float aspect);
@@ -40,11 +44,13 @@ namespace oria {
   void renderCube(const glm::vec3 & color = Colors::white);
   void renderColorCube();
   void renderSkybox(Resource firstImageResource);
+  void renderSkybox(TexturePtr cubemap);
   void renderFloor();
   void renderManikin();
   void renderRift();
   void renderArtificialHorizon(float alpha = 0.0f);
   void renderCubeScene(float ipd, float eyeHeight);
+  void prefetchSceneResources();
 
   void renderString(const std::string & str, glm::vec2 & cursor,
       float fontSize = 12.0f, Resource font =
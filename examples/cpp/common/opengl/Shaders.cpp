@@ -44,6 +44,46 @@ namespace oria {
   }
 
 
+#ifdef RIFT_DEBUG
+  // Relinks every live program built from the pair in place when either
+  // file changes, so anyone holding one sees the edit.  Each pair gets a
+  // single callback, however many times it's loaded.
+  static void watchProgram(const std::string & key, Resource vs, Resource fs, const ProgramPtr & program) {
+    typedef std::list<std::weak_ptr<oglplus::Program>> ProgramList;
+    static std::unordered_map<std::string, ProgramList> watched;
+
+    auto found = watched.find(key);
+    if (watched.end() == found) {
+      // Elements of an unordered_map don't move when it grows
+      ProgramList * programs = &watched[key];
+      ResourceWatcher::Callback reload = [=]{
+        auto itr = programs->begin();
+        while (itr != programs->end()) {
+          ProgramPtr existing = itr->lock();
+          if (!existing) {
+            itr = programs->erase(itr);
+            continue;
+          }
+          ProgramPtr rebuilt;
+          compileProgram(rebuilt,
+            Platform::getResourceString(vs),
+            Platform::getResourceString(fs));
+          if (!rebuilt) {
+            // The error has been reported, keep the old programs
+            return;
+          }
+          *existing = std::move(*rebuilt);
+          ++itr;
+        }
+      };
+      ResourceWatcher::instance().onChange(vs, reload);
+      ResourceWatcher::instance().onChange(fs, reload);
+      found = watched.find(key);
+    }
+    found->second.push_back(program);
+  }
+#endif
+
   ProgramPtr loadProgram(Resource vs, Resource fs) {
     typedef std::unordered_map<std::string, ProgramPtr> ProgramMap;
 
@@ -58,11 +98,18 @@ namespace oria {
 
     std::string key = Resources::getResourcePath(vs) + ":" +
       Resources::getResourcePath(fs);
+    // Not counted as a cache lookup, since nothing is cached yet (see
+    // below)
     if (!programs.count(key)) {
       ProgramPtr result;
       compileProgram(result,
         Platform::getResourceString(vs),
         Platform::getResourceString(fs));
+#ifdef RIFT_DEBUG
+      if (result) {
+        watchProgram(key, vs, fs, result);
+      }
+#endif
       // FIXME
       // Caching shaders is problematic, since it requires you to set ALL 
       // uniforms any time you use the shader, because you don't know if you're 
@@ -86,6 +133,12 @@ namespace oria {
     return result;
   }
 
+  ProgramPtr buildProgram(const std::string & vsSource, const std::string & fsSource) {
+    ProgramPtr result;
+    compileProgram(result, vsSource, fsSource);
+    return result;
+  }
+
   UniformMap getActiveUniforms(ProgramPtr & program) {
     UniformMap activeUniforms;
     size_t uniformCount = program->ActiveUniforms().Size();
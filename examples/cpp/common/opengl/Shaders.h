@@ -26,5 +26,8 @@ typedef std::map<std::string, GLuint> UniformMap;
 namespace oria {
   ProgramPtr loadProgram(Resource vs, Resource fs);
   ProgramPtr loadProgram(const std::string & vsFile, const std::string & fsFile);
+  // For shaders kept in the source rather than as resources.  Returns null
+  // if the program doesn't build.
+  ProgramPtr buildProgram(const std::string & vsSource, const std::string & fsSource);
   UniformMap getActiveUniforms(ProgramPtr & program);
 }
@@ -0,0 +1,170 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "Common.h"
+
+typedef std::lock_guard<std::mutex> Lock;
+
+StreamingTexture::StreamingTexture(const uvec2 & size, int slotCount)
+  : slots(slotCount), size(size), requested(size) {
+  allocate();
+}
+
+StreamingTexture::~StreamingTexture() {
+  release();
+}
+
+void StreamingTexture::allocate() {
+  using namespace oglplus;
+  texture = TexturePtr(new Texture());
+  Context::Bound(TextureTarget::_2D, *texture)
+    .MagFilter(TextureMagFilter::Linear)
+    .MinFilter(TextureMinFilter::Linear)
+    .WrapS(TextureWrap::ClampToEdge)
+    .WrapT(TextureWrap::ClampToEdge);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  if (GLEW_ARB_texture_storage) {
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, size.x, size.y);
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+  DefaultTexture().Bind(TextureTarget::_2D);
+
+  size_t bytes = getStride() * size.y;
+  persistent = 0 != GLEW_ARB_buffer_storage;
+  for (size_t i = 0; i < slots.size(); ++i) {
+    Slot & slot = slots[i];
+    if (!persistent) {
+      slot.client.resize(bytes);
+      slot.pixels = &slot.client[0];
+      continue;
+    }
+    // Coherent, so frames written by the producer need no explicit flush
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, flags);
+    slot.pixels = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, flags));
+    if (!slot.pixels) {
+      FAIL("Unable to map streaming texture buffer");
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void StreamingTexture::release() {
+  for (size_t i = 0; i < slots.size(); ++i) {
+    Slot & slot = slots[i];
+    if (slot.fence) {
+      glDeleteSync(slot.fence);
+    }
+    if (slot.buffer) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      glDeleteBuffers(1, &slot.buffer);
+    }
+    slot = Slot();
+  }
+  texture.reset();
+}
+
+int StreamingTexture::acquire(const uvec2 & frameSize) {
+  Lock lock(mutex);
+  // A frame of the current size cancels any rebuild still pending
+  requested = frameSize;
+  if (frameSize != size) {
+    return -1;
+  }
+  for (size_t i = 0; i < slots.size(); ++i) {
+    if (FREE == slots[i].state) {
+      slots[i].state = WRITING;
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+void StreamingTexture::publish(int slot) {
+  Lock lock(mutex);
+  for (size_t i = 0; i < slots.size(); ++i) {
+    if (READY == slots[i].state) {
+      slots[i].state = FREE;
+    }
+  }
+  slots[slot].state = READY;
+}
+
+int StreamingTexture::update() {
+  int ready = -1;
+  {
+    Lock lock(mutex);
+    if (requested != size) {
+      // Only once the producer isn't writing into the old slots.  Any
+      // frame still waiting is the old size, so it goes too.
+      bool writing = false;
+      for (size_t i = 0; i < slots.size(); ++i) {
+        writing |= WRITING == slots[i].state;
+      }
+      if (writing) {
+        return -1;
+      }
+      release();
+      size = requested;
+      allocate();
+      return -1;
+    }
+    for (size_t i = 0; i < slots.size(); ++i) {
+      Slot & slot = slots[i];
+      if (UPLOADED == slot.state) {
+        // Release slots once the GPU has finished reading them
+        if (slot.fence) {
+          GLenum status = glClientWaitSync(slot.fence, 0, 0);
+          if (GL_ALREADY_SIGNALED != status && GL_CONDITION_SATISFIED != status) {
+            continue;
+          }
+          glDeleteSync(slot.fence);
+          slot.fence = 0;
+        }
+        slot.state = FREE;
+      } else if (READY == slot.state) {
+        // Claimed now, so a publish() during the upload can't recycle it
+        slot.state = UPLOADED;
+        ready = (int)i;
+      }
+    }
+  }
+  if (-1 == ready) {
+    return -1;
+  }
+
+  Slot & slot = slots[ready];
+  texture->Bind(oglplus::TextureTarget::_2D);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (persistent) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, slot.pixels);
+  }
+  oglplus::DefaultTexture().Bind(oglplus::TextureTarget::_2D);
+  return ready;
+}
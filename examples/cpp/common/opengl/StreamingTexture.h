@@ -0,0 +1,105 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * An RGBA8 texture whose whole image is replaced over and over, such as
+ * the frames of a video.
+ *
+ * The texture storage is allocated once, immutable where the driver
+ * supports it, and frames pass through a ring of slots.  With
+ * ARB_buffer_storage each slot is a pixel unpack buffer mapped for the
+ * life of the object, so a producer on another thread can write a frame
+ * straight into memory the GL reads from, and the upload is a
+ * TexSubImage2D the driver can do without stalling.  Each slot is fenced
+ * after its upload and isn't handed out again until the GPU is done with
+ * it.  Without buffer storage the slots are plain client memory.
+ *
+ * acquire(), getPixels(), getStride() and publish() may be called from
+ * one producer thread.  Everything else belongs to the GL thread.
+ *
+ * The ring is sized by its first frames.  A frame of a different size is
+ * dropped, and the next update() rebuilds the ring to fit it.
+ */
+class StreamingTexture {
+  enum SlotState {
+    FREE,
+    WRITING,
+    READY,
+    UPLOADED,
+  };
+
+  struct Slot {
+    SlotState state{ FREE };
+    GLuint buffer{ 0 };
+    GLsync fence{ 0 };
+    uint8_t * pixels{ nullptr };
+    std::vector<uint8_t> client;
+  };
+
+  std::mutex mutex;
+  std::vector<Slot> slots;
+  TexturePtr texture;
+  uvec2 size;
+  // The size of the last frame offered to acquire()
+  uvec2 requested;
+  bool persistent{ false };
+
+  void allocate();
+  void release();
+
+public:
+  StreamingTexture(const uvec2 & size, int slotCount = 3);
+  ~StreamingTexture();
+
+  // Returns a slot to write the next frame into, or -1 if they're all
+  // busy or the frame isn't the size of the ring, in which case the frame
+  // should be dropped
+  int acquire(const uvec2 & frameSize);
+
+  // The first row written is the bottom row of the texture
+  uint8_t * getPixels(int slot) {
+    return slots[slot].pixels;
+  }
+
+  size_t getStride() const {
+    return size.x * 4;
+  }
+
+  // Hands a written slot over for upload.  Any earlier frame still
+  // waiting is dropped in favor of this one.
+  void publish(int slot);
+
+  // Uploads the latest published frame, if there is one, and returns the
+  // slot it came from, or -1.  Whatever the producer stored alongside that
+  // slot stays valid until the next call.  If frames of a new size have
+  // been offered, rebuilds the ring first, which replaces the texture.
+  int update();
+
+  const TexturePtr & getTexture() const {
+    return texture;
+  }
+
+  const uvec2 & getSize() const {
+    return size;
+  }
+};
+
+typedef std::shared_ptr<StreamingTexture> StreamingTexturePtr;
@@ -0,0 +1,180 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "Common.h"
+
+namespace oria {
+
+  // Wide enough to keep levels 0 to 2 apart
+  static const uint32_t MIP_GUTTER = 4;
+  static const uint32_t MIP_LEVELS = 3;
+
+  struct DecodedImage {
+    uvec2 size;
+    // RGBA8, bottom row first like everything else handed to GL
+    std::vector<uint8_t> pixels;
+  };
+
+  static void decodeBaked(const ResourceView & data, const BakedAsset::TextureHeader & header,
+      DecodedImage & out) {
+    const BakedAsset::Level & level = header.levels[0];
+    const uint8_t * source = data.data + level.offset;
+    out.size = uvec2(level.width, level.height);
+    out.pixels.resize(level.width * level.height * 4);
+    BlockFormat format;
+    switch (header.format) {
+    case BakedAsset::RGBA8:
+      memcpy(&out.pixels[0], source, out.pixels.size());
+      return;
+    case BakedAsset::BC1:
+      format = BLOCK_BC1;
+      break;
+    case BakedAsset::BC3:
+      format = BLOCK_BC3;
+      break;
+    case BakedAsset::BC7:
+      format = BLOCK_BC7;
+      break;
+    default:
+      FAIL("Unsupported baked texture format %d", header.format);
+    }
+    if (!decompressBlocks(source, level.width, level.height, format, &out.pixels[0], level.width * 4)) {
+      FAIL("Unable to decode baked texture");
+    }
+  }
+
+  static void decode(Resource resource, DecodedImage & out) {
+    using namespace oglplus;
+    ResourceView data = Platform::getResourceView(resource);
+    DecodeTimer timer(resource);
+    BakedAsset::TextureHeader header;
+    if (BakedAsset::readTexture(data.data, data.size, header)) {
+      decodeBaked(data, header, out);
+      return;
+    }
+
+    ImagePtr image = loadImage(data);
+    if (PixelDataType::UnsignedByte != image->Type()) {
+      FAIL("Atlas images must be 8 bit");
+    }
+    size_t width = image->Width(), height = image->Height();
+    size_t channels = image->Channels();
+    const uint8_t * source = static_cast<const uint8_t *>(image->RawData());
+    out.size = uvec2(width, height);
+    out.pixels.resize(width * height * 4);
+    if (4 == channels) {
+      pixels::blitRows(source, width * 4, &out.pixels[0], width * 4, width * 4, height);
+    } else if (3 == channels) {
+      // Expanding "BGR" to "BGRA" keeps the channel order, so it serves for
+      // RGB sources too
+      if (PixelDataFormat::BGR == image->Format()) {
+        pixels::bgrToRgba(source, width * 3, &out.pixels[0], width * 4, width, height);
+      } else {
+        pixels::bgrToBgra(source, width * 3, &out.pixels[0], width * 4, width, height);
+      }
+    } else {
+      // Luminance, with or without alpha
+      for (size_t i = 0; i < width * height; ++i) {
+        const uint8_t * texel = source + i * channels;
+        uint8_t * target = &out.pixels[i * 4];
+        target[0] = target[1] = target[2] = texel[0];
+        target[3] = 2 == channels ? texel[1] : 0xFF;
+      }
+    }
+  }
+
+  const TextureAtlas::Region & TextureAtlas::getRegion(Resource resource) const {
+    auto itr = regions.find(resource);
+    if (regions.end() == itr) {
+      FAIL("Resource %d is not in the atlas", resource);
+    }
+    return itr->second;
+  }
+
+  TextureAtlasPtr loadTextureAtlas(const std::vector<Resource> & resources,
+      MipFilter mips, uint32_t pageSize) {
+    using namespace oglplus;
+    std::vector<DecodedImage> images(resources.size());
+    ThreadPool::instance().parallelFor(resources.size(), [&](size_t i) {
+      decode(resources[i], images[i]);
+    });
+
+    // Bilinear filtering alone needs a single texel of gutter
+    uint32_t gutter = MIP_NONE == mips ? 1 : MIP_GUTTER;
+    std::vector<AtlasRect> sizes(images.size());
+    for (size_t i = 0; i < images.size(); ++i) {
+      sizes[i].width = images[i].size.x;
+      sizes[i].height = images[i].size.y;
+    }
+    std::vector<AtlasPlacement> placements;
+    int pageCount = packAtlas(sizes, pageSize, gutter, placements);
+
+    TextureAtlasPtr atlas(new TextureAtlas());
+    std::vector<std::vector<uint8_t>> pages(pageCount);
+    for (int i = 0; i < pageCount; ++i) {
+      pages[i].resize(pageSize * pageSize * 4);
+    }
+    size_t stride = pageSize * 4;
+    for (size_t i = 0; i < images.size(); ++i) {
+      const AtlasPlacement & placement = placements[i];
+      if (placement.page < 0) {
+        FAIL("Resource %d is too large for a %dx%d atlas page", resources[i], pageSize, pageSize);
+      }
+      const AtlasRect & rect = placement.rect;
+      uint8_t * page = &pages[placement.page][0];
+      pixels::blitRows(&images[i].pixels[0], rect.width * 4,
+        page + rect.y * stride + rect.x * 4, stride, rect.width * 4, rect.height);
+      fillGutter(page, stride, rect, gutter);
+
+      TextureAtlas::Region & region = atlas->regions[resources[i]];
+      region.page = placement.page;
+      region.size = images[i].size;
+      region.uvRect = vec4(rect.x, rect.y, rect.x + rect.width, rect.y + rect.height) / (float)pageSize;
+    }
+
+    MipOptions options;
+    options.filter = mips;
+    options.maxLevels = MIP_LEVELS;
+    options.pool = &ThreadPool::instance();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < pageCount; ++i) {
+      TexturePtr texture(new Texture());
+      Context::Bound(TextureTarget::_2D, *texture)
+        .MagFilter(TextureMagFilter::Linear)
+        .MinFilter(MIP_NONE == mips ? TextureMinFilter::Linear : TextureMinFilter::LinearMipmapLinear)
+        .WrapS(TextureWrap::ClampToEdge)
+        .WrapT(TextureWrap::ClampToEdge);
+      Texture::Image2D(TextureTarget::_2D, 0, PixelDataInternalFormat::RGBA8,
+        pageSize, pageSize, 0, PixelDataFormat::RGBA, PixelDataType::UnsignedByte, &pages[i][0]);
+      std::vector<MipLevel> chain;
+      if (MIP_NONE != mips) {
+        chain = buildMipChain(&pages[i][0], pageSize, pageSize, stride, 4, options);
+      }
+      for (size_t level = 0; level < chain.size(); ++level) {
+        Texture::Image2D(TextureTarget::_2D, (GLint)level + 1, PixelDataInternalFormat::RGBA8,
+          chain[level].width, chain[level].height, 0,
+          PixelDataFormat::RGBA, PixelDataType::UnsignedByte, &chain[level].pixels[0]);
+      }
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)chain.size());
+      atlas->pages.push_back(texture);
+    }
+    return atlas;
+  }
+
+}
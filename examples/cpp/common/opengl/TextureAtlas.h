@@ -0,0 +1,60 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+namespace oria {
+
+  /**
+   * Many small images packed into a few shared textures, so geometry
+   * using any of them can be drawn with a single bind.  Each image keeps
+   * its size and gets the rectangle of texture coordinates it occupies,
+   * which replaces the usual 0 to 1 range.
+   *
+   * Images in an atlas can't use repeat wrapping, so this is for things
+   * like icons, decals and UI, not tiling surfaces.
+   */
+  struct TextureAtlas {
+    struct Region {
+      int page{ 0 };
+      // Lower left (x, y) and upper right (z, w) texture coordinates
+      vec4 uvRect;
+      uvec2 size;
+    };
+
+    std::vector<TexturePtr> pages;
+    std::map<Resource, Region> regions;
+
+    const Region & getRegion(Resource resource) const;
+
+    // Maps a coordinate in the original image's 0 to 1 range into the atlas
+    static vec2 transform(const Region & region, const vec2 & uv) {
+      return vec2(region.uvRect.x, region.uvRect.y) +
+        uv * vec2(region.uvRect.z - region.uvRect.x, region.uvRect.w - region.uvRect.y);
+    }
+  };
+
+  typedef std::shared_ptr<TextureAtlas> TextureAtlasPtr;
+
+  // Accepts encoded or baked images.  With mips, the gutters are wide
+  // enough for the first three levels, and the chain stops there.
+  TextureAtlasPtr loadTextureAtlas(const std::vector<Resource> & resources,
+    MipFilter mips = MIP_BOX, uint32_t pageSize = 2048);
+
+}
@@ -0,0 +1,138 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "Common.h"
+
+static const size_t DEFAULT_BUDGET_MB = 512;
+
+TextureCache::TextureCache() {
+  const char * override = getenv("RIFT_TEXTURE_BUDGET_MB");
+  size_t megabytes = override ? (size_t)atol(override) : DEFAULT_BUDGET_MB;
+  budget = megabytes * 1024 * 1024;
+}
+
+const TextureCache::Entry & TextureCache::get(Resource resource,
+    oglplus::TextureTarget target, const Loader & loader) {
+  EntryMap::iterator itr = entries.find(resource);
+  Platform::recordCacheLookup("textures", entries.end() != itr);
+  if (entries.end() == itr) {
+    Entry entry;
+    entry.texture = loader(entry.size);
+    if (!entry.texture) {
+      FAIL("Unable to construct object");
+    }
+    entry.target = target;
+    entry.bytes = measure(target, *entry.texture);
+    resident += entry.bytes;
+    itr = entries.insert(EntryMap::value_type(resource, entry)).first;
+  }
+  itr->second.lastUsed = frame;
+  return itr->second;
+}
+
+void TextureCache::remeasure(Resource resource) {
+  EntryMap::iterator itr = entries.find(resource);
+  if (entries.end() != itr) {
+    Entry & entry = itr->second;
+    resident -= entry.bytes;
+    entry.bytes = measure(entry.target, *entry.texture);
+    resident += entry.bytes;
+  }
+}
+
+void TextureCache::endFrame() {
+  if (resident > budget) {
+    std::vector<EntryMap::iterator> candidates;
+    for (EntryMap::iterator itr = entries.begin(); itr != entries.end(); ++itr) {
+      const Entry & entry = itr->second;
+      if (entry.lastUsed < frame && entry.texture.unique()) {
+        candidates.push_back(itr);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](EntryMap::iterator a, EntryMap::iterator b) {
+      return a->second.lastUsed < b->second.lastUsed;
+    });
+    for (size_t i = 0; i < candidates.size() && resident > budget; ++i) {
+      resident -= candidates[i]->second.bytes;
+      entries.erase(candidates[i]);
+    }
+  }
+  ++frame;
+}
+
+void TextureCache::clear() {
+  entries.clear();
+  resident = 0;
+}
+
+size_t TextureCache::measure(oglplus::TextureTarget target, oglplus::Texture & texture) {
+  using namespace oglplus;
+  const bool cubeMap = TextureTarget::CubeMap == target;
+  GLint previous = 0;
+  glGetIntegerv(cubeMap ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D, &previous);
+  texture.Bind(target);
+
+  size_t total = 0;
+  for (int face = 0; face < (cubeMap ? 6 : 1); ++face) {
+    GLenum levelTarget = cubeMap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GLenum(target);
+    for (GLint level = 0; level < 16; ++level) {
+      GLint width = 0, height = 0, compressed = 0;
+      glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_WIDTH, &width);
+      if (0 == width) {
+        break;
+      }
+      glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_HEIGHT, &height);
+      glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+      if (compressed) {
+        GLint bytes = 0;
+        glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &bytes);
+        total += bytes;
+        continue;
+      }
+      static const GLenum COMPONENTS[] = {
+        GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE,
+        GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE,
+      };
+      GLint bits = 0;
+      for (int i = 0; i < 5; ++i) {
+        GLint componentBits = 0;
+        glGetTexLevelParameteriv(levelTarget, level, COMPONENTS[i], &componentBits);
+        bits += componentBits;
+      }
+      // Drivers pad 3 byte texels out to 4
+      size_t texelBytes = 24 == bits ? 4 : std::max(1, (bits + 7) / 8);
+      total += (size_t)width * height * texelBytes;
+    }
+  }
+
+  glBindTexture(GLenum(target), previous);
+  return total;
+}
+
+TextureCache & TextureCache::instance() {
+  static TextureCache cache;
+  static bool registeredShutdown = false;
+  if (!registeredShutdown) {
+    Platform::addShutdownHook([&]{
+      cache.clear();
+    });
+    registeredShutdown = true;
+  }
+  return cache;
+}
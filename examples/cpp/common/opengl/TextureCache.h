@@ -0,0 +1,87 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * The textures loaded from resources, held within a budget of GPU memory.
+ *
+ * Each entry's size is measured from the driver once it's loaded, so mip
+ * chains and compressed formats are counted properly.  At the end of each
+ * frame, if the total is over budget, the least recently used entries are
+ * dropped until it fits.  An entry is never evicted if it was used this
+ * frame, or if anything outside the cache still holds the texture, since
+ * dropping it then wouldn't free anything.  So a texture kept around but
+ * not drawn, such as an inactive Shadertoy channel, stays resident.
+ *
+ * The budget defaults to 512 MB, and can be overridden with the
+ * RIFT_TEXTURE_BUDGET_MB environment variable.  All of this is for the GL
+ * thread only.
+ */
+class TextureCache {
+public:
+  typedef std::function<TexturePtr(uvec2 & outSize)> Loader;
+
+  struct Entry {
+    TexturePtr texture;
+    oglplus::TextureTarget target{ oglplus::TextureTarget::_2D };
+    uvec2 size;
+    size_t bytes{ 0 };
+    uint64_t lastUsed{ 0 };
+  };
+
+private:
+  typedef std::map<Resource, Entry> EntryMap;
+
+  EntryMap entries;
+  size_t budget;
+  size_t resident{ 0 };
+  uint64_t frame{ 1 };
+
+public:
+  TextureCache();
+
+  // Returns the entry for the resource, running the loader to create it if
+  // it isn't resident.  The reference is valid until the next endFrame().
+  const Entry & get(Resource resource, oglplus::TextureTarget target, const Loader & loader);
+
+  // Updates the accounting for a texture rebuilt in place
+  void remeasure(Resource resource);
+
+  // Evicts entries until the cache is within budget.  Call between frames.
+  void endFrame();
+
+  void setBudget(size_t bytes) {
+    budget = bytes;
+  }
+
+  size_t getBudget() const {
+    return budget;
+  }
+
+  size_t getResident() const {
+    return resident;
+  }
+
+  void clear();
+
+  // The GPU memory used by all the levels (and faces) of a texture
+  static size_t measure(oglplus::TextureTarget target, oglplus::Texture & texture);
+  static TextureCache & instance();
+};
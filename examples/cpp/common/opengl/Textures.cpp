@@ -21,19 +21,34 @@
 
 #ifdef HAVE_OPENCV
 #include <opencv2/opencv.hpp>
-#else
-#include <oglplus/images/png.hpp>
 #endif
 
-typedef std::map<Resource, TexturePtr> TextureMap;
-typedef TextureMap::iterator TextureMapItr;
-
 namespace oria {
 
-  ImagePtr loadImage(std::vector<uint8_t> & data, bool flip) {
+  // For 8 bit images of 1 to 4 channels
+  static oglplus::PixelDataFormat pixelFormat(int channels) {
+    using namespace oglplus;
+    static const PixelDataFormat FORMATS[] = {
+      PixelDataFormat::Red, PixelDataFormat::RG, PixelDataFormat::RGB, PixelDataFormat::RGBA,
+    };
+    return FORMATS[channels - 1];
+  }
+
+  static oglplus::PixelDataInternalFormat internalFormat(int channels) {
+    using namespace oglplus;
+    static const PixelDataInternalFormat FORMATS[] = {
+      PixelDataInternalFormat::R8, PixelDataInternalFormat::RG8,
+      PixelDataInternalFormat::RGB8, PixelDataInternalFormat::RGBA8,
+    };
+    return FORMATS[channels - 1];
+  }
+
+  ImagePtr loadImage(const ResourceView & data, bool flip) {
     using namespace oglplus;
 #ifdef HAVE_OPENCV
-    cv::Mat image = cv::imdecode(data, cv::IMREAD_COLOR);
+    // Wrap, rather than copy, the encoded bytes
+    cv::Mat encoded(1, (int)data.size, CV_8UC1, const_cast<uint8_t*>(data.data));
+    cv::Mat image = cv::imdecode(encoded, cv::IMREAD_COLOR);
     if (flip) {
       cv::flip(image, image, 0);
     }
@@ -41,81 +56,375 @@ namespace oria {
       PixelDataFormat::BGR, PixelDataInternalFormat::RGBA8));
     return result;
 #else
-    std::stringstream stream(std::string((const char*)&data[0], data.size()));
-    return ImagePtr(new images::PNGImage(stream));
+    // The image takes a copy, so decode into a pooled buffer
+    PixelBufferPtr buffer = acquirePixelBuffer();
+    DecodedImage decoded = decodePng(data.data, data.size, *buffer, flip);
+    return ImagePtr(new images::Image(decoded.width, decoded.height, 1, decoded.channels, decoded.pixels,
+      pixelFormat(decoded.channels), internalFormat(decoded.channels)));
 #endif
   }
 
-  ImagePtr loadImage(Resource resource, bool flip) {
-    std::vector<uint8_t> data = Platform::getResourceByteVector(resource);
-    return loadImage(data, flip);
+  ImagePtr loadImage(std::vector<uint8_t> & data, bool flip) {
+    return loadImage(ResourceView(data.data(), data.size()), flip);
   }
 
-  TextureMap & getTextureMap() {
-    static TextureMap map;
-    static bool registeredShutdown = false;
-    if (!registeredShutdown) {
-      Platform::addShutdownHook([&]{
-        map.clear();
-      });
-      registeredShutdown = true;
-    }
-
-    return map;
+  ImagePtr loadImage(Resource resource, bool flip) {
+    return loadImage(Platform::getResourceView(resource), flip);
   }
 
-  template <typename T, typename F>
-  T loadOrPopulate(std::map<Resource, T> & map, Resource resource, F loader) {
-    auto itr = map.find(resource);
-    if (map.end() == itr) {
-      T built = loader();
-      if (!built) {
-        FAIL("Unable to construct object");
+  // The loader may be run again later to rebuild the texture in place, so 
+  // it must capture by value.  The texture depends on the resource and the 
+  // dependencies - 1 resources following it.
+  template <typename F>
+  TexturePtr loadOrPopulate(Resource resource, oglplus::TextureTarget target, 
+      uvec2 & outSize, F loader, int dependencies = 1) {
+    bool loaded = false;
+    const TextureCache::Entry & entry = TextureCache::instance().get(resource, target, [&](uvec2 & size) {
+      loaded = true;
+      return loader(size);
+    });
+#ifdef RIFT_DEBUG
+    if (loaded) {
+      std::weak_ptr<oglplus::Texture> weak(entry.texture);
+      for (int i = 0; i < dependencies; ++i) {
+        ResourceWatcher::instance().onChange(static_cast<Resource>(resource + i), [=]{
+          TexturePtr existing = weak.lock();
+          if (existing) {
+            uvec2 size;
+            TexturePtr rebuilt = loader(size);
+            // A broken edit keeps the old texture
+            if (rebuilt) {
+              *existing = std::move(*rebuilt);
+              TextureCache::instance().remeasure(resource);
+            }
+          }
+        });
       }
-      map[resource] = built;
-      return built;
     }
-    return itr->second;
+#endif
+    outSize = entry.size;
+    return entry.texture;
   }
 
-  TexturePtr load2dTextureFromPngData(std::vector<uint8_t> & data) {
+  TexturePtr load2dTextureFromImage(ImagePtr image) {
     using namespace oglplus;
     TexturePtr texture(new Texture());
     Context::Bound(TextureTarget::_2D, *texture)
       .MagFilter(TextureMagFilter::Linear)
       .MinFilter(TextureMinFilter::Linear);
-    ImagePtr image = loadImage(data);
     // FIXME detect alignment properly, test on both OpenCV and LibPNG
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     Texture::Image2D(TextureTarget::_2D, *image);
     return texture;
   }
 
-  TexturePtr load2dTexture(Resource resource) {
-    return loadOrPopulate(getTextureMap(), resource, [&]{
-      uvec2 size;
-      return load2dTexture(resource, size);
+  static MipOptions mipOptions(MipFilter filter) {
+    MipOptions options;
+    options.filter = filter;
+    options.pool = &ThreadPool::instance();
+    return options;
+  }
+
+  // Builds the levels below a decoded image.  Safe to call off the GL 
+  // thread.  Returns nothing for images that aren't 8 bit.
+  static std::vector<MipLevel> buildMipChain(const oglplus::images::Image & image, MipFilter filter) {
+    if (MIP_NONE == filter || oglplus::PixelDataType::UnsignedByte != image.Type()) {
+      return std::vector<MipLevel>();
+    }
+    size_t stride = image.Width() * image.Channels();
+    return buildMipChain(static_cast<const uint8_t *>(image.RawData()),
+      image.Width(), image.Height(), stride, image.Channels(), mipOptions(filter));
+  }
+
+  static void uploadMipChain(oglplus::TextureTarget target, const std::vector<MipLevel> & chain,
+      oglplus::PixelDataInternalFormat internalFormat, oglplus::PixelDataFormat format) {
+    using namespace oglplus;
+    for (size_t i = 0; i < chain.size(); ++i) {
+      Texture::Image2D(target, (GLint)i + 1, internalFormat,
+        chain[i].width, chain[i].height, 0,
+        format, PixelDataType::UnsignedByte, &chain[i].pixels[0]);
+    }
+  }
+
+  // Restricts sampling to the levels actually present, and turns on 
+  // trilinear filtering if there is more than one
+  static void setMipLevels(oglplus::TextureTarget target, int levels) {
+    glTexParameteri(GLenum(target), GL_TEXTURE_MAX_LEVEL, levels - 1);
+    if (levels > 1) {
+      glTexParameteri(GLenum(target), GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+  }
+
+  // Uploads a decoded image, and the mip chain built for it, if any
+  static int uploadImage(oglplus::TextureTarget target, const oglplus::images::Image & image,
+      const std::vector<MipLevel> & chain) {
+    using namespace oglplus;
+    // FIXME detect alignment properly, test on both OpenCV and LibPNG
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    Texture::Image2D(target, image);
+    uploadMipChain(target, chain, image.InternalFormat(), image.Format());
+    return (int)chain.size() + 1;
+  }
+
+  // For requested mips the CPU couldn't build, leave it to the driver
+  static int generateMissingMips(oglplus::TextureTarget target, int levels, const uvec2 & size, MipFilter filter) {
+    if (1 != levels || MIP_NONE == filter) {
+      return levels;
+    }
+    glGenerateMipmap(GLenum(target));
+    return (int)mipLevelCount(size.x, size.y);
+  }
+
+  // Uploads block compressed levels as they are if the driver can sample
+  // them, and if they don't need flipping or can be flipped without 
+  // decoding.  Otherwise they're decoded to RGBA8 on the CPU.
+  static void loadCompressedLevels(oglplus::TextureTarget target, const ResourceView & data,
+      const BakedAsset::TextureHeader & header, bool flip) {
+    using namespace oglplus;
+    BlockFormat blockFormat;
+    GLenum internalFormat;
+    bool supported;
+    switch (header.format) {
+    case BakedAsset::BC1:
+      blockFormat = BLOCK_BC1;
+      internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+      supported = 0 != GLEW_EXT_texture_compression_s3tc;
+      break;
+    case BakedAsset::BC3:
+      blockFormat = BLOCK_BC3;
+      internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+      supported = 0 != GLEW_EXT_texture_compression_s3tc;
+      break;
+    case BakedAsset::BC7:
+      blockFormat = BLOCK_BC7;
+      internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+      supported = 0 != GLEW_ARB_texture_compression_bptc;
+      break;
+    default:
+      FAIL("Unsupported baked texture format %d", header.format);
+    }
+
+    // The levels all have to end up in the same format, or the texture
+    // is incomplete
+    std::vector<std::vector<uint8_t>> flipped(header.levelCount);
+    bool compressed = supported;
+    for (uint32_t i = 0; compressed && !flip && i < header.levelCount; ++i) {
+      const BakedAsset::Level & level = header.levels[i];
+      flipped[i].assign(data.data + level.offset, data.data + level.offset + level.size);
+      compressed = flipBlocks(&flipped[i][0], level.width, level.height, blockFormat);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+      const BakedAsset::Level & level = header.levels[i];
+      const uint8_t * blocks = data.data + level.offset;
+      if (compressed) {
+        glCompressedTexImage2D(GLenum(target), i, internalFormat, level.width, level.height, 0,
+          (GLsizei)level.size, flip ? blocks : &flipped[i][0]);
+        continue;
+      }
+
+      std::vector<uint8_t> decoded(level.width * level.height * 4);
+      if (!decompressBlocks(blocks, level.width, level.height, blockFormat,
+          &decoded[0], level.width * 4)) {
+        FAIL("Unable to decode baked texture level %d", i);
+      }
+      if (!flip) {
+        pixels::flipVertical(&decoded[0], level.width * 4, level.width * 4, level.height);
+      }
+      Texture::Image2D(target, i, PixelDataInternalFormat::RGBA8,
+        level.width, level.height, 0,
+        PixelDataFormat::RGBA, PixelDataType::UnsignedByte, &decoded[0]);
+    }
+  }
+
+  // Uploads every level of a baked texture to the bound texture, building 
+  // a chain if the bake didn't store an uncompressed one.  Returns false if the data isn't
+  // a baked texture at all.
+  static bool loadBakedImage(oglplus::TextureTarget target, const ResourceView & data,
+      bool flip, uvec2 & outSize, int & outLevels, MipFilter mips = MIP_NONE) {
+    using namespace oglplus;
+    BakedAsset::TextureHeader header;
+    if (!BakedAsset::readTexture(data.data, data.size, header)) {
+      return false;
+    }
+    outSize = uvec2(header.width, header.height);
+    const int channels = (int)BakedAsset::texelSize(header.format);
+    if (!channels) {
+      loadCompressedLevels(target, data, header, flip);
+      outLevels = header.levelCount;
+      return true;
+    }
+
+    std::vector<uint8_t> flipped;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+      const BakedAsset::Level & level = header.levels[i];
+      const uint8_t * pixels = data.data + level.offset;
+      // Baked images are stored the way GL wants them, so only a request 
+      // for the original top to bottom row order costs a copy
+      if (!flip) {
+        size_t rowSize = level.width * channels;
+        flipped.resize((size_t)level.size);
+        for (uint32_t row = 0; row < level.height; ++row) {
+          memcpy(&flipped[row * rowSize], pixels + (level.height - row - 1) * rowSize, rowSize);
+        }
+        pixels = &flipped[0];
+      }
+      Texture::Image2D(target, i, internalFormat(channels),
+        level.width, level.height, 0,
+        pixelFormat(channels), PixelDataType::UnsignedByte, pixels);
+      if (1 == header.levelCount && MIP_NONE != mips) {
+        std::vector<MipLevel> chain = buildMipChain(pixels, level.width, level.height,
+          level.width * channels, channels, mipOptions(mips));
+        uploadMipChain(target, chain, internalFormat(channels), pixelFormat(channels));
+        header.levelCount += (uint32_t)chain.size();
+        break;
+      }
+    }
+    outLevels = header.levelCount;
+    return true;
+  }
+
+  TexturePtr load2dTextureFromPngData(std::vector<uint8_t> & data) {
+    return load2dTextureFromImage(loadImage(data));
+  }
+
+  TexturePtr load2dTexture(Resource resource, MipFilter mips) {
+    uvec2 size;
+    return load2dTexture(resource, size, mips);
+  }
+
+  TexturePtr load2dTexture(Resource resource, uvec2 & outSize, MipFilter mips) {
+    return loadOrPopulate(resource, oglplus::TextureTarget::_2D, outSize, [=](uvec2 & size) {
+      ResourceView data = Platform::getResourceView(resource);
+      DecodeTimer timer(resource);
+      return load2dTexture(data, size, mips);
     });
   }
 
+  TexturePtr load2dTexture(const ResourceView & data, uvec2 & outSize, MipFilter mips) {
+    using namespace oglplus;
+    TexturePtr texture(new Texture());
+    Context::Bound(TextureTarget::_2D, *texture)
+      .MagFilter(TextureMagFilter::Linear)
+      .MinFilter(TextureMinFilter::Linear);
+    int levels;
+    if (loadBakedImage(TextureTarget::_2D, data, true, outSize, levels, mips)) {
+      // Nothing to decode
+#ifndef HAVE_OPENCV
+    } else if (isPng(data.data, data.size)) {
+      // Uploaded straight from the decoder's buffer, without an Image copy
+      PixelBufferPtr buffer = acquirePixelBuffer();
+      DecodedImage decoded = decodePng(data.data, data.size, *buffer);
+      outSize = uvec2(decoded.width, decoded.height);
+      std::vector<MipLevel> chain;
+      if (MIP_NONE != mips) {
+        chain = buildMipChain(decoded.pixels, decoded.width, decoded.height,
+          decoded.stride, decoded.channels, mipOptions(mips));
+      }
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      Texture::Image2D(TextureTarget::_2D, 0, internalFormat(decoded.channels),
+        decoded.width, decoded.height, 0,
+        pixelFormat(decoded.channels), PixelDataType::UnsignedByte, decoded.pixels);
+      uploadMipChain(TextureTarget::_2D, chain, internalFormat(decoded.channels), pixelFormat(decoded.channels));
+      levels = (int)chain.size() + 1;
+#endif
+    } else {
+      ImagePtr image = loadImage(data);
+      outSize.x = image->Width();
+      outSize.y = image->Height();
+      levels = uploadImage(TextureTarget::_2D, *image, buildMipChain(*image, mips));
+    }
+    levels = generateMissingMips(TextureTarget::_2D, levels, outSize, mips);
+    setMipLevels(TextureTarget::_2D, levels);
+    return texture;
+  }
+
+  // Keeps the red channel, and the alpha if it isn't all opaque, writing
+  // the rows bottom up if the source is top down
+  static int reduceDistanceField(const uint8_t * pixels, uint32_t width, uint32_t height, size_t stride,
+      int channels, int red, bool flip, std::vector<uint8_t> & out) {
+    const int alpha = (2 == channels || 4 == channels) ? channels - 1 : -1;
+    bool opaque = true;
+    for (uint32_t y = 0; opaque && -1 != alpha && y < height; ++y) {
+      for (uint32_t x = 0; x < width; ++x) {
+        if (0xFF != pixels[y * stride + x * channels + alpha]) {
+          opaque = false;
+          break;
+        }
+      }
+    }
+    const int outChannels = opaque ? 1 : 2;
+    out.resize(width * height * outChannels);
+    for (uint32_t y = 0; y < height; ++y) {
+      const uint8_t * row = pixels + (flip ? height - 1 - y : y) * stride;
+      uint8_t * dest = &out[y * width * outChannels];
+      for (uint32_t x = 0; x < width; ++x) {
+        dest[x * outChannels] = row[x * channels + red];
+        if (!opaque) {
+          dest[x * outChannels + 1] = row[x * channels + alpha];
+        }
+      }
+    }
+    return outChannels;
+  }
 
-  TexturePtr load2dTexture(Resource resource, uvec2 & outSize) {
+  TexturePtr loadDistanceFieldTexture(const ResourceView & data, uvec2 & outSize) {
     using namespace oglplus;
     TexturePtr texture(new Texture());
     Context::Bound(TextureTarget::_2D, *texture)
       .MagFilter(TextureMagFilter::Linear)
       .MinFilter(TextureMinFilter::Linear);
-    ImagePtr image = loadImage(resource);
-    outSize.x = image->Width();
-    outSize.y = image->Height();
-    // FIXME detect alignment properly, test on both OpenCV and LibPNG
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    Texture::Image2D(TextureTarget::_2D, *image);
+    int levels;
+    int channels;
+    BakedAsset::TextureHeader header;
+    if (loadBakedImage(TextureTarget::_2D, data, true, outSize, levels)) {
+      BakedAsset::readTexture(data.data, data.size, header);
+      channels = (int)BakedAsset::texelSize(header.format);
+    } else {
+      std::vector<uint8_t> reduced;
+#ifdef HAVE_OPENCV
+      cv::Mat encoded(1, (int)data.size, CV_8UC1, const_cast<uint8_t*>(data.data));
+      cv::Mat image = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+      if (image.empty() || CV_8U != image.depth()) {
+        FAIL("Unable to decode distance field atlas");
+      }
+      // OpenCV decodes color as BGR
+      int red = image.channels() >= 3 ? 2 : 0;
+      channels = reduceDistanceField(image.data, image.cols, image.rows, image.step,
+        image.channels(), red, true, reduced);
+      outSize = uvec2(image.cols, image.rows);
+#else
+      PixelBufferPtr buffer = acquirePixelBuffer();
+      DecodedImage decoded = decodePng(data.data, data.size, *buffer);
+      channels = reduceDistanceField(decoded.pixels, decoded.width, decoded.height, decoded.stride,
+        decoded.channels, 0, false, reduced);
+      outSize = uvec2(decoded.width, decoded.height);
+#endif
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      Texture::Image2D(TextureTarget::_2D, 0, internalFormat(channels),
+        outSize.x, outSize.y, 0,
+        pixelFormat(channels), PixelDataType::UnsignedByte, &reduced[0]);
+      levels = 1;
+    }
+    setMipLevels(TextureTarget::_2D, levels);
+    // Sampled as the gray image the atlas used to be expanded to, so the
+    // text shader reads the distance from any color channel.  Block
+    // compressed atlases have no texel size, and keep their own channels.
+    if (1 == channels || 2 == channels) {
+      GLint swizzle[] = { GL_RED, GL_RED, GL_RED, 2 == channels ? GL_GREEN : GL_ONE };
+      glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    DefaultTexture().Bind(TextureTarget::_2D);
     return texture;
   }
 
-  TexturePtr loadCubemapTexture(Resource firstResource, int resourceOrder[6], bool flip) {
-  return loadOrPopulate(getTextureMap(), firstResource, [&]{
+  TexturePtr loadCubemapTexture(Resource firstResource, int resourceOrder[6], bool flip, MipFilter mips) {
+  std::array<int, 6> order;
+  std::copy(resourceOrder, resourceOrder + 6, order.begin());
+  uvec2 faceSize;
+  return loadOrPopulate(firstResource, oglplus::TextureTarget::CubeMap, faceSize, [=](uvec2 & size) {
     using namespace oglplus;
     TexturePtr texture(new Texture());
     Context::Bound(TextureTarget::CubeMap, *texture)
@@ -125,24 +434,83 @@ namespace oria {
       .WrapT(TextureWrap::ClampToEdge)
       .WrapR(TextureWrap::ClampToEdge);
 
-    glm::uvec2 size;
+    // Read and decode the six faces, and build their mip chains, on the 
+    // worker pool, leaving only the uploads for the GL thread.  Baked faces
+    // need no decoding at all.
+    std::vector<Resource> faces;
     for (int i = 0; i < 6; ++i) {
-      Resource image = static_cast<Resource>(firstResource + i);
-      int cubeMapFace = resourceOrder[i];
-      Texture::Image2D(
-        Texture::CubeMapFace(cubeMapFace),
-        *loadImage(image, flip)
-        );
+      faces.push_back(static_cast<Resource>(firstResource + i));
     }
+    std::vector<ResourceView> faceData(6);
+    std::vector<ImagePtr> faceImages(6);
+    std::vector<std::vector<MipLevel>> faceChains(6);
+    ThreadPool::instance().parallelFor(6, [&](size_t i) {
+      faceData[i] = Platform::getResourceView(faces[i]);
+      if (!BakedAsset::isBaked(faceData[i].data, faceData[i].size, BakedAsset::TEXTURE)) {
+        DecodeTimer timer(faces[i]);
+        faceImages[i] = loadImage(faceData[i], flip);
+        faceChains[i] = buildMipChain(*faceImages[i], mips);
+      }
+    });
+
+    // The faces all have to be the same size, so they all get the same 
+    // number of levels
+    int levels = 1;
+    for (int i = 0; i < 6; ++i) {
+      TextureTarget face = Texture::CubeMapFace(order[i]);
+      if (faceImages[i]) {
+        size = uvec2(faceImages[i]->Width(), faceImages[i]->Height());
+        levels = uploadImage(face, *faceImages[i], faceChains[i]);
+        continue;
+      }
+      DecodeTimer timer(faces[i]);
+      loadBakedImage(face, faceData[i], flip, size, levels, mips);
+    }
+    levels = generateMissingMips(TextureTarget::CubeMap, levels, size, mips);
+    setMipLevels(TextureTarget::CubeMap, levels);
     return texture;
-  });
+  }, 6);
 }
 
-  TexturePtr loadCubemapTexture(Resource firstResource, bool flip) {
+  TexturePtr loadCubemapTexture(Resource firstResource, bool flip, MipFilter mips) {
     static int RESOURCE_ORDER[] = {
       1, 0, 3, 2, 5, 4
     };
-    return loadCubemapTexture(firstResource, RESOURCE_ORDER, flip);
+    return loadCubemapTexture(firstResource, RESOURCE_ORDER, flip, mips);
+  }
+
+  TexturePtr loadCubemapTexture(const std::vector<MipLevel> & faces, int channels, MipFilter mips) {
+    using namespace oglplus;
+    if (6 != faces.size() || channels < 1 || channels > 4) {
+      FAIL("A cubemap needs six faces of 1 to 4 channels");
+    }
+
+    std::vector<std::vector<MipLevel>> chains(6);
+    if (MIP_NONE != mips) {
+      ThreadPool::instance().parallelFor(6, [&](size_t i) {
+        chains[i] = buildMipChain(&faces[i].pixels[0], faces[i].width, faces[i].height,
+          faces[i].width * channels, channels, mipOptions(mips));
+      });
+    }
+
+    TexturePtr texture(new Texture());
+    Context::Bound(TextureTarget::CubeMap, *texture)
+      .MagFilter(TextureMagFilter::Linear)
+      .MinFilter(TextureMinFilter::Linear)
+      .WrapS(TextureWrap::ClampToEdge)
+      .WrapT(TextureWrap::ClampToEdge)
+      .WrapR(TextureWrap::ClampToEdge);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < 6; ++i) {
+      TextureTarget face = Texture::CubeMapFace(i);
+      Texture::Image2D(face, 0, internalFormat(channels),
+        faces[i].width, faces[i].height, 0,
+        pixelFormat(channels), PixelDataType::UnsignedByte, &faces[i].pixels[0]);
+      uploadMipChain(face, chains[i], internalFormat(channels), pixelFormat(channels));
+    }
+    setMipLevels(TextureTarget::CubeMap, (int)chains[0].size() + 1);
+    DefaultTexture().Bind(TextureTarget::CubeMap);
+    return texture;
   }
 
 }
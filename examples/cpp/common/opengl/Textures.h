@@ -23,12 +23,26 @@ typedef std::shared_ptr<oglplus::Texture> TexturePtr;
 typedef std::shared_ptr<oglplus::images::Image> ImagePtr;
 
 namespace oria {
+  ImagePtr loadImage(const ResourceView & data, bool flip = true);
   ImagePtr loadImage(std::vector<uint8_t> & data, bool flip = true);
   ImagePtr loadImage(Resource resource, bool flip = true);
+  TexturePtr load2dTextureFromImage(ImagePtr image);
   TexturePtr load2dTextureFromPngData(std::vector<uint8_t> & data);
-  TexturePtr load2dTexture(Resource resource);
-  TexturePtr load2dTexture(Resource resource, uvec2 & outSize);
-  TexturePtr loadCubemapTexture(Resource firstResource, int resourceOrder[6], bool flip = true);
-  TexturePtr loadCubemapTexture(Resource firstResource, bool flip = true);
+  // The Resource overloads go through the TextureCache, so the mip (and 
+  // flip) setting of the first request for a resource wins
+  TexturePtr load2dTexture(Resource resource, MipFilter mips = MIP_NONE);
+  TexturePtr load2dTexture(Resource resource, uvec2 & outSize, MipFilter mips = MIP_NONE);
+  // Accepts either a baked texture or an encoded image.  A baked mip chain 
+  // is always used, otherwise one is built on the CPU if mips are requested.
+  TexturePtr load2dTexture(const ResourceView & data, uvec2 & outSize, MipFilter mips = MIP_NONE);
+  // A signed distance field, such as a font atlas, as R8, or RG8 if it 
+  // has an alpha channel that isn't all opaque.  It samples as gray, with 
+  // the distance in every color channel.
+  TexturePtr loadDistanceFieldTexture(const ResourceView & data, uvec2 & outSize);
+  TexturePtr loadCubemapTexture(Resource firstResource, int resourceOrder[6], bool flip = true, MipFilter mips = MIP_NONE);
+  TexturePtr loadCubemapTexture(Resource firstResource, bool flip = true, MipFilter mips = MIP_NONE);
+  // Faces as produced by equirectToCubemap, in the order of the GL face 
+  // targets and uploaded as they are.  Not cached.
+  TexturePtr loadCubemapTexture(const std::vector<MipLevel> & faces, int channels, MipFilter mips = MIP_NONE);
 
 }
@@ -0,0 +1,273 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#include "Common.h"
+
+static const char * PANORAMA_VS =
+"#version 330\n"
+"uniform mat4 Projection;\n"
+"uniform mat4 ModelView;\n"
+"in vec4 Position;\n"
+"out vec3 vDirection;\n"
+"void main() {\n"
+"  vDirection = Position.xyz;\n"
+"  gl_Position = Projection * ModelView * Position;\n"
+"}\n";
+
+// Must agree with PanoramaLayout::direction()
+static const char * PANORAMA_FS =
+"#version 330\n"
+"const float PI = 3.14159265358979;\n"
+"uniform sampler2D Cache;\n"
+"uniform sampler2D Indirection;\n"
+"uniform sampler2D Fallback;\n"
+"uniform vec2 FullSize;\n"
+"uniform vec2 CropPosition;\n"
+"uniform vec2 CropSize;\n"
+"uniform float TileSize;\n"
+"uniform float SlotSize;\n"
+"uniform float CacheSize;\n"
+"uniform vec4 Background;\n"
+"in vec3 vDirection;\n"
+"out vec4 FragColor;\n"
+"void main() {\n"
+"  vec3 d = normalize(vDirection);\n"
+"  vec2 uv = vec2(atan(d.x, -d.z) / (2.0 * PI) + 0.5, 0.5 - asin(clamp(d.y, -1.0, 1.0)) / PI);\n"
+"  vec2 texel = uv * FullSize - CropPosition;\n"
+"  if (any(lessThan(texel, vec2(0.0))) || any(greaterThanEqual(texel, CropSize))) {\n"
+"    FragColor = Background;\n"
+"    return;\n"
+"  }\n"
+"  ivec2 tile = ivec2(texel / TileSize);\n"
+"  vec4 entry = texelFetch(Indirection, tile, 0);\n"
+"  if (entry.b < 0.5) {\n"
+"    FragColor = textureLod(Fallback, texel / CropSize, 0.0);\n"
+"    return;\n"
+"  }\n"
+"  vec2 slot = floor(entry.rg * 255.0 + 0.5);\n"
+"  vec2 local = texel - vec2(tile) * TileSize;\n"
+"  FragColor = textureLod(Cache, (slot * SlotSize + 1.0 + local) / CacheSize, 0.0);\n"
+"}\n";
+
+static TexturePtr createTexture(const uvec2 & size, const uint8_t * pixels) {
+  using namespace oglplus;
+  TexturePtr texture(new Texture());
+  Context::Bound(TextureTarget::_2D, *texture)
+    .MagFilter(TextureMagFilter::Linear)
+    .MinFilter(TextureMinFilter::Linear)
+    .WrapS(TextureWrap::ClampToEdge)
+    .WrapT(TextureWrap::ClampToEdge);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  DefaultTexture().Bind(TextureTarget::_2D);
+  return texture;
+}
+
+VirtualPanorama::VirtualPanorama(const oria::PanoramaLayout & layout, const TileSource & source,
+    const uvec2 & fallbackSize, const uint8_t * fallbackPixels,
+    uint32_t tileSize, uint32_t requestedCacheSize)
+  : tiles(layout, tileSize), source(source), slotSize(tileSize + 2) {
+  GLint maxSize = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+  cacheSize = std::min(requestedCacheSize, (uint32_t)maxSize);
+  slotsPerSide = std::min(cacheSize / slotSize, 255u);
+  if (0 == slotsPerSide) {
+    FAIL("Panorama tiles of %d texels don't fit a %d texel cache", tileSize, cacheSize);
+  }
+  slots.resize(slotsPerSide * slotsPerSide);
+  tileSlots.assign(tiles.getColumns() * tiles.getRows(), -1);
+  staging.resize(slotSize * slotSize * 4);
+
+  cache = createTexture(uvec2(cacheSize), nullptr);
+  std::vector<uint8_t> empty(tileSlots.size() * 4, 0);
+  indirection = createTexture(uvec2(tiles.getColumns(), tiles.getRows()), &empty[0]);
+  // The table is read with texelFetch, but keep it from ever blending
+  // two entries
+  indirection->Bind(oglplus::TextureTarget::_2D);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  oglplus::DefaultTexture().Bind(oglplus::TextureTarget::_2D);
+  fallback = createTexture(fallbackSize, fallbackPixels);
+
+  program = oria::buildProgram(PANORAMA_VS, PANORAMA_FS);
+  if (!program) {
+    FAIL("Unable to build the panorama program");
+  }
+}
+
+size_t VirtualPanorama::getResidentTiles() const {
+  return std::count_if(slots.begin(), slots.end(), [](const Slot & slot) {
+    return -1 != slot.tile;
+  });
+}
+
+int VirtualPanorama::findSlot() {
+  int best = -1;
+  for (size_t i = 0; i < slots.size(); ++i) {
+    const Slot & slot = slots[i];
+    if (-1 == slot.tile) {
+      return (int)i;
+    }
+    // Never evict a tile in view
+    if (slot.lastUsed < frame && (-1 == best || slot.lastUsed < slots[best].lastUsed)) {
+      best = (int)i;
+    }
+  }
+  if (-1 != best) {
+    int tile = slots[best].tile;
+    tileSlots[tile] = -1;
+    setIndirection(tile % tiles.getColumns(), tile / tiles.getColumns(), -1);
+    slots[best].tile = -1;
+  }
+  return best;
+}
+
+void VirtualPanorama::setIndirection(uint32_t x, uint32_t y, int slot) {
+  uint8_t entry[4] = { 0, 0, 0, 0 };
+  if (-1 != slot) {
+    entry[0] = (uint8_t)(slot % slotsPerSide);
+    entry[1] = (uint8_t)(slot / slotsPerSide);
+    entry[2] = 0xFF;
+    entry[3] = 0xFF;
+  }
+  indirection->Bind(oglplus::TextureTarget::_2D);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, entry);
+  oglplus::DefaultTexture().Bind(oglplus::TextureTarget::_2D);
+}
+
+void VirtualPanorama::loadTile(uint32_t x, uint32_t y, int slot) {
+  using oria::AtlasRect;
+  const oria::PanoramaLayout & layout = tiles.getLayout();
+  const AtlasRect rect = tiles.tileRect(x, y);
+  const size_t stride = slotSize * 4;
+  // A panorama covering the full circle wraps around at the sides
+  const bool wraps = layout.cropWidth == layout.fullWidth;
+
+  // The tile and whatever of its border lies inside the crop
+  AtlasRect bordered;
+  bordered.x = rect.x ? rect.x - 1 : 0;
+  bordered.y = rect.y ? rect.y - 1 : 0;
+  bordered.width = std::min(rect.x + rect.width + 1, layout.cropWidth) - bordered.x;
+  bordered.height = std::min(rect.y + rect.height + 1, layout.cropHeight) - bordered.y;
+  uint32_t offsetX = bordered.x + 1 - rect.x;
+  uint32_t offsetY = bordered.y + 1 - rect.y;
+  source(bordered, &staging[offsetY * stride + offsetX * 4], stride);
+
+  uint32_t lastColumn = rect.width + 1;
+  uint32_t lastRow = rect.height + 1;
+  AtlasRect column;
+  column.y = bordered.y;
+  column.width = 1;
+  column.height = bordered.height;
+  if (0 == rect.x) {
+    if (wraps) {
+      column.x = layout.cropWidth - 1;
+      source(column, &staging[offsetY * stride], stride);
+    } else {
+      for (uint32_t row = 0; row < slotSize; ++row) {
+        memcpy(&staging[row * stride], &staging[row * stride + 4], 4);
+      }
+    }
+  }
+  if (rect.x + rect.width == layout.cropWidth) {
+    if (wraps) {
+      column.x = 0;
+      source(column, &staging[offsetY * stride + lastColumn * 4], stride);
+    } else {
+      for (uint32_t row = 0; row < slotSize; ++row) {
+        memcpy(&staging[row * stride + lastColumn * 4], &staging[row * stride + (lastColumn - 1) * 4], 4);
+      }
+    }
+  }
+  // Rows last, so they pick up the corners
+  if (0 == rect.y) {
+    memcpy(&staging[0], &staging[stride], stride);
+  }
+  if (rect.y + rect.height == layout.cropHeight) {
+    memcpy(&staging[lastRow * stride], &staging[(lastRow - 1) * stride], stride);
+  }
+
+  cache->Bind(oglplus::TextureTarget::_2D);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexSubImage2D(GL_TEXTURE_2D, 0,
+    (slot % slotsPerSide) * slotSize, (slot / slotsPerSide) * slotSize,
+    slotSize, slotSize, GL_RGBA, GL_UNSIGNED_BYTE, &staging[0]);
+  oglplus::DefaultTexture().Bind(oglplus::TextureTarget::_2D);
+
+  uint32_t tile = y * tiles.getColumns() + x;
+  slots[slot].tile = (int)tile;
+  slots[slot].lastUsed = frame;
+  tileSlots[tile] = slot;
+  setIndirection(x, y, slot);
+}
+
+void VirtualPanorama::update(const vec3 & viewDirection, float halfFov) {
+  ++frame;
+  tiles.visibleTiles(&viewDirection.x, halfFov, visible);
+  for (size_t i = 0; i < visible.size(); ++i) {
+    int slot = tileSlots[visible[i].y * tiles.getColumns() + visible[i].x];
+    if (-1 != slot) {
+      slots[slot].lastUsed = frame;
+    }
+  }
+
+  int uploads = 0;
+  for (size_t i = 0; i < visible.size() && uploads < uploadsPerUpdate; ++i) {
+    const oria::TileRequest & request = visible[i];
+    if (-1 != tileSlots[request.y * tiles.getColumns() + request.x]) {
+      continue;
+    }
+    int slot = findSlot();
+    if (-1 == slot) {
+      // Everything resident is in view, and nearer than this
+      break;
+    }
+    loadTile(request.x, request.y, slot);
+    ++uploads;
+  }
+}
+
+void VirtualPanorama::render(ShapeWrapperPtr & shape) {
+  using namespace oglplus;
+  const oria::PanoramaLayout & layout = tiles.getLayout();
+  Texture::Active(0);
+  cache->Bind(TextureTarget::_2D);
+  Texture::Active(1);
+  indirection->Bind(TextureTarget::_2D);
+  Texture::Active(2);
+  fallback->Bind(TextureTarget::_2D);
+  oria::renderGeometry(shape, program, [&]{
+    Uniform<int>(*program, "Cache").Set(0);
+    Uniform<int>(*program, "Indirection").Set(1);
+    Uniform<int>(*program, "Fallback").Set(2);
+    Uniform<vec2>(*program, "FullSize").Set(vec2(layout.fullWidth, layout.fullHeight));
+    Uniform<vec2>(*program, "CropPosition").Set(vec2(layout.cropX, layout.cropY));
+    Uniform<vec2>(*program, "CropSize").Set(vec2(layout.cropWidth, layout.cropHeight));
+    Uniform<float>(*program, "TileSize").Set((float)tiles.getTileSize());
+    Uniform<float>(*program, "SlotSize").Set((float)slotSize);
+    Uniform<float>(*program, "CacheSize").Set((float)cacheSize);
+    Uniform<vec4>(*program, "Background").Set(background);
+  });
+  for (int i = 2; i >= 0; --i) {
+    Texture::Active(i);
+    DefaultTexture().Bind(TextureTarget::_2D);
+  }
+}
@@ -0,0 +1,93 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+#pragma once
+
+/**
+ * A panorama too big to keep on the GPU whole, drawn as a virtual texture.
+ *
+ * The cropped area of the panorama is cut into tiles (see PanoramaTiles),
+ * and only those around where the viewer is looking are kept in a cache
+ * texture, each in a slot with a one texel border so filtering doesn't
+ * reach into its neighbours.  A small indirection texture, one texel per
+ * tile, says which slot holds each tile, if any.  Anything not resident
+ * is drawn from a low resolution copy of the whole crop, which always is,
+ * and anything outside the crop gets the background color.
+ *
+ * The panorama is drawn on any geometry centered on the viewer, with the
+ * direction to each fragment picking the texel, so the geometry needs only
+ * positions.
+ */
+class VirtualPanorama {
+public:
+  // Writes a rectangle of the crop (relative to its corner, top row first)
+  // into RGBA8 memory.  Called on the GL thread, from update().
+  typedef std::function<void(const oria::AtlasRect & rect, uint8_t * rgba, size_t stride)> TileSource;
+
+private:
+  struct Slot {
+    int tile{ -1 };
+    uint64_t lastUsed{ 0 };
+  };
+
+  oria::PanoramaTiles tiles;
+  TileSource source;
+  uint32_t slotSize;
+  uint32_t slotsPerSide;
+  uint32_t cacheSize;
+  TexturePtr cache;
+  TexturePtr indirection;
+  TexturePtr fallback;
+  ProgramPtr program;
+  std::vector<Slot> slots;
+  // The slot holding each tile, or -1
+  std::vector<int> tileSlots;
+  std::vector<oria::TileRequest> visible;
+  std::vector<uint8_t> staging;
+  uint64_t frame{ 0 };
+
+  int findSlot();
+  void loadTile(uint32_t x, uint32_t y, int slot);
+  void setIndirection(uint32_t x, uint32_t y, int slot);
+
+public:
+  vec4 background{ 0.33f, 0.33f, 0.33f, 1.0f };
+  // Tiles loaded per update(), which bounds the cost of any one frame
+  int uploadsPerUpdate{ 4 };
+
+  // The fallback is RGBA8 covering the crop, top row first, at any size
+  VirtualPanorama(const oria::PanoramaLayout & layout, const TileSource & source,
+    const uvec2 & fallbackSize, const uint8_t * fallbackPixels,
+    uint32_t tileSize = 254, uint32_t cacheSize = 4096);
+
+  // Brings in the tiles within halfFov radians of the view direction,
+  // nearest first, evicting the least recently seen if the cache is full
+  void update(const vec3 & viewDirection, float halfFov);
+
+  // The shape must have been built for getProgram()
+  void render(ShapeWrapperPtr & shape);
+
+  ProgramPtr & getProgram() {
+    return program;
+  }
+
+  size_t getResidentTiles() const;
+};
+
+typedef std::shared_ptr<VirtualPanorama> VirtualPanoramaPtr;
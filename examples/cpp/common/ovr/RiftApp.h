@@ -42,6 +42,11 @@ protected:
   virtual void update();
   virtual void renderScene() = 0;
 
+  // Both eyes side by side, before distortion, so the captures don't
+  // depend on timing
+  virtual glm::uvec2 getCaptureSize();
+  virtual void readCaptureFrame(FrameCapture & capture);
+
   virtual void applyEyePoseAndOffset(const glm::mat4 & eyePose, const glm::vec3 & eyeOffset);
 
   inline ovrEyeType getCurrentEye() const {
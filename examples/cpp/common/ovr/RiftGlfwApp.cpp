@@ -190,6 +190,15 @@ void RiftApp::draw() {
 #endif
 }
 
+glm::uvec2 RiftApp::getCaptureSize() {
+  return eyeFramebuffers[0]->size * glm::uvec2(2, 1);
+}
+
+void RiftApp::readCaptureFrame(FrameCapture & capture) {
+  capture.read(*eyeFramebuffers[ovrEye_Left], uvec2(0));
+  capture.read(*eyeFramebuffers[ovrEye_Right], uvec2(eyeFramebuffers[0]->size.x, 0));
+}
+
 void RiftApp::renderStringAt(const std::string & str, float x, float y, float size) {
   MatrixStack & mv = Stacks::modelview();
   MatrixStack & pr = Stacks::projection();
@@ -104,6 +104,7 @@ void QRiftWidget::renderLoop() {
     tasks.drainTaskQueue();
     if (isRenderingConfigured()) {
       draw();
+      TextureCache::instance().endFrame();
     } else {
       QThread::msleep(4);
     }
@@ -7,37 +7,104 @@
 
 
 class PhotoSphereExample : public RiftApp {
-
-
+  // The decoded panorama.  If it fits in a cubemap at full resolution
+  // it's converted to one, which is cheaper to draw and has no distortion
+  // at the poles.  Otherwise it's kept on the CPU, so tiles can be cut
+  // from it as they come into view.
+  struct Panorama {
+    TexturePtr cubemap;
+    cv::Mat image;
+    oria::PanoramaLayout layout;
+    uvec2 fallbackSize;
+    std::vector<uint8_t> fallback;
+  };
+  typedef std::shared_ptr<Panorama> PanoramaDataPtr;
+
+  // Decoding the panorama would stall the first frames for a noticeable
+  // time, so it loads in the background
+  std::unique_ptr<oria::UploadQueue> uploads;
+  PanoramaDataPtr data;
+  TexturePtr cubemap;
+  ProgramPtr cubemapProgram;
+  VirtualPanoramaPtr panorama;
+  ShapeWrapperPtr geometry;
 
 public:
   PhotoSphereExample() {
   }
 
-  void drawSphere() {
-    static ProgramPtr program = oria::loadProgram(Resource::SHADERS_TEXTURED_VS, Resource::SHADERS_TEXTURED_FS);
-    static ShapeWrapperPtr geometry = oria::loadShape({ "Position", "TexCoord" }, Resource::MESHES_SPHERE_CTM, program);
-    static TexturePtr t = loadAndPositionPhotoSphereImage(Resource::IMAGES_PANO_20140620_160351_JPG);
-    Platform::addShutdownHook([]{
-      program.reset();
-      geometry.reset();
-      t.reset();
-    }); 
-
-    t->Bind(oglplus::Texture::Target::_2D);
-    MatrixStack & mv = Stacks::modelview();
-    mv.withPush([&] {
-      // Invert the sphere to see its insides
-      mv.scale(vec3(-1));
-      oria::renderGeometry(geometry, program);
+  void initGl() {
+    RiftApp::initGl();
+    uploads.reset(new oria::UploadQueue(getWindow()));
+    uploads->submit([] {
+      return decodePanorama(Resource::IMAGES_PANO_20140620_160351_JPG);
+    }, [&](const PanoramaDataPtr & decoded) {
+      if (decoded->cubemap) {
+        cubemap = decoded->cubemap;
+        cubemapProgram = oria::loadProgram(Resource::SHADERS_CUBEMAP_VS, Resource::SHADERS_CUBEMAP_FS);
+        uploads->loadShape({ "Position" }, Resource::MESHES_SPHERE_CTM, cubemapProgram, [&](ShapeWrapperPtr shape) {
+          geometry = shape;
+        });
+        return;
+      }
+      data = decoded;
+      panorama = VirtualPanoramaPtr(new VirtualPanorama(data->layout,
+        [&](const oria::AtlasRect & rect, uint8_t * rgba, size_t stride) {
+          const cv::Mat & image = data->image;
+          oria::pixels::bgrToRgba(image.ptr(rect.y) + rect.x * 3, image.step, rgba, stride, rect.width, rect.height);
+        }, data->fallbackSize, &data->fallback[0]));
+      // Only positions are needed, the panorama works out the rest
+      uploads->loadShape({ "Position" }, Resource::MESHES_SPHERE_CTM, panorama->getProgram(), [&](ShapeWrapperPtr shape) {
+        geometry = shape;
+      });
     });
-    oglplus::DefaultTexture().Bind(oglplus::Texture::Target::_2D);
+  }
+
+  void shutdownGl() {
+    uploads.reset();
+    geometry.reset();
+    cubemap.reset();
+    cubemapProgram.reset();
+    panorama.reset();
+    data.reset();
+    RiftApp::shutdownGl();
+  }
+
+  void update() {
+    RiftApp::update();
+    uploads->poll();
+    if (panorama) {
+      vec3 forward = ovr::toGlm(getEyePose(ovrEye_Left).Orientation) * vec3(0, 0, -1);
+      // A little over half the Rift's field of view, so turning the head
+      // doesn't immediately outrun the tiles
+      panorama->update(forward, 1.0f);
+    }
+  }
+
+  void drawSphere() {
+    if (!geometry) {
+      return;
+    }
+    // The panorama is looked up by direction, so either side of the
+    // sphere shows it the right way around
+    oglplus::Context::Disable(oglplus::Capability::CullFace);
+    if (cubemap) {
+      cubemap->Bind(oglplus::TextureTarget::CubeMap);
+      oria::renderGeometry(geometry, cubemapProgram);
+      oglplus::DefaultTexture().Bind(oglplus::TextureTarget::CubeMap);
+    } else {
+      panorama->render(geometry);
+    }
+    oglplus::Context::Enable(oglplus::Capability::CullFace);
   }
 
   void renderScene() {
     using namespace oglplus;
     Context::Clear().DepthBuffer();
-    glClear(GL_DEPTH_BUFFER_BIT);
+    // The skybox is drawn without depth testing, so it has to go first
+    if (cubemap) {
+      oria::renderSkybox(cubemap);
+    }
 
     MatrixStack & mv = Stacks::modelview();
     mv.withPush([&]{
@@ -50,66 +117,73 @@ public:
       oria::renderRift();
     });
 
-    Context::Disable(Capability::CullFace);
-    glDisable(GL_CULL_FACE);
-    mv.withPush([&]{
-      mv.scale(50.0f);
-      drawSphere();
-    });
-    Context::Enable(Capability::CullFace);
+    if (!cubemap) {
+      mv.withPush([&]{
+        mv.scale(50.0f);
+        drawSphere();
+      });
+    }
   }
 
   /**
-   * Call out to the exiv2 binary to retrieve the XMP fields encoded in the target image file.
+   * Decode the panorama and work out where it sits on the sphere, from the
+   * XMP fields exiv2 extracted.  Only the image itself is kept, rather than
+   * embedding it in a full sized panorama.  Runs on the upload thread, so
+   * the cubemap can be created here as well.
    */
-  static TexturePtr loadAndPositionPhotoSphereImage(Resource res) {
-    glm::uvec2 fullPanoSize;
-    glm::uvec2 croppedImageSize;
-    glm::uvec2 croppedImagePos;
-    using namespace oglplus;
-
-    TexturePtr texture(new Texture());
-    Platform::addShutdownHook([&]{
-      texture.reset();
-    });
+  static PanoramaDataPtr decodePanorama(Resource res) {
+    PanoramaDataPtr result(new Panorama());
     auto v = Platform::getResourceByteVector(res);
-    cv::Mat mat = cv::imdecode(v, CV_LOAD_IMAGE_COLOR);
-    cv::cvtColor(mat, mat, CV_BGR2RGB);
-    //cv::flip(mat, mat, 0);
-    Context::Bound(TextureTarget::_2D, *texture)
-      .MagFilter(TextureMagFilter::Linear)
-      .MinFilter(TextureMinFilter::Linear);
-
-    if (parseExifData(Platform::getResourceString(Resource::MISC_PANO_20140620_160351_EXIV), fullPanoSize, croppedImageSize, croppedImagePos)) {
-
-      // EXIF data parsed succesfully
-      uchar *embedded = (uchar*)malloc(fullPanoSize.x * fullPanoSize.y * 3);
-      insetImage(fullPanoSize, croppedImageSize, croppedImagePos, mat, embedded);
-      Context::Bound(TextureTarget::_2D, *texture)
-        .Image2D(images::Image(fullPanoSize.x, fullPanoSize.y, 1, 3, embedded));
-      free(embedded);
+    cv::Mat & mat = result->image;
+    mat = cv::imdecode(v, CV_LOAD_IMAGE_COLOR);
+    if (mat.empty()) {
+      FAIL("Unable to decode the panorama");
+    }
+
+    oria::PanoramaLayout & layout = result->layout;
+    glm::uvec2 fullPanoSize, croppedImageSize, croppedImagePos;
+    if (parseExifData(Platform::getResourceString(Resource::MISC_PANO_20140620_160351_EXIV), fullPanoSize, croppedImageSize, croppedImagePos)
+        && croppedImagePos.x < fullPanoSize.x && croppedImagePos.y < fullPanoSize.y) {
+      layout.fullWidth = fullPanoSize.x;
+      layout.fullHeight = fullPanoSize.y;
+      layout.cropX = croppedImagePos.x;
+      layout.cropY = croppedImagePos.y;
+      // Don't trust the metadata to agree with the image, or with itself
+      layout.cropWidth = std::min(std::min<uint32_t>(croppedImageSize.x, mat.cols), fullPanoSize.x - croppedImagePos.x);
+      layout.cropHeight = std::min(std::min<uint32_t>(croppedImageSize.y, mat.rows), fullPanoSize.y - croppedImagePos.y);
+    } else {
+      // Treat the image as covering the whole sphere
+      layout.fullWidth = layout.cropWidth = mat.cols;
+      layout.fullHeight = layout.cropHeight = mat.rows;
     }
-    else {
-      // Failed to load EXIF data
-      texture->Bind(Texture::Target::_2D);
-      Context::PixelStore(PixelStorageMode::UnpackAlignment, 1);
-      Context::Bound(TextureTarget::_2D, *texture)
-        .Image2D(images::Image(mat.cols, mat.rows, 1, 3, mat.datastart));
+    if (layout.cropWidth != (uint32_t)mat.cols || layout.cropHeight != (uint32_t)mat.rows) {
+      mat = mat(cv::Rect(0, 0, layout.cropWidth, layout.cropHeight));
     }
 
-    return texture;
-  }
+    // A quarter of the full width keeps the resolution of the equator
+    GLint maxCubemapSize = 0;
+    glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &maxCubemapSize);
+    if (layout.fullWidth / 4 <= (uint32_t)maxCubemapSize) {
+      cv::Mat rgb;
+      cv::cvtColor(mat, rgb, CV_BGR2RGB);
+      oria::CubemapOptions options;
+      options.pool = &ThreadPool::instance();
+      std::vector<oria::MipLevel> faces = oria::equirectToCubemap(rgb.data, rgb.step, 3, layout, options);
+      result->cubemap = oria::loadCubemapTexture(faces, 3, oria::MIP_BOX);
+      mat.release();
+      return result;
+    }
 
-  /**
-   * Embed the image in mat into a larger frame.
-   */
-  static void insetImage(glm::uvec2 &fullPanoSize, glm::uvec2 &croppedImageSize, glm::uvec2 &croppedImagePos, cv::Mat &mat, uchar *out) {
-    memset(out, 84, fullPanoSize.x * fullPanoSize.y * 3);
-    for (unsigned int y = 0; y < croppedImageSize.y; y++) {
-      int srcRow = y * croppedImageSize.x * 3;
-      int destRow = (croppedImagePos.y + y) * (fullPanoSize.x * 3);
-      memcpy(out + destRow + croppedImagePos.x, mat.datastart + srcRow, croppedImageSize.x * 3);
+    // Drawn wherever the tiles haven't arrived yet
+    cv::Mat small = mat;
+    if (layout.cropWidth > 2048) {
+      uint32_t height = std::max(1u, layout.cropHeight * 2048 / layout.cropWidth);
+      cv::resize(mat, small, cv::Size(2048, height), 0, 0, cv::INTER_AREA);
     }
+    result->fallbackSize = uvec2(small.cols, small.rows);
+    result->fallback.resize(small.cols * small.rows * 4);
+    oria::pixels::bgrToRgba(small.data, small.step, &result->fallback[0], small.cols * 4, small.cols, small.rows);
+    return result;
   }
 
   static bool parseExifData(const std::string & exifData, glm::uvec2 &fullPanoSize, glm::uvec2 &croppedImageSize, glm::uvec2 &croppedImagePos) {
@@ -57,9 +57,13 @@ public:
 
   void captureLoop() {
     CaptureData captured;
+    cv::Mat raw;
     while (!stopped) {
-      videoCapture.read(captured.image);
-      cv::flip(captured.image.clone(), captured.image, 0);
+      videoCapture.read(raw);
+      // Flip and expand to RGBA in one pass, so the upload needs no swizzle
+      captured.image.create(raw.rows, raw.cols, CV_8UC4);
+      oria::pixels::bgrToRgba(raw.data, raw.step, captured.image.data, captured.image.step,
+        raw.cols, raw.rows, true);
       set(captured);
     }
   }
@@ -102,7 +106,7 @@ public:
       Context::Bound(TextureTarget::_2D, *texture)
         .Image2D(0, PixelDataInternalFormat::RGBA8, 
           captureData.image.cols, captureData.image.rows, 0, 
-          PixelDataFormat::BGR, PixelDataType::UnsignedByte, 
+          PixelDataFormat::RGBA, PixelDataType::UnsignedByte, 
           captureData.image.data);
     }
   }
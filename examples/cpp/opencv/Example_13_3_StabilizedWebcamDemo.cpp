@@ -6,70 +6,78 @@
 
 struct CaptureData {
   ovrPosef pose;
-  cv::Mat image;
 };
 
 class WebcamHandler {
 
 private:
 
-  bool hasFrame{ false };
   bool stopped{ false };
   cv::VideoCapture videoCapture;
   std::thread captureThread;
-  std::mutex mutex;
-  CaptureData frame;
   ovrHmd hmd;
+  StreamingTexture * target{ nullptr };
+  // The pose each frame was captured at, indexed by the texture slot 
+  // holding the frame
+  std::vector<CaptureData> slotData;
 
 public:
 
   WebcamHandler(ovrHmd & hmd) : hmd(hmd) {
   }
 
-  // Spawn capture thread and return webcam aspect ratio (width over height)
-  float startCapture() {
+  // Open the webcam and return the size of its frames
+  uvec2 open() {
+    cv::Mat first;
     videoCapture.open(1);
     if (!videoCapture.isOpened()
-      || !videoCapture.read(frame.image)) {
+      || !videoCapture.read(first)) {
       FAIL("Could not open video source to capture first frame");
     }
-    float aspectRatio = (float)frame.image.cols / (float)frame.image.rows;
+    return uvec2(first.cols, first.rows);
+  }
+
+  void startCapture(StreamingTexture * newTarget, int slots) {
+    target = newTarget;
+    slotData.resize(slots);
     captureThread = std::thread(&WebcamHandler::captureLoop, this);
-    return aspectRatio;
   }
 
   void stopCapture() {
     stopped = true;
-    captureThread.join();
+    if (captureThread.joinable()) {
+      captureThread.join();
+    }
     videoCapture.release();
   }
 
-  void set(const CaptureData & newFrame) {
-    std::lock_guard<std::mutex> guard(mutex);
-    frame = newFrame;
-    hasFrame = true;
-  }
-
-  bool get(CaptureData & out) {
-    if (!hasFrame) {
-      return false;
-    }
-    std::lock_guard<std::mutex> guard(mutex);
-    out = frame;
-    hasFrame = false;
-    return true;
+  const CaptureData & getSlotData(int slot) const {
+    return slotData[slot];
   }
 
   void captureLoop() {
-    CaptureData captured;
+    cv::Mat raw;
     while (!stopped) {
       float captureTime = ovr_GetTimeInSeconds();
       ovrTrackingState tracking = ovrHmd_GetTrackingState(hmd, captureTime);
-      captured.pose = tracking.HeadPose.ThePose;
 
-      videoCapture.read(captured.image);
-      cv::flip(captured.image.clone(), captured.image, 0);
-      set(captured);
+      if (!videoCapture.read(raw) || raw.empty()) {
+        continue;
+      }
+      // If the render thread still holds every slot, or the camera has
+      // changed resolution and the texture has yet to follow, drop the
+      // frame
+      int slot = target->acquire(uvec2(raw.cols, raw.rows));
+      if (-1 == slot) {
+        continue;
+      }
+      // Flip and expand to RGBA in one pass, straight into the texture's 
+      // staging memory
+      oria::pixels::bgrToRgba(raw.data, raw.step, 
+        target->getPixels(slot), target->getStride(),
+        raw.cols, raw.rows, true);
+      slotData[slot].pose = tracking.HeadPose.ThePose;
+      target->publish(slot);
     }
   }
 };
@@ -78,7 +86,8 @@ class WebcamApp : public RiftApp {
 
 protected:
 
-  TexturePtr texture;
+  StreamingTexturePtr texture;
+  uvec2 frameSize;
   ProgramPtr program;
   ShapeWrapperPtr videoGeometry;
   WebcamHandler captureHandler;
@@ -95,24 +104,23 @@ public:
 
   void initGl() {
     RiftApp::initGl();
-    using namespace oglplus;
-    texture = TexturePtr(new Texture());
-    Context::Bound(TextureTarget::_2D, *texture)
-      .MagFilter(TextureMagFilter::Linear)
-      .MinFilter(TextureMinFilter::Linear);
+    static const int SLOTS = 3;
     program = oria::loadProgram(Resource::SHADERS_TEXTURED_VS, Resource::SHADERS_TEXTURED_FS);
-    float aspectRatio = captureHandler.startCapture();
-    videoGeometry = oria::loadPlane(program, aspectRatio);
+    frameSize = captureHandler.open();
+    texture = StreamingTexturePtr(new StreamingTexture(frameSize, SLOTS));
+    captureHandler.startCapture(texture.get(), SLOTS);
+    videoGeometry = oria::loadPlane(program, (float)frameSize.x / (float)frameSize.y);
   }
 
   virtual void update() {
-    if (captureHandler.get(captureData)) {
-      using namespace oglplus;
-      Context::Bound(TextureTarget::_2D, *texture)
-        .Image2D(0, PixelDataInternalFormat::RGBA8,
-        captureData.image.cols, captureData.image.rows, 0,
-        PixelDataFormat::BGR, PixelDataType::UnsignedByte,
-        captureData.image.data);
+    int slot = texture->update();
+    if (-1 != slot) {
+      captureData = captureHandler.getSlotData(slot);
+    }
+    // The texture follows the camera if it changes resolution
+    if (texture->getSize() != frameSize) {
+      frameSize = texture->getSize();
+      videoGeometry = oria::loadPlane(program, (float)frameSize.x / (float)frameSize.y);
     }
   }
 
@@ -131,7 +139,7 @@ public:
 
       mv.translate(glm::vec3(0, 0, -2));
       using namespace oglplus;
-      texture->Bind(TextureTarget::_2D);
+      texture->getTexture()->Bind(TextureTarget::_2D);
       oria::renderGeometry(videoGeometry, program);
       oglplus::DefaultTexture().Bind(TextureTarget::_2D);
     });
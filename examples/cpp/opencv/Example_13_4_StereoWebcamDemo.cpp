@@ -8,79 +8,87 @@ int CAMERA_FOR_EYE[2] = { 2, 1 };
 
 struct CaptureData {
   ovrPosef pose;
-  cv::Mat image;
 };
 
 class WebcamHandler {
 
 private:
 
-  bool hasFrame{ false };
   bool stopped{ false };
   cv::VideoCapture videoCapture;
   std::thread captureThread;
-  std::mutex mutex;
-  CaptureData frame;
   ovrHmd hmd;
+  StreamingTexture * target{ nullptr };
+  // The pose each frame was captured at, indexed by the texture slot 
+  // holding the frame
+  std::vector<CaptureData> slotData;
 
 public:
 
   WebcamHandler() {
   }
 
-  // Spawn capture thread and return webcam aspect ratio (width over height)
-  float startCapture(ovrHmd & hmdRef, int which) {
+  // Open the webcam and return the size of its frames
+  uvec2 open(ovrHmd & hmdRef, int which) {
     hmd = hmdRef;
     videoCapture.open(which);
     if (!videoCapture.isOpened()) {
       FAIL("Could not open video source from webcam %i", which);
     }
-    for (int i = 0; i < 10 && !videoCapture.read(frame.image); i++) {
+    cv::Mat first;
+    for (int i = 0; i < 10 && !videoCapture.read(first); i++) {
       Platform::sleepMillis(10);
     }
-    if (!videoCapture.read(frame.image)) {
+    if (!videoCapture.read(first)) {
       FAIL("Could not open get first frame from webcam %i", which);
     }
-    float aspectRatio = (float)frame.image.cols / (float)frame.image.rows;
+    return uvec2(first.cols, first.rows);
+  }
+
+  void startCapture(StreamingTexture * newTarget, int slots) {
+    target = newTarget;
+    slotData.resize(slots);
     captureThread = std::thread(&WebcamHandler::captureLoop, this);
 
     // Snooze for 200 ms to get past multithreading issues in OpenCV
     Platform::sleepMillis(200);
-    return aspectRatio;
   }
 
   void stopCapture() {
     stopped = true;
-    captureThread.join();
+    if (captureThread.joinable()) {
+      captureThread.join();
+    }
     videoCapture.release();
   }
 
-  void set(const CaptureData & newFrame) {
-    std::lock_guard<std::mutex> guard(mutex);
-    frame = newFrame;
-    hasFrame = true;
-  }
-
-  bool get(CaptureData & out) {
-    if (!hasFrame) {
-      return false;
-    }
-    std::lock_guard<std::mutex> guard(mutex);
-    out = frame;
-    hasFrame = false;
-    return true;
+  const CaptureData & getSlotData(int slot) const {
+    return slotData[slot];
   }
 
   void captureLoop() {
-    CaptureData captured;
+    cv::Mat raw;
     while (!stopped) {
       float captureTime = ovr_GetTimeInSeconds();
       ovrTrackingState tracking = ovrHmd_GetTrackingState(hmd, captureTime);
-      captured.pose = tracking.HeadPose.ThePose;
 
-      videoCapture.read(captured.image);
-      cv::flip(captured.image.clone(), captured.image, 0);
-      set(captured);
+      if (!videoCapture.read(raw) || raw.empty()) {
+        continue;
+      }
+      // If the render thread still holds every slot, or the camera has
+      // changed resolution and the texture has yet to follow, drop the
+      // frame
+      int slot = target->acquire(uvec2(raw.cols, raw.rows));
+      if (-1 == slot) {
+        continue;
+      }
+      // Flip and expand to RGBA in one pass, straight into the texture's 
+      // staging memory
+      oria::pixels::bgrToRgba(raw.data, raw.step, 
+        target->getPixels(slot), target->getStride(),
+        raw.cols, raw.rows, true);
+      slotData[slot].pose = tracking.HeadPose.ThePose;
+      target->publish(slot);
     }
   }
 };
@@ -90,7 +98,8 @@ class WebcamApp : public RiftApp {
 protected:
 
   ProgramPtr program;
-  TexturePtr texture[2];
+  StreamingTexturePtr texture[2];
+  uvec2 frameSize[2];
   ShapeWrapperPtr videoGeometry[2];
   WebcamHandler captureHandler[2];
   CaptureData captureData[2];
@@ -112,26 +121,25 @@ public:
 
     program = oria::loadProgram(Resource::SHADERS_TEXTURED_VS, Resource::SHADERS_TEXTURED_FS);
 
+    static const int SLOTS = 3;
     for (int i = 0; i < 2; i++) {
-      texture[i] = TexturePtr(new Texture());
-      Context::Bound(TextureTarget::_2D, *texture[i])
-        .MagFilter(TextureMagFilter::Linear)
-        .MinFilter(TextureMinFilter::Linear);
-      program = oria::loadProgram(Resource::SHADERS_TEXTURED_VS, Resource::SHADERS_TEXTURED_FS);
-      float aspect = captureHandler[i].startCapture(hmd, CAMERA_FOR_EYE[i]);
-      videoGeometry[i] = oria::loadPlane(program, aspect);
+      frameSize[i] = captureHandler[i].open(hmd, CAMERA_FOR_EYE[i]);
+      texture[i] = StreamingTexturePtr(new StreamingTexture(frameSize[i], SLOTS));
+      captureHandler[i].startCapture(texture[i].get(), SLOTS);
+      videoGeometry[i] = oria::loadPlane(program, (float)frameSize[i].x / (float)frameSize[i].y);
     }
   }
 
   virtual void update() {
     for (int i = 0; i < 2; i++) {
-      if (captureHandler[i].get(captureData[i])) {
-        using namespace oglplus;
-        Context::Bound(TextureTarget::_2D, *texture[i])
-          .Image2D(0, PixelDataInternalFormat::RGBA8,
-          captureData[i].image.cols, captureData[i].image.rows, 0,
-          PixelDataFormat::BGR, PixelDataType::UnsignedByte,
-          captureData[i].image.data);
+      int slot = texture[i]->update();
+      if (-1 != slot) {
+        captureData[i] = captureHandler[i].getSlotData(slot);
+      }
+      // The texture follows the camera if it changes resolution
+      if (texture[i]->getSize() != frameSize[i]) {
+        frameSize[i] = texture[i]->getSize();
+        videoGeometry[i] = oria::loadPlane(program, (float)frameSize[i].x / (float)frameSize[i].y);
       }
     }
   }
@@ -151,7 +159,7 @@ public:
       mv.preMultiply(webcamDelta);
 
       mv.translate(glm::vec3(0, 0, -2.75));
-      texture[getCurrentEye()]->Bind(TextureTarget::_2D); 
+      texture[getCurrentEye()]->getTexture()->Bind(TextureTarget::_2D);
       oria::renderGeometry(videoGeometry[getCurrentEye()], program);
     });
     oglplus::DefaultTexture().Bind(TextureTarget::_2D);
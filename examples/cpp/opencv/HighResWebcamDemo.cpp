@@ -15,36 +15,36 @@
 #define CAMERA_HALF_FOV (CAMERA_HFOV_DEGREES / 2.0f) * DEGREES_TO_RADIANS
 #define CAMERA_SCALE (tan(CAMERA_HALF_FOV) * IMAGE_DISTANCE)
 
-template <class T>
+struct CaptureData {
+  ovrPosef pose;
+};
+
+// Runs a capture loop on its own thread, writing each frame straight into 
+// the staging memory of a streaming texture
 class CaptureHandler {
 private:
-  typedef std::lock_guard<std::mutex> lock_guard;
-
   std::thread captureThread;
-  std::mutex mutex;
 
-  bool changed{ false };
   bool stop{ false };
 
   float firstCapture{ -1 };
   int captures{ -1 };
   float cps{ -1 };
 
-  T result;
-
 protected:
+  StreamingTexture * target{ nullptr };
+  // The pose each frame was captured at, indexed by the texture slot 
+  // holding the frame
+  std::vector<CaptureData> slotData;
 
   bool isStopped() {
     return stop;
   }
 
-  void setResult(const T & newResult) {
+  void countCapture() {
     if (0 == ++captures) {
       firstCapture = Platform::elapsedSeconds();
     }
-    lock_guard guard(mutex);
-    result = newResult;
-    changed = true;
   }
 
 public:
@@ -65,36 +65,28 @@ public:
     return (float)captures / elapsed;
   }
 
-  void startCapture() {
+  void startCapture(StreamingTexture * newTarget, int slots) {
+    target = newTarget;
+    slotData.resize(slots);
     stop = false;
     captureThread = std::thread(&CaptureHandler::captureLoop, this);
   }
 
   void stopCapture() {
     stop = true;
-    captureThread.join();
+    if (captureThread.joinable()) {
+      captureThread.join();
+    }
   }
 
-  bool getResult(T & outResult) {
-    if (!changed) {
-      return false;
-    }
-    lock_guard guard(mutex);
-    changed = false;
-    outResult = result;
-    result = T();
-    return true;
+  const CaptureData & getSlotData(int slot) const {
+    return slotData[slot];
   }
 
   virtual void captureLoop() = 0;
 };
 
-struct CaptureData {
-  ovrPosef pose;
-  cv::Mat image;
-};
-
-class WebcamCaptureHandler : public CaptureHandler<CaptureData> {
+class WebcamCaptureHandler : public CaptureHandler {
 private:
   cv::VideoCapture videoCapture;
   ovrHmd hmd;
@@ -133,26 +125,52 @@ public:
     videoCapture.set(CV_CAP_PROP_FPS, 60);
   }
   
+  // The size of the frames the capture loop produces.  Remapped frames
+  // take the size of the distortion map, whatever the camera delivers.
+  uvec2 getFrameSize() {
+    if (hasCalibration) {
+      return uvec2(distortionMap.cols, distortionMap.rows);
+    }
+    cv::Mat first;
+    if (!videoCapture.read(first) || first.empty()) {
+      FAIL("Could not get the first frame from the webcam");
+    }
+    return uvec2(first.cols, first.rows);
+  }
+
   virtual void captureLoop() {
+    cv::Mat raw;
+    cv::Mat undistorted;
     while (!isStopped()) {
-      CaptureData captured;
       float captureTime = 
         ovr_GetTimeInSeconds() - CAMERA_LATENCY;
       ovrTrackingState tracking = 
         ovrHmd_GetTrackingState(hmd, captureTime);
-      captured.pose = tracking.HeadPose.ThePose;
 
       if (!videoCapture.grab() ||
-          !videoCapture.retrieve(captured.image)) {
+          !videoCapture.retrieve(raw)) {
         FAIL("Failed video capture");
       }
 
+      const cv::Mat * source = &raw;
       if (hasCalibration) {
-        remap(captured.image.clone(), captured.image, distortionMap, cv::Mat(), cv::INTER_LINEAR);
+        remap(raw, undistorted, distortionMap, cv::Mat(), cv::INTER_LINEAR);
+        source = &undistorted;
       }
-
-      cv::flip(captured.image.clone(), captured.image, 0);
-      setResult(captured);
+      // If the render thread still holds every slot, or the camera has
+      // changed resolution and the texture has yet to follow, drop the
+      // frame
+      int slot = target->acquire(uvec2(source->cols, source->rows));
+      if (-1 == slot) {
+        continue;
+      }
+      // Flip and expand to RGBA in one pass, so the upload needs no swizzle
+      oria::pixels::bgrToRgba(source->data, source->step, 
+        target->getPixels(slot), target->getStride(),
+        source->cols, source->rows, true);
+      slotData[slot].pose = tracking.HeadPose.ThePose;
+      target->publish(slot);
+      countCapture();
     }
   }
 };
@@ -163,14 +181,13 @@ protected:
   WebcamCaptureHandler captureHandler;
   CaptureData captureData;
 
-  TexturePtr texture;
+  StreamingTexturePtr texture;
   ShapeWrapperPtr videoGeometry;
   ProgramPtr videoRenderProgram;
 
 public:
 
   WebcamApp() : captureHandler(hmd) {
-    captureHandler.startCapture();
   }
 
   virtual ~WebcamApp() {
@@ -188,25 +205,17 @@ void initGl() {
     Resource::SHADERS_TEXTURED_VS,
     Resource::SHADERS_TEXTURED_FS);
 
-  using namespace oglplus;
-  texture = TexturePtr(new Texture());
-  Context::Bound(TextureTarget::_2D, *texture)
-    .MagFilter(TextureMagFilter::Linear)
-    .MinFilter(TextureMinFilter::Linear);
-  DefaultTexture().Bind(TextureTarget::_2D);
+  static const int SLOTS = 3;
+  texture = StreamingTexturePtr(new StreamingTexture(captureHandler.getFrameSize(), SLOTS));
+  captureHandler.startCapture(texture.get(), SLOTS);
 
   videoGeometry = oria::loadPlane(videoRenderProgram, CAMERA_ASPECT);
 }
 
 virtual void update() {
-  if (captureHandler.getResult(captureData)) {
-    using namespace oglplus;
-    Context::Bound(TextureTarget::_2D, *texture)
-      .Image2D(0, PixelDataInternalFormat::RGBA8,
-             captureData.image.cols, captureData.image.rows, 0,
-             PixelDataFormat::BGR, PixelDataType::UnsignedByte,
-             captureData.image.data);
-    DefaultTexture().Bind(TextureTarget::_2D);
+  int slot = texture->update();
+  if (-1 != slot) {
+    captureData = captureHandler.getSlotData(slot);
   }
 }
 
@@ -225,7 +234,7 @@ virtual void renderScene() {
     mv.preMultiply(webcamDelta);
     mv.translate(glm::vec3(0, 0, -IMAGE_DISTANCE));
 
-    texture->Bind(oglplus::Texture::Target::_2D);
+    texture->getTexture()->Bind(oglplus::Texture::Target::_2D);
     oria::renderGeometry(videoGeometry, videoRenderProgram);
     oglplus::DefaultTexture().Bind(oglplus::Texture::Target::_2D);
   });
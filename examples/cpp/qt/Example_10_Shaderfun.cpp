@@ -179,18 +179,9 @@ class ShadertoyRiftWidget : public QRiftWidget {
   typedef std::pair<GLuint, GLsync> SyncPair;
   typedef std::queue<SyncPair> TextureTrashcan;
 
-  struct TextureData {
-    TexturePtr tex;
-    uvec2 size;
-  };
-  typedef std::map<Resource, TextureData> TextureMap;
-
   // Contains the current 'camera position'
   vec3 position;
 
-  // A cache of all the input textures available 
-  TextureMap textureCache;
-
   // Geometry for the skybox used to render the scene
   ShapeWrapperPtr skybox;
   // A vertex shader shader, constant throughout the application lifetime
@@ -231,33 +222,9 @@ class ShadertoyRiftWidget : public QRiftWidget {
   // The current fragment source
   LambdaList uniformLambdas;
 
-  void initTextureCache() {
-    using namespace shadertoy;
-    for (int i = 0; i < MAX_TEXTURES; ++i) {
-      Resource res = TEXTURES[i];
-      if (NO_RESOURCE == res) {
-        continue;
-      }
-      TextureData & tex = textureCache[res];
-      tex.tex = oria::load2dTexture(res, tex.size);
-    }
-    for (int i = 0; i < MAX_CUBEMAPS; ++i) {
-      Resource res = CUBEMAPS[i];
-      if (NO_RESOURCE == res) {
-        continue;
-      }
-      TextureData & tex = textureCache[res];
-      static int resourceOrder[] = {
-        0, 1, 2, 3, 4, 5
-      };
-      tex.tex = oria::loadCubemapTexture(res, resourceOrder, false);
-    }
-  }
-
 protected:
   virtual void setup() {
     QRiftWidget::setup();
-    initTextureCache();
   }
 
 public:
@@ -550,15 +517,20 @@ protected:
     newChannel.resource = res;
     uvec2 size;
     switch (type) {
+    // Textures are loaded on first use and left to the TextureCache, which
+    // won't evict them while a channel holds them
     case shadertoy::ChannelInputType::TEXTURE:
-      newChannel.texture = textureCache[res].tex;
+      newChannel.texture = oria::load2dTexture(res, size, MIP_BOX);
       newChannel.target = Texture::Target::_2D;
-      newChannel.resolution = vec3(textureCache[res].size, 0);
+      newChannel.resolution = vec3(size, 0);
       break;
 
     case shadertoy::ChannelInputType::CUBEMAP:
     {
-      newChannel.texture = textureCache[res].tex;
+      static int resourceOrder[] = {
+        0, 1, 2, 3, 4, 5
+      };
+      newChannel.texture = oria::loadCubemapTexture(res, resourceOrder, false, MIP_BOX);
       newChannel.target = Texture::Target::CubeMap;
     }
     break;
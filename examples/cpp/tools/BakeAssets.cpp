@@ -0,0 +1,476 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+// Converts the example resources into the GPU ready form described in
+// BakedAsset.h, so that the runtime can skip decoding them.
+//
+// Usage: bake_assets [--mips=box|kaiser] [--textures=auto|rgba8|bc1|bc3|bc7]
+//                    [--vertices=compact|float] [--overdraw] [--lods=<count>]
+//                    <resource root> <manifest> <output root>
+//
+// The manifest lists one resource per line, relative to the resource root.
+// Every resource is written to the same relative path under the output
+// root.  PNG images, CTM and OBJ meshes and SDFF fonts are baked, anything
+// else is copied unchanged.
+//
+// Images get a full, gamma correct mip chain, Kaiser filtered by default,
+// and are block compressed: BC1 if they're opaque, otherwise BC3.  Font
+// atlases are left uncompressed, since the distance fields don't survive
+// block compression, and keep only the channels they use, as R8 or RG8.
+//
+// Meshes are simplified into up to four levels of detail, sharing one set
+// of vertices, then have their triangles and vertices reordered for the
+// vertex cache and vertex fetch, and the resulting cache efficiency is
+// printed.  --lods limits the levels, --lods=1 turns simplification off.  They're
+// stored as compact vertices (see BakedAsset::VertexFormat) unless the
+// positions don't fit in half floats or --vertices=float is given.
+// --overdraw also sorts the triangles to reduce overdraw, which breaks
+// meshes that rely on their draw order for blending.
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include "BakedAsset.h"
+#include "BlockCompression.h"
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MipChain.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+
+#ifdef HAVE_PNG
+#include <png.h>
+#endif
+
+#ifdef _WIN32
+#include <direct.h>
+#define MKDIR(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MKDIR(path) mkdir(path, 0755)
+#endif
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes readFile(const std::string & filename) {
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Failed to load file " + filename);
+  }
+  return Bytes(
+    (std::istreambuf_iterator<char>(in)),
+    std::istreambuf_iterator<char>());
+}
+
+static void makeParentDirectories(const std::string & filename) {
+  for (size_t slash = filename.find('/', 1); std::string::npos != slash; slash = filename.find('/', slash + 1)) {
+    MKDIR(filename.substr(0, slash).c_str());
+  }
+}
+
+static void writeFile(const std::string & filename, const Bytes & data) {
+  makeParentDirectories(filename);
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Unable to write " + filename);
+  }
+  if (!data.empty()) {
+    out.write((const char *)&data[0], data.size());
+  }
+}
+
+static bool endsWith(const std::string & str, const std::string & suffix) {
+  return str.size() >= suffix.size() &&
+    0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix);
+}
+
+static size_t align(size_t offset) {
+  const size_t mask = BakedAsset::DATA_ALIGNMENT - 1;
+  return (offset + mask) & ~mask;
+}
+
+template <typename T>
+static void append(Bytes & out, const T & value) {
+  const uint8_t * bytes = (const uint8_t *)&value;
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void appendHeader(Bytes & out, BakedAsset::Type type) {
+  BakedAsset::Header header;
+  memset(&header, 0, sizeof(header));
+  header.magic = BakedAsset::MAGIC;
+  header.version = BakedAsset::VERSION;
+  header.type = (uint16_t)type;
+  append(out, header);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Textures
+//
+
+struct Image {
+  uint32_t width{ 0 };
+  uint32_t height{ 0 };
+  // 1, 2 or 4.  Only RGBA8 images are block compressed.
+  uint32_t channels{ 4 };
+  // Bottom row first
+  Bytes pixels;
+};
+
+#ifdef HAVE_PNG
+static bool decodePng(const uint8_t * data, size_t size, Image & out) {
+  png_image image;
+  memset(&image, 0, sizeof(image));
+  image.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_memory(&image, data, size)) {
+    return false;
+  }
+  image.format = PNG_FORMAT_RGBA;
+  out.width = image.width;
+  out.height = image.height;
+  out.pixels.resize(PNG_IMAGE_SIZE(image));
+  // A negative stride writes the rows bottom up, which is what GL wants
+  int stride = -(int)PNG_IMAGE_ROW_STRIDE(image);
+  if (!png_image_finish_read(&image, nullptr, &out.pixels[0], stride, nullptr)) {
+    png_image_free(&image);
+    return false;
+  }
+  return true;
+}
+#endif
+
+// Chosen on the command line.  A texture format of zero means pick one
+// per image.
+static oria::MipFilter mipFilter = oria::MIP_KAISER;
+static uint32_t textureFormat = 0;
+
+static bool isOpaque(const Image & image) {
+  for (size_t i = 3; i < image.pixels.size(); i += 4) {
+    if (0xFF != image.pixels[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void compressLevel(Image & level, BakedAsset::TextureFormat format) {
+  oria::BlockFormat blockFormat =
+    BakedAsset::BC1 == format ? oria::BLOCK_BC1 :
+    BakedAsset::BC3 == format ? oria::BLOCK_BC3 : oria::BLOCK_BC7;
+  Bytes blocks(oria::compressedSize(blockFormat, level.width, level.height));
+  oria::compressBlocks(&level.pixels[0], level.width, level.height, level.width * 4,
+    blockFormat, &blocks[0], &ThreadPool::instance());
+  level.pixels.swap(blocks);
+}
+
+static Bytes bakeTexture(const Image & image, bool mipmaps, bool compress) {
+  std::vector<Image> levels(1, image);
+  if (mipmaps) {
+    oria::MipOptions options;
+    options.filter = mipFilter;
+    options.maxLevels = BakedAsset::MAX_LEVELS;
+    options.pool = &ThreadPool::instance();
+    std::vector<oria::MipLevel> chain = oria::buildMipChain(&image.pixels[0],
+      image.width, image.height, image.width * image.channels, image.channels, options);
+    for (size_t i = 0; i < chain.size(); ++i) {
+      Image level;
+      level.width = chain[i].width;
+      level.height = chain[i].height;
+      level.pixels.swap(chain[i].pixels);
+      levels.push_back(level);
+    }
+  }
+
+  BakedAsset::TextureFormat format =
+    1 == image.channels ? BakedAsset::R8 :
+    2 == image.channels ? BakedAsset::RG8 : BakedAsset::RGBA8;
+  if (compress && 4 == image.channels) {
+    format = textureFormat ? (BakedAsset::TextureFormat)textureFormat :
+      isOpaque(image) ? BakedAsset::BC1 : BakedAsset::BC3;
+  }
+  if (0 == BakedAsset::texelSize(format)) {
+    for (size_t i = 0; i < levels.size(); ++i) {
+      compressLevel(levels[i], format);
+    }
+  }
+
+  BakedAsset::TextureHeader header;
+  memset(&header, 0, sizeof(header));
+  header.format = format;
+  header.levelCount = (uint32_t)levels.size();
+  header.width = image.width;
+  header.height = image.height;
+  size_t offset = sizeof(BakedAsset::Header) + sizeof(header);
+  for (size_t i = 0; i < levels.size(); ++i) {
+    offset = align(offset);
+    header.levels[i].width = levels[i].width;
+    header.levels[i].height = levels[i].height;
+    header.levels[i].offset = offset;
+    header.levels[i].size = levels[i].pixels.size();
+    offset += levels[i].pixels.size();
+  }
+
+  Bytes result;
+  result.reserve(offset);
+  appendHeader(result, BakedAsset::TEXTURE);
+  append(result, header);
+  for (size_t i = 0; i < levels.size(); ++i) {
+    result.resize((size_t)header.levels[i].offset, 0);
+    result.insert(result.end(), levels[i].pixels.begin(), levels[i].pixels.end());
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Meshes
+//
+
+static oria::MeshOptimizeOptions meshOptions;
+static oria::LodOptions lodOptions;
+static uint32_t vertexFormat = BakedAsset::COMPACT_VERTICES;
+
+// The cache statistics are for the full detail level
+static void optimizeMesh(oria::MeshData & mesh, const std::string & path) {
+  size_t fullIndexCount = mesh.indices.size();
+  oria::VertexCacheStats before = oria::analyzeVertexCache(mesh.indices.data(), fullIndexCount, mesh.vertexCount());
+  oria::buildLods(mesh, lodOptions);
+  oria::optimizeMesh(mesh, meshOptions);
+  oria::VertexCacheStats after = oria::analyzeVertexCache(mesh.indices.data(), fullIndexCount, mesh.vertexCount());
+  std::cout << path << ": ACMR " << before.acmr << " -> " << after.acmr
+    << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+  for (size_t i = 1; i < mesh.lods.size(); ++i) {
+    std::cout << "  LOD " << i << ": " << mesh.lods[i].indexCount / 3 << " triangles, error "
+      << mesh.lods[i].error << std::endl;
+  }
+}
+
+static Bytes bakeMesh(const oria::MeshData & mesh) {
+  BakedAsset::MeshHeader header;
+  memset(&header, 0, sizeof(header));
+  header.attributes = mesh.attributes;
+  header.vertexFormat = vertexFormat;
+  Bytes vertices = oria::packVertices(mesh, header.vertexFormat);
+  Bytes indices = oria::packIndices(mesh, header.indexSize);
+  header.stride = BakedAsset::attributeByteOffset(header.vertexFormat, mesh.attributes, BakedAsset::MATERIAL << 1);
+  header.vertexCount = mesh.vertexCount();
+  header.indexCount = (uint32_t)mesh.indices.size();
+  if (mesh.lods.empty()) {
+    header.lodCount = 1;
+    header.lods[0].indexCount = header.indexCount;
+  } else {
+    header.lodCount = (uint32_t)mesh.lods.size();
+    std::copy(mesh.lods.begin(), mesh.lods.end(), header.lods);
+  }
+
+  mesh.bounds(header.boundsMin, header.boundsMax, header.sphere);
+
+  header.vertexOffset = align(sizeof(BakedAsset::Header) + sizeof(header));
+  header.indexOffset = align((size_t)header.vertexOffset + vertices.size());
+
+  Bytes result;
+  appendHeader(result, BakedAsset::MESH);
+  append(result, header);
+  result.resize((size_t)header.vertexOffset, 0);
+  result.insert(result.end(), vertices.begin(), vertices.end());
+  result.resize((size_t)header.indexOffset, 0);
+  result.insert(result.end(), indices.begin(), indices.end());
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Fonts
+//
+
+// Returns the offset of the atlas image that follows the SDFF glyph table
+static size_t sdffImageOffset(const Bytes & data) {
+  size_t cursor = 4;
+  uint16_t version, count;
+  if (data.size() < 6 || memcmp(&data[0], "SDFF", 4)) {
+    throw std::runtime_error("Bad font file");
+  }
+  memcpy(&version, &data[cursor], sizeof(version));
+  cursor += sizeof(version);
+  if (version > 0x0001) {
+    while (cursor < data.size() && data[cursor]) {
+      ++cursor;
+    }
+    ++cursor;
+  }
+  // leading, ascent, descent, space width
+  cursor += 4 * sizeof(float);
+  if (cursor + sizeof(count) > data.size()) {
+    throw std::runtime_error("Truncated font file");
+  }
+  memcpy(&count, &data[cursor], sizeof(count));
+  cursor += sizeof(count);
+  // charcode, then ul, size, offset and advance
+  cursor += count * (sizeof(uint16_t) + 7 * sizeof(float));
+  if (cursor > data.size()) {
+    throw std::runtime_error("Truncated font file");
+  }
+  return cursor;
+}
+
+// The distance is the same in every color channel, so only red is kept,
+// along with the alpha if it's used
+static void reduceDistanceField(Image & image) {
+  image.channels = isOpaque(image) ? 1 : 2;
+  size_t texels = image.width * image.height;
+  for (size_t i = 0; i < texels; ++i) {
+    image.pixels[i * image.channels] = image.pixels[i * 4];
+    if (2 == image.channels) {
+      image.pixels[i * 2 + 1] = image.pixels[i * 4 + 3];
+    }
+  }
+  image.pixels.resize(texels * image.channels);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static Bytes bake(const std::string & path, const std::string & filename) {
+  Bytes data = readFile(filename);
+  // Other files are copied as they are, which is fine when they're empty
+  bool decoded = endsWith(path, ".ctm") || endsWith(path, ".obj") ||
+    endsWith(path, ".png") || endsWith(path, ".sdff");
+  if (decoded && data.empty()) {
+    throw std::runtime_error("Empty file " + filename);
+  }
+  if (endsWith(path, ".ctm")) {
+    oria::MeshData mesh = oria::decodeCtm(data.data(), data.size());
+    optimizeMesh(mesh, path);
+    return bakeMesh(mesh);
+  }
+  if (endsWith(path, ".obj")) {
+    oria::MeshData mesh = oria::decodeObj(data.data(), data.size(), ~0u, &ThreadPool::instance());
+    optimizeMesh(mesh, path);
+    return bakeMesh(mesh);
+  }
+#ifdef HAVE_PNG
+  Image image;
+  if (endsWith(path, ".png")) {
+    if (!decodePng(data.data(), data.size(), image)) {
+      throw std::runtime_error("Failed to decode " + filename);
+    }
+    return bakeTexture(image, true, true);
+  }
+  if (endsWith(path, ".sdff")) {
+    size_t offset = sdffImageOffset(data);
+    if (!decodePng(&data[offset], data.size() - offset, image)) {
+      throw std::runtime_error("Failed to decode the atlas in " + filename);
+    }
+    reduceDistanceField(image);
+    Bytes atlas = bakeTexture(image, false, false);
+    data.resize(offset);
+    data.insert(data.end(), atlas.begin(), atlas.end());
+    return data;
+  }
+#endif
+  return data;
+}
+
+static bool parseOption(const std::string & option) {
+  if (0 == option.compare(0, 7, "--mips=")) {
+    std::string filter = option.substr(7);
+    if ("box" == filter) {
+      mipFilter = oria::MIP_BOX;
+      return true;
+    }
+    return "kaiser" == filter;
+  }
+  if (0 == option.compare(0, 11, "--vertices=")) {
+    std::string format = option.substr(11);
+    if ("float" == format) {
+      vertexFormat = BakedAsset::FLOAT_VERTICES;
+      return true;
+    }
+    return "compact" == format;
+  }
+  if ("--overdraw" == option) {
+    meshOptions.overdraw = true;
+    return true;
+  }
+  if (0 == option.compare(0, 7, "--lods=")) {
+    lodOptions.maxLods = (uint32_t)atoi(option.c_str() + 7);
+    return lodOptions.maxLods >= 1 && lodOptions.maxLods <= BakedAsset::MAX_LODS;
+  }
+  if (0 == option.compare(0, 11, "--textures=")) {
+    static const char * FORMATS[] = { "auto", "rgba8", "bc1", "bc3", "bc7" };
+    for (uint32_t i = 0; i < 5; ++i) {
+      if (option.substr(11) == FORMATS[i]) {
+        // The names after auto are in the order of BakedAsset::TextureFormat
+        textureFormat = i;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+int main(int argc, char ** argv) {
+  while (argc > 1 && 0 == std::string(argv[1]).compare(0, 2, "--")) {
+    if (!parseOption(argv[1])) {
+      std::cerr << "Unknown option " << argv[1] << std::endl;
+      return -1;
+    }
+    --argc;
+    ++argv;
+  }
+  if (argc != 4) {
+    std::cerr << "Usage: " << argv[0] << " [--mips=box|kaiser] [--textures=auto|rgba8|bc1|bc3|bc7] "
+      "[--vertices=compact|float] [--overdraw] [--lods=<count>] "
+      "<resource root> <manifest> <output root>" << std::endl;
+    return -1;
+  }
+
+  try {
+    std::string root(argv[1]);
+    std::string outputRoot(argv[3]);
+    std::vector<std::string> paths;
+    std::ifstream manifest(argv[2]);
+    std::string line;
+    while (std::getline(manifest, line)) {
+      if (!line.empty() && '\r' == *line.rbegin()) {
+        line.resize(line.size() - 1);
+      }
+      if (!line.empty()) {
+        paths.push_back(line);
+      }
+    }
+
+    // Shared with the mip chain builder, which splits up large images
+    ThreadPool & pool = ThreadPool::instance();
+    pool.parallelFor(paths.size(), [&](size_t i) {
+      std::string lower = paths[i];
+      std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+      writeFile(outputRoot + "/" + paths[i], bake(lower, root + "/" + paths[i]));
+    });
+    std::cout << "Baked " << paths.size() << " resources into " << outputRoot << std::endl;
+  } catch (std::exception & error) {
+    std::cerr << error.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,135 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+// Converts an equirectangular panorama into the six faces of a cubemap.
+//
+// Usage: equirect_to_cubemap [--filter=bilinear|bicubic] [--size=<face size>]
+//                            [--full=<width>x<height>+<left>+<top>]
+//                            <panorama.png> <output prefix>
+//
+// The faces are written as <prefix>_xpos.png, <prefix>_xneg.png and so on,
+// oriented the way GL samples them.  --full places a cropped panorama on
+// the sphere, as the GPano full size and cropped area fields do; without
+// it the image is taken to cover the whole sphere.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "EquirectCubemap.h"
+#include "ThreadPool.h"
+
+#include <png.h>
+
+static const char * FACE_NAMES[] = { "xpos", "xneg", "ypos", "yneg", "zpos", "zneg" };
+
+static oria::CubemapOptions options;
+static oria::PanoramaLayout layout;
+static bool cropped = false;
+
+static bool parseOption(const std::string & option) {
+  if (0 == option.compare(0, 9, "--filter=")) {
+    std::string filter = option.substr(9);
+    if ("bicubic" == filter) {
+      options.filter = oria::CUBEMAP_BICUBIC;
+      return true;
+    }
+    return "bilinear" == filter;
+  }
+  if (0 == option.compare(0, 7, "--size=")) {
+    options.faceSize = (uint32_t)atoi(option.c_str() + 7);
+    return options.faceSize > 0;
+  }
+  if (0 == option.compare(0, 7, "--full=")) {
+    cropped = true;
+    return 4 == sscanf(option.c_str() + 7, "%ux%u+%u+%u",
+      &layout.fullWidth, &layout.fullHeight, &layout.cropX, &layout.cropY);
+  }
+  return false;
+}
+
+int main(int argc, char ** argv) {
+  while (argc > 1 && 0 == std::string(argv[1]).compare(0, 2, "--")) {
+    if (!parseOption(argv[1])) {
+      std::cerr << "Unknown option " << argv[1] << std::endl;
+      return -1;
+    }
+    --argc;
+    ++argv;
+  }
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " [--filter=bilinear|bicubic] [--size=<face size>] "
+      "[--full=<width>x<height>+<left>+<top>] <panorama.png> <output prefix>" << std::endl;
+    return -1;
+  }
+
+  png_image image;
+  memset(&image, 0, sizeof(image));
+  image.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_file(&image, argv[1])) {
+    std::cerr << "Failed to read " << argv[1] << ": " << image.message << std::endl;
+    return -1;
+  }
+  image.format = PNG_FORMAT_RGBA;
+  std::vector<uint8_t> pixels(PNG_IMAGE_SIZE(image));
+  if (!png_image_finish_read(&image, nullptr, &pixels[0], 0, nullptr)) {
+    std::cerr << "Failed to decode " << argv[1] << ": " << image.message << std::endl;
+    return -1;
+  }
+
+  layout.cropWidth = image.width;
+  layout.cropHeight = image.height;
+  if (!cropped) {
+    layout.fullWidth = image.width;
+    layout.fullHeight = image.height;
+  } else if (layout.cropX + layout.cropWidth > layout.fullWidth ||
+      layout.cropY + layout.cropHeight > layout.fullHeight) {
+    std::cerr << "The image doesn't fit the full panorama" << std::endl;
+    return -1;
+  }
+
+  try {
+    options.pool = &ThreadPool::instance();
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<oria::MipLevel> faces = oria::equirectToCubemap(&pixels[0], image.width * 4, 4, layout, options);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::high_resolution_clock::now() - start);
+    std::cout << "Converted to " << faces[0].width << " texel faces in " << elapsed.count() << " ms" << std::endl;
+
+    for (int i = 0; i < 6; ++i) {
+      png_image face;
+      memset(&face, 0, sizeof(face));
+      face.version = PNG_IMAGE_VERSION;
+      face.width = faces[i].width;
+      face.height = faces[i].height;
+      face.format = PNG_FORMAT_RGBA;
+      std::string filename = std::string(argv[2]) + "_" + FACE_NAMES[i] + ".png";
+      if (!png_image_write_to_file(&face, filename.c_str(), 0, &faces[i].pixels[0], 0, nullptr)) {
+        throw std::runtime_error("Unable to write " + filename + ": " + face.message);
+      }
+    }
+  } catch (std::exception & error) {
+    std::cerr << error.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
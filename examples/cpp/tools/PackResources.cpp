@@ -0,0 +1,175 @@
+/************************************************************************************
+
+ Authors     :   Bradley Austin Davis <bdavis@saintandreas.org>
+ Copyright   :   Copyright Brad Davis. All Rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ************************************************************************************/
+
+// Builds the resource pack that Platform::getResourceView() maps at runtime.
+//
+// Usage: pack_resources [--compress] <resource root> <manifest> <output file>
+//
+// The manifest lists one resource per line, relative to the resource root.
+// With --compress, entries that shrink usefully are stored deflated.
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include "ResourcePack.h"
+#include "ThreadPool.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+struct PackedFile {
+  std::string path;
+  std::vector<char> data;
+  ResourcePack::Entry entry;
+};
+
+#ifdef HAVE_ZLIB
+// Replaces the file contents with a deflated copy, unless that doesn't 
+// save at least an eighth of the size (PNGs and JPGs typically won't)
+static void compress(PackedFile & file) {
+  if (file.data.size() < ResourcePack::MIN_COMPRESSED_SIZE) {
+    return;
+  }
+  uLongf compressedSize = compressBound((uLong)file.data.size());
+  std::vector<char> compressed(compressedSize);
+  int result = compress2((Bytef *)&compressed[0], &compressedSize,
+    (const Bytef *)&file.data[0], (uLong)file.data.size(), Z_BEST_COMPRESSION);
+  if (Z_OK != result) {
+    throw std::runtime_error("Failed to compress " + file.path);
+  }
+  if (compressedSize > file.data.size() - file.data.size() / 8) {
+    return;
+  }
+  compressed.resize(compressedSize);
+  file.data.swap(compressed);
+  file.entry.flags |= ResourcePack::COMPRESSED;
+}
+#endif
+
+static std::vector<char> readFile(const std::string & filename) {
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Failed to load file " + filename);
+  }
+  return std::vector<char>(
+    (std::istreambuf_iterator<char>(in)),
+    std::istreambuf_iterator<char>());
+}
+
+static uint64_t align(uint64_t offset) {
+  const uint64_t mask = ResourcePack::DATA_ALIGNMENT - 1;
+  return (offset + mask) & ~mask;
+}
+
+int main(int argc, char ** argv) {
+  bool compressEntries = false;
+  if (argc > 1 && std::string("--compress") == argv[1]) {
+    compressEntries = true;
+    --argc;
+    ++argv;
+  }
+  if (argc != 4) {
+    std::cerr << "Usage: " << argv[0] << " [--compress] <resource root> <manifest> <output>" << std::endl;
+    return -1;
+  }
+#ifndef HAVE_ZLIB
+  if (compressEntries) {
+    std::cerr << "Compression requested, but zlib support wasn't built" << std::endl;
+    return -1;
+  }
+#endif
+
+  try {
+    std::string root(argv[1]);
+    std::vector<PackedFile> files;
+    std::ifstream manifest(argv[2]);
+    std::string line;
+    while (std::getline(manifest, line)) {
+      if (!line.empty() && '\r' == *line.rbegin()) {
+        line.resize(line.size() - 1);
+      }
+      if (line.empty()) {
+        continue;
+      }
+      PackedFile file;
+      file.path = line;
+      file.data = readFile(root + "/" + line);
+      memset(&file.entry, 0, sizeof(file.entry));
+      file.entry.size = file.data.size();
+      files.push_back(file);
+    }
+
+#ifdef HAVE_ZLIB
+    if (compressEntries) {
+      ThreadPool pool;
+      pool.parallelFor(files.size(), [&](size_t i) {
+        compress(files[i]);
+      });
+    }
+#endif
+
+    // Lay out the index first, since the data offsets depend on its size
+    uint64_t offset = sizeof(ResourcePack::Header);
+    for (size_t i = 0; i < files.size(); ++i) {
+      offset += sizeof(ResourcePack::Entry) + sizeof(uint32_t) + files[i].path.size();
+    }
+    for (size_t i = 0; i < files.size(); ++i) {
+      offset = align(offset);
+      files[i].entry.offset = offset;
+      files[i].entry.storedSize = files[i].data.size();
+      offset += files[i].data.size();
+    }
+
+    std::ofstream out(argv[3], std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw std::runtime_error(std::string("Unable to write ") + argv[3]);
+    }
+
+    ResourcePack::Header header;
+    header.magic = ResourcePack::MAGIC;
+    header.version = ResourcePack::VERSION;
+    header.count = (uint32_t)files.size();
+    header.reserved = 0;
+    out.write((const char *)&header, sizeof(header));
+
+    for (size_t i = 0; i < files.size(); ++i) {
+      uint32_t pathLength = (uint32_t)files[i].path.size();
+      out.write((const char *)&files[i].entry, sizeof(ResourcePack::Entry));
+      out.write((const char *)&pathLength, sizeof(pathLength));
+      out.write(files[i].path.data(), pathLength);
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+      static const char PADDING[ResourcePack::DATA_ALIGNMENT] = { 0 };
+      uint64_t position = (uint64_t)out.tellp();
+      out.write(PADDING, files[i].entry.offset - position);
+      if (!files[i].data.empty()) {
+        out.write(&files[i].data[0], files[i].data.size());
+      }
+    }
+    std::cout << "Packed " << files.size() << " resources into " << argv[3] << std::endl;
+  } catch (std::exception & error) {
+    std::cerr << error.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
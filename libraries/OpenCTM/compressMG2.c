@@ -30,6 +30,13 @@
 #include "openctm.h"
 #include "internal.h"
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #ifdef __DEBUG_
 #include <stdio.h>
 #endif
@@ -388,26 +395,50 @@ static void _ctmRestoreVertices(_CTMcontext * self, CTMint * aIntVertices,
   CTMuint * aGridIndices, _CTMgrid * aGrid, CTMfloat * aVertices)
 {
   CTMuint i, gridIdx, prevGridIndex;
-  CTMfloat gridOrigin[3], scale;
+  CTMfloat gridOrigin[4], scale;
   CTMint deltaX, prevDeltaX;
+#if defined(_CTM_SSE2)
+  __m128 origin, scale4, v;
+#endif
 
   scale = self->mVertexPrecision;
 
   prevGridIndex = 0x7fffffff;
   prevDeltaX = 0;
+  gridOrigin[3] = 0.0f;
+#if defined(_CTM_SSE2)
+  scale4 = _mm_set1_ps(scale);
+  origin = _mm_setzero_ps();
+#endif
   for(i = 0; i < self->mVertexCount; ++ i)
   {
-    // Get grid box origin
+    // Get grid box origin. The vertices are sorted by grid box, so it
+    // rarely changes from one vertex to the next.
     gridIdx = aGridIndices[i];
-    _ctmGridIdxToPoint(aGrid, gridIdx, gridOrigin);
+    if(gridIdx != prevGridIndex)
+    {
+      _ctmGridIdxToPoint(aGrid, gridIdx, gridOrigin);
+#if defined(_CTM_SSE2)
+      origin = _mm_loadu_ps(gridOrigin);
+#endif
+    }
 
     // Restore original point
     deltaX = aIntVertices[i * 3];
     if(gridIdx == prevGridIndex)
       deltaX += prevDeltaX;
+#if defined(_CTM_SSE2)
+    v = _mm_cvtepi32_ps(_mm_unpacklo_epi64(
+          _mm_unpacklo_epi32(_mm_cvtsi32_si128(deltaX), _mm_cvtsi32_si128(aIntVertices[i * 3 + 1])),
+          _mm_cvtsi32_si128(aIntVertices[i * 3 + 2])));
+    v = _mm_add_ps(_mm_mul_ps(scale4, v), origin);
+    _mm_storel_pi((__m64 *) &aVertices[i * 3], v);
+    _mm_store_ss(&aVertices[i * 3 + 2], _mm_movehl_ps(v, v));
+#else
     aVertices[i * 3] = scale * deltaX + gridOrigin[0];
     aVertices[i * 3 + 1] = scale * aIntVertices[i * 3 + 1] + gridOrigin[1];
     aVertices[i * 3 + 2] = scale * aIntVertices[i * 3 + 2] + gridOrigin[2];
+#endif
 
     prevGridIndex = gridIdx;
     prevDeltaX = deltaX;
@@ -607,29 +638,93 @@ static CTMint _ctmMakeNormalDeltas(_CTMcontext * self, CTMint * aIntNormals,
 }
 
 //-----------------------------------------------------------------------------
-// _ctmRestoreNormals() - Convert the normals back to cartesian coordinates.
+// _ctmRestoreNormals() - Convert the normals aFirst to aLast - 1 back to
+// cartesian coordinates, relative to the smooth (nominal) normals.
 //-----------------------------------------------------------------------------
-static CTMint _ctmRestoreNormals(_CTMcontext * self, CTMint * aIntNormals)
+static void _ctmRestoreNormals(_CTMcontext * self, CTMint * aIntNormals,
+  CTMfloat * aSmoothNormals, CTMuint aFirst, CTMuint aLast)
 {
   CTMuint i, j, intPhi;
   CTMfloat magn, phi, theta, scale, thetaScale;
-  CTMfloat * smoothNormals, n[3], n2[3], basisAxes[9];
+  CTMfloat n[3], n2[3], basisAxes[9];
+#if defined(_CTM_SSE2)
+  CTMfloat lanes[7][4];
+  CTMuint k, l;
+  __m128 x[3], y[3], z[3], len, mask, m2[3], r;
+  __m128d wide;
+#endif
 
-  // Allocate temporary memory for the nominal vertex normals
-  smoothNormals = (CTMfloat *) malloc(3 * sizeof(CTMfloat) * self->mVertexCount);
-  if(!smoothNormals)
+  // Normal scaling factor
+  scale = self->mNormalPrecision;
+
+  i = aFirst;
+#if defined(_CTM_SSE2)
+  // Four normals at a time. Only the trigonometry is left scalar, and the
+  // arithmetic is done in the same order and precision as in the scalar
+  // code, so the results are identical.
+  for(; i + 4 <= aLast; i += 4)
   {
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
+    for(l = 0; l < 4; ++ l)
+    {
+      k = i + l;
+      lanes[0][l] = aIntNormals[k * 3] * scale;
+      intPhi = aIntNormals[k * 3 + 1];
+      phi = intPhi * (0.5f * PI) * scale;
+      if(intPhi == 0)
+        thetaScale = 0.0f;
+      else if(intPhi <= 4)
+        thetaScale = PI / 2.0f;
+      else
+        thetaScale = (2.0f * PI) / ((CTMfloat) intPhi);
+      theta = aIntNormals[k * 3 + 2] * thetaScale - PI;
+      lanes[1][l] = sinf(phi) * cosf(theta);
+      lanes[2][l] = sinf(phi) * sinf(theta);
+      lanes[3][l] = cosf(phi);
+      for(j = 0; j < 3; ++ j)
+        lanes[4 + j][l] = aSmoothNormals[k * 3 + j];
+    }
+    for(j = 0; j < 3; ++ j)
+    {
+      m2[j] = _mm_loadu_ps(lanes[1 + j]);
+      z[j] = _mm_loadu_ps(lanes[4 + j]);
+    }
 
-  // Calculate smooth normals (nominal normals)
-  _ctmCalcSmoothNormals(self, self->mVertices, self->mIndices, smoothNormals);
+    // See _ctmMakeNormalCoordSys()
+    x[0] = _mm_xor_ps(z[1], _mm_set1_ps(-0.0f));
+    x[1] = _mm_sub_ps(z[0], z[2]);
+    x[2] = z[1];
+    // sqrtf(2.0 * x[0] * x[0] + x[1] * x[1]), with the double precision
+    // part done in doubles
+    r = _mm_mul_ps(x[1], x[1]);
+    wide = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(_mm_set1_pd(2.0), _mm_cvtps_pd(x[0])), _mm_cvtps_pd(x[0])),
+                      _mm_cvtps_pd(r));
+    len = _mm_cvtpd_ps(wide);
+    wide = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(_mm_set1_pd(2.0), _mm_cvtps_pd(_mm_movehl_ps(x[0], x[0]))),
+                                 _mm_cvtps_pd(_mm_movehl_ps(x[0], x[0]))),
+                      _mm_cvtps_pd(_mm_movehl_ps(r, r)));
+    len = _mm_sqrt_ps(_mm_movelh_ps(len, _mm_cvtpd_ps(wide)));
+    mask = _mm_cmpgt_ps(len, _mm_set1_ps(1.0e-20f));
+    len = _mm_div_ps(_mm_set1_ps(1.0f), len);
+    for(j = 0; j < 3; ++ j)
+      x[j] = _mm_or_ps(_mm_and_ps(mask, _mm_mul_ps(x[j], len)), _mm_andnot_ps(mask, x[j]));
+    y[0] = _mm_sub_ps(_mm_mul_ps(z[1], x[2]), _mm_mul_ps(z[2], x[1]));
+    y[1] = _mm_sub_ps(_mm_mul_ps(z[2], x[0]), _mm_mul_ps(z[0], x[2]));
+    y[2] = _mm_sub_ps(_mm_mul_ps(z[0], x[1]), _mm_mul_ps(z[1], x[0]));
 
-  // Normal scaling factor
-  scale = self->mNormalPrecision;
+    // Rotate into place and apply the normal magnitude
+    for(j = 0; j < 3; ++ j)
+    {
+      r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x[j], m2[0]), _mm_mul_ps(y[j], m2[1])),
+                     _mm_mul_ps(z[j], m2[2]));
+      _mm_storeu_ps(lanes[4 + j], _mm_mul_ps(r, _mm_loadu_ps(lanes[0])));
+    }
+    for(l = 0; l < 4; ++ l)
+      for(j = 0; j < 3; ++ j)
+        self->mNormals[(i + l) * 3 + j] = lanes[4 + j][l];
+  }
+#endif
 
-  for(i = 0; i < self->mVertexCount; ++ i)
+  for(; i < aLast; ++ i)
   {
     // Get the normal magnitude from the first of the three normal elements
     magn = aIntNormals[i * 3] * scale;
@@ -650,7 +745,7 @@ static CTMint _ctmRestoreNormals(_CTMcontext * self, CTMint * aIntNormals)
     n2[0] = sinf(phi) * cosf(theta);
     n2[1] = sinf(phi) * sinf(theta);
     n2[2] = cosf(phi);
-    _ctmMakeNormalCoordSys(&smoothNormals[i * 3], basisAxes);
+    _ctmMakeNormalCoordSys(&aSmoothNormals[i * 3], basisAxes);
     for(j = 0; j < 3; ++ j)
       n[j] = basisAxes[j] * n2[0] +
              basisAxes[3 + j] * n2[1] +
@@ -660,11 +755,6 @@ static CTMint _ctmRestoreNormals(_CTMcontext * self, CTMint * aIntNormals)
     for(j = 0; j < 3; ++ j)
       self->mNormals[i * 3 + j] = n[j] * magn;
   }
-
-  // Free temporary resources
-  free(smoothNormals);
-
-  return CTM_TRUE;
 }
 
 //-----------------------------------------------------------------------------
@@ -712,12 +802,32 @@ static void _ctmRestoreUVCoords(_CTMcontext * self, _CTMfloatmap * aMap,
   CTMuint i;
   CTMint u, v, prevU, prevV;
   CTMfloat scale;
+#if defined(_CTM_SSE2)
+  __m128i pair, prev;
+  __m128 scale4;
+#endif
 
   // UV coordinate scaling factor
   scale = aMap->mPrecision;
 
   prevU = prevV = 0;
-  for(i = 0; i < self->mVertexCount; ++ i)
+  i = 0;
+#if defined(_CTM_SSE2)
+  // Two vertices (u, v, u, v) at a time
+  prev = _mm_setzero_si128();
+  scale4 = _mm_set1_ps(scale);
+  for(; i + 2 <= self->mVertexCount; i += 2)
+  {
+    pair = _mm_loadu_si128((const __m128i *) &aIntUVCoords[i * 2]);
+    pair = _mm_add_epi32(pair, _mm_slli_si128(pair, 8));
+    pair = _mm_add_epi32(pair, prev);
+    prev = _mm_shuffle_epi32(pair, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm_storeu_ps(&aMap->mValues[i * 2], _mm_mul_ps(_mm_cvtepi32_ps(pair), scale4));
+  }
+  prevU = _mm_cvtsi128_si32(prev);
+  prevV = _mm_cvtsi128_si32(_mm_srli_si128(prev, 4));
+#endif
+  for(; i < self->mVertexCount; ++ i)
   {
     // Calculate inverse delta
     u = aIntUVCoords[i * 2] + prevU;
@@ -775,13 +885,29 @@ static void _ctmMakeAttribDeltas(_CTMcontext * self, _CTMfloatmap * aMap,
 static void _ctmRestoreAttribs(_CTMcontext * self, _CTMfloatmap * aMap,
   CTMint * aIntAttribs)
 {
-  CTMuint i, j;
-  CTMint value[4], prev[4];
+  CTMuint i;
   CTMfloat scale;
+#if defined(_CTM_SSE2)
+  __m128i prev4;
+  __m128 scale4;
+#else
+  CTMuint j;
+  CTMint value[4], prev[4];
+#endif
 
   // Attribute scaling factor
   scale = aMap->mPrecision;
 
+#if defined(_CTM_SSE2)
+  // A whole vertex at a time
+  prev4 = _mm_setzero_si128();
+  scale4 = _mm_set1_ps(scale);
+  for(i = 0; i < self->mVertexCount; ++ i)
+  {
+    prev4 = _mm_add_epi32(prev4, _mm_loadu_si128((const __m128i *) &aIntAttribs[i * 4]));
+    _mm_storeu_ps(&aMap->mValues[i * 4], _mm_mul_ps(_mm_cvtepi32_ps(prev4), scale4));
+  }
+#else
   for(j = 0; j < 4; ++ j)
     prev[j] = 0;
 
@@ -795,6 +921,7 @@ static void _ctmRestoreAttribs(_CTMcontext * self, _CTMfloatmap * aMap,
       prev[j] = value[j];
     }
   }
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -1077,14 +1204,265 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
   return CTM_TRUE;
 }
 
+//-----------------------------------------------------------------------------
+// Parallel decoding. Once the packed arrays have been read from the stream,
+// unpacking and restoring them are independent of each other (except for
+// the normals, which are predicted from the vertices and indices), so they
+// are run as separate jobs.
+//-----------------------------------------------------------------------------
+
+// Meshes with fewer vertices than this are not worth starting threads for.
+#define _CTM_PARALLEL_VERTEX_COUNT 16384
+
+typedef struct _CTMjob_struct _CTMjob;
+struct _CTMjob_struct {
+  // The work to do. Returns CTM_NONE or an error code.
+  CTMenum (*mRun)(_CTMjob * aJob);
+
+  _CTMcontext * mContext;
+  _CTMgrid * mGrid;
+  _CTMscratch * mScratch[2];
+  _CTMfloatmap * mMap;
+  CTMint * mIntData;
+  CTMfloat * mSmoothNormals;
+  CTMuint mFirst, mLast;
+
+  CTMenum mError;
+#if defined(_WIN32)
+  HANDLE mThread;
+#else
+  pthread_t mThread;
+  int mStarted;
+#endif
+};
+
+//-----------------------------------------------------------------------------
+// _ctmProcessorCount() - The number of processors available to run jobs on.
+//-----------------------------------------------------------------------------
+static CTMuint _ctmProcessorCount(void)
+{
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (CTMuint) info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (CTMuint) count : 1;
+#else
+  return 1;
+#endif
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI _ctmJobThread(LPVOID aArg)
+{
+  _CTMjob * job = (_CTMjob *) aArg;
+  job->mError = job->mRun(job);
+  return 0;
+}
+#else
+static void * _ctmJobThread(void * aArg)
+{
+  _CTMjob * job = (_CTMjob *) aArg;
+  job->mError = job->mRun(job);
+  return (void *) 0;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// _ctmRunJobs() - Run a set of jobs, each on its own thread if aParallel is
+// set, and wait for all of them. The first job runs on the calling thread,
+// as does any job a thread can't be started for. Returns the first error.
+//-----------------------------------------------------------------------------
+static CTMenum _ctmRunJobs(_CTMjob * aJobs, CTMuint aCount, CTMint aParallel)
+{
+  CTMuint i;
+  CTMenum error = CTM_NONE;
+
+  for(i = 1; i < aCount; ++ i)
+  {
+    _CTMjob * job = &aJobs[i];
+#if defined(_WIN32)
+    job->mThread = aParallel ? CreateThread(NULL, 0, _ctmJobThread, job, 0, NULL) : NULL;
+    if(!job->mThread)
+      job->mError = job->mRun(job);
+#else
+    job->mStarted = aParallel && (pthread_create(&job->mThread, NULL, _ctmJobThread, job) == 0);
+    if(!job->mStarted)
+      job->mError = job->mRun(job);
+#endif
+  }
+  if(aCount > 0)
+    aJobs[0].mError = aJobs[0].mRun(&aJobs[0]);
+
+  for(i = 0; i < aCount; ++ i)
+  {
+#if defined(_WIN32)
+    if((i > 0) && aJobs[i].mThread)
+    {
+      WaitForSingleObject(aJobs[i].mThread, INFINITE);
+      CloseHandle(aJobs[i].mThread);
+    }
+#else
+    if((i > 0) && aJobs[i].mStarted)
+      pthread_join(aJobs[i].mThread, NULL);
+#endif
+    if((error == CTM_NONE) && (aJobs[i].mError != CTM_NONE))
+      error = aJobs[i].mError;
+  }
+
+  return error;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmVerticesJob() - Unpack the vertices and their grid indices, and restore
+// the vertices.
+//-----------------------------------------------------------------------------
+static CTMenum _ctmVerticesJob(_CTMjob * aJob)
+{
+  _CTMcontext * self = aJob->mContext;
+  CTMuint * gridIndices, i;
+  CTMint * intVertices;
+  CTMenum error;
+
+  intVertices = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 3);
+  gridIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mVertexCount);
+  if(!intVertices || !gridIndices)
+    error = CTM_OUT_OF_MEMORY;
+  else
+    error = _ctmUnpackInts(aJob->mScratch[0], intVertices, self->mVertexCount, 3, CTM_FALSE);
+  if(error == CTM_NONE)
+    error = _ctmUnpackInts(aJob->mScratch[1], (CTMint *) gridIndices, self->mVertexCount, 1, CTM_FALSE);
+
+  if(error == CTM_NONE)
+  {
+    // Restore grid indices (deltas)
+    for(i = 1; i < self->mVertexCount; ++ i)
+      gridIndices[i] += gridIndices[i - 1];
+
+    // Restore vertices
+    _ctmRestoreVertices(self, intVertices, gridIndices, aJob->mGrid, self->mVertices);
+  }
+
+  // Free temporary resources
+  free((void *) gridIndices);
+  free((void *) intVertices);
+
+  return error;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmIndicesJob() - Unpack and restore the triangle indices.
+//-----------------------------------------------------------------------------
+static CTMenum _ctmIndicesJob(_CTMjob * aJob)
+{
+  _CTMcontext * self = aJob->mContext;
+  CTMuint i;
+  CTMenum error;
+
+  error = _ctmUnpackInts(aJob->mScratch[0], (CTMint *) self->mIndices, self->mTriangleCount, 3, CTM_FALSE);
+  if(error != CTM_NONE)
+    return error;
+
+  // Restore indices
+  _ctmRestoreIndices(self, self->mIndices);
+
+  // Check that all indices are within range
+  for(i = 0; i < (self->mTriangleCount * 3); ++ i)
+  {
+    if(self->mIndices[i] >= self->mVertexCount)
+      return CTM_INVALID_MESH;
+  }
+
+  return CTM_NONE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmUnpackNormalsJob() - Unpack the normals. Restoring them has to wait
+// for the vertices and indices.
+//-----------------------------------------------------------------------------
+static CTMenum _ctmUnpackNormalsJob(_CTMjob * aJob)
+{
+  return _ctmUnpackInts(aJob->mScratch[0], aJob->mIntData, aJob->mContext->mVertexCount, 3, CTM_FALSE);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmRestoreNormalsJob() - Restore a range of the normals.
+//-----------------------------------------------------------------------------
+static CTMenum _ctmRestoreNormalsJob(_CTMjob * aJob)
+{
+  _ctmRestoreNormals(aJob->mContext, aJob->mIntData, aJob->mSmoothNormals, aJob->mFirst, aJob->mLast);
+  return CTM_NONE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmUVCoordsJob() - Unpack and restore a UV map.
+//-----------------------------------------------------------------------------
+static CTMenum _ctmUVCoordsJob(_CTMjob * aJob)
+{
+  _CTMcontext * self = aJob->mContext;
+  CTMint * intUVCoords;
+  CTMenum error;
+
+  intUVCoords = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 2);
+  if(!intUVCoords)
+    return CTM_OUT_OF_MEMORY;
+  error = _ctmUnpackInts(aJob->mScratch[0], intUVCoords, self->mVertexCount, 2, CTM_TRUE);
+  if(error == CTM_NONE)
+    _ctmRestoreUVCoords(self, aJob->mMap, intUVCoords);
+  free((void *) intUVCoords);
+  return error;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmAttribsJob() - Unpack and restore a vertex attribute map.
+//-----------------------------------------------------------------------------
+static CTMenum _ctmAttribsJob(_CTMjob * aJob)
+{
+  _CTMcontext * self = aJob->mContext;
+  CTMint * intAttribs;
+  CTMenum error;
+
+  intAttribs = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 4);
+  if(!intAttribs)
+    return CTM_OUT_OF_MEMORY;
+  error = _ctmUnpackInts(aJob->mScratch[0], intAttribs, self->mVertexCount, 4, CTM_TRUE);
+  if(error == CTM_NONE)
+    _ctmRestoreAttribs(self, aJob->mMap, intAttribs);
+  free((void *) intAttribs);
+  return error;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmReadPackedJob() - Add a job for a packed array, reading the array from
+// the stream into a new scratch buffer.
+//-----------------------------------------------------------------------------
+static int _ctmReadPackedJob(_CTMcontext * self, _CTMjob * aJob,
+  CTMenum (*aRun)(_CTMjob *), CTMuint aScratchIndex)
+{
+  aJob->mRun = aRun;
+  aJob->mContext = self;
+  aJob->mScratch[aScratchIndex] = _ctmScratchAcquire();
+  if(!aJob->mScratch[aScratchIndex])
+  {
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+  return _ctmStreamReadPacked(self, aJob->mScratch[aScratchIndex]);
+}
+
 //-----------------------------------------------------------------------------
 // _ctmUncompressMesh_MG2() - Uncmpress the mesh from the input stream in the
 // CTM context, and store the resulting mesh in the CTM context.
 //-----------------------------------------------------------------------------
 int _ctmUncompressMesh_MG2(_CTMcontext * self)
 {
-  CTMuint * gridIndices, i;
-  CTMint * intVertices, * intNormals, * intUVCoords, * intAttribs;
+  CTMuint i, jobCount, threadCount;
+  CTMint * intNormals = (CTMint *) 0;
+  CTMfloat * smoothNormals = (CTMfloat *) 0;
+  CTMint parallel, result = CTM_FALSE;
+  CTMenum error;
+  _CTMjob * jobs, * normalsJob = (_CTMjob *) 0;
   _CTMfloatmap * map;
   _CTMgrid grid;
 
@@ -1132,77 +1510,46 @@ int _ctmUncompressMesh_MG2(_CTMcontext * self)
   for(i = 0; i < 3; ++ i)
     grid.mSize[i] = (grid.mMax[i] - grid.mMin[i]) / grid.mDivision[i];
 
-  // Read vertices
-  if(_ctmStreamReadUINT(self) != FOURCC("VERT"))
-  {
-    self->mError = CTM_BAD_FORMAT;
-    return CTM_FALSE;
-  }
-  intVertices = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 3);
-  if(!intVertices)
+  // One job for the vertices, the indices, the normals and each map. The
+  // normals may need as many jobs again to restore them.
+  threadCount = _ctmProcessorCount();
+  jobCount = 3 + self->mUVMapCount + self->mAttribMapCount;
+  jobs = (_CTMjob *) calloc(jobCount > threadCount ? jobCount : threadCount, sizeof(_CTMjob));
+  if(!jobs)
   {
     self->mError = CTM_OUT_OF_MEMORY;
     return CTM_FALSE;
   }
-  if(!_ctmStreamReadPackedInts(self, intVertices, self->mVertexCount, 3, CTM_FALSE))
+  jobCount = 0;
+
+  // The stream can only be read in order, so every packed array is read
+  // before any of them are unpacked
+  if(_ctmStreamReadUINT(self) != FOURCC("VERT"))
   {
-    free((void *) intVertices);
-    return CTM_FALSE;
+    self->mError = CTM_BAD_FORMAT;
+    goto cleanup;
   }
+  if(!_ctmReadPackedJob(self, &jobs[jobCount ++], _ctmVerticesJob, 0))
+    goto cleanup;
+  jobs[jobCount - 1].mGrid = &grid;
 
   // Read grid indices
   if(_ctmStreamReadUINT(self) != FOURCC("GIDX"))
   {
-    free((void *) intVertices);
     self->mError = CTM_BAD_FORMAT;
-    return CTM_FALSE;
+    goto cleanup;
   }
-  gridIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mVertexCount);
-  if(!gridIndices)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    free((void *) intVertices);
-    return CTM_FALSE;
-  }
-  if(!_ctmStreamReadPackedInts(self, (CTMint *) gridIndices, self->mVertexCount, 1, CTM_FALSE))
-  {
-    free((void *) gridIndices);
-    free((void *) intVertices);
-    return CTM_FALSE;
-  }
-
-  // Restore grid indices (deltas)
-  for(i = 1; i < self->mVertexCount; ++ i)
-    gridIndices[i] += gridIndices[i - 1];
-
-  // Restore vertices
-  _ctmRestoreVertices(self, intVertices, gridIndices, &grid, self->mVertices);
-
-  // Free temporary resources
-  free((void *) gridIndices);
-  free((void *) intVertices);
+  if(!_ctmReadPackedJob(self, &jobs[jobCount - 1], _ctmVerticesJob, 1))
+    goto cleanup;
 
   // Read triangle indices
   if(_ctmStreamReadUINT(self) != FOURCC("INDX"))
   {
     self->mError = CTM_BAD_FORMAT;
-    return CTM_FALSE;
-  }
-  if(!_ctmStreamReadPackedInts(self, (CTMint *) self->mIndices, self->mTriangleCount, 3, CTM_FALSE))
-    return CTM_FALSE;
-
-  // Restore indices
-  _ctmRestoreIndices(self, self->mIndices);
-
-  // Check that all indices are within range
-  for(i = 0; i < (self->mTriangleCount * 3); ++ i)
-  {
-    if(self->mIndices[i] >= self->mVertexCount)
-    {
-      self->mError = CTM_INVALID_MESH;
-      return CTM_FALSE;
-    }
+    goto cleanup;
   }
+  if(!_ctmReadPackedJob(self, &jobs[jobCount ++], _ctmIndicesJob, 0))
+    goto cleanup;
 
   // Read normals
   if(self->mNormals)
@@ -1211,46 +1558,27 @@ int _ctmUncompressMesh_MG2(_CTMcontext * self)
     if(!intNormals)
     {
       self->mError = CTM_OUT_OF_MEMORY;
-      return CTM_FALSE;
+      goto cleanup;
     }
     if(_ctmStreamReadUINT(self) != FOURCC("NORM"))
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intNormals);
-      return CTM_FALSE;
-    }
-    if(!_ctmStreamReadPackedInts(self, intNormals, self->mVertexCount, 3, CTM_FALSE))
-    {
-      free((void *) intNormals);
-      return CTM_FALSE;
+      goto cleanup;
     }
-
-    // Restore normals
-    if(!_ctmRestoreNormals(self, intNormals))
-    {
-      free((void *) intNormals);
-      return CTM_FALSE;
-    }
-
-    // Free temporary normals data
-    free((void *) intNormals);
+    normalsJob = &jobs[jobCount ++];
+    normalsJob->mIntData = intNormals;
+    if(!_ctmReadPackedJob(self, normalsJob, _ctmUnpackNormalsJob, 0))
+      goto cleanup;
   }
 
   // Read UV maps
   map = self->mUVMaps;
   while(map)
   {
-    intUVCoords = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 2);
-    if(!intUVCoords)
-    {
-      self->mError = CTM_OUT_OF_MEMORY;
-      return CTM_FALSE;
-    }
     if(_ctmStreamReadUINT(self) != FOURCC("TEXC"))
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intUVCoords);
-      return CTM_FALSE;
+      goto cleanup;
     }
     _ctmStreamReadSTRING(self, &map->mName);
     _ctmStreamReadSTRING(self, &map->mFileName);
@@ -1258,20 +1586,11 @@ int _ctmUncompressMesh_MG2(_CTMcontext * self)
     if(map->mPrecision <= 0.0f)
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intUVCoords);
-      return CTM_FALSE;
-    }
-    if(!_ctmStreamReadPackedInts(self, intUVCoords, self->mVertexCount, 2, CTM_TRUE))
-    {
-      free((void *) intUVCoords);
-      return CTM_FALSE;
+      goto cleanup;
     }
-
-    // Restore UV coordinates
-    _ctmRestoreUVCoords(self, map, intUVCoords);
-
-    // Free temporary UV coordinate data
-    free((void *) intUVCoords);
+    jobs[jobCount].mMap = map;
+    if(!_ctmReadPackedJob(self, &jobs[jobCount ++], _ctmUVCoordsJob, 0))
+      goto cleanup;
 
     map = map->mNext;
   }
@@ -1280,40 +1599,74 @@ int _ctmUncompressMesh_MG2(_CTMcontext * self)
   map = self->mAttribMaps;
   while(map)
   {
-    intAttribs = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 4);
-    if(!intAttribs)
-    {
-      self->mError = CTM_OUT_OF_MEMORY;
-      return CTM_FALSE;
-    }
     if(_ctmStreamReadUINT(self) != FOURCC("ATTR"))
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intAttribs);
-      return CTM_FALSE;
+      goto cleanup;
     }
     _ctmStreamReadSTRING(self, &map->mName);
     map->mPrecision = _ctmStreamReadFLOAT(self);
     if(map->mPrecision <= 0.0f)
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intAttribs);
-      return CTM_FALSE;
+      goto cleanup;
     }
-    if(!_ctmStreamReadPackedInts(self, intAttribs, self->mVertexCount, 4, CTM_TRUE))
+    jobs[jobCount].mMap = map;
+    if(!_ctmReadPackedJob(self, &jobs[jobCount ++], _ctmAttribsJob, 0))
+      goto cleanup;
+
+    map = map->mNext;
+  }
+
+  // Unpack and restore everything
+  parallel = (threadCount > 1) && (self->mVertexCount >= _CTM_PARALLEL_VERTEX_COUNT);
+  error = _ctmRunJobs(jobs, jobCount, parallel);
+  if(error != CTM_NONE)
+  {
+    self->mError = error;
+    goto cleanup;
+  }
+
+  // Restore normals, now that the smooth (nominal) normals they are relative
+  // to can be calculated
+  if(normalsJob)
+  {
+    smoothNormals = (CTMfloat *) malloc(3 * sizeof(CTMfloat) * self->mVertexCount);
+    if(!smoothNormals)
     {
-      free((void *) intAttribs);
-      return CTM_FALSE;
+      self->mError = CTM_OUT_OF_MEMORY;
+      goto cleanup;
     }
+    _ctmCalcSmoothNormals(self, self->mVertices, self->mIndices, smoothNormals);
 
-    // Restore vertex attributes
-    _ctmRestoreAttribs(self, map, intAttribs);
+    // Split evenly across the processors
+    if(!parallel)
+      threadCount = 1;
+    for(i = 0; i < threadCount; ++ i)
+    {
+      jobs[i].mRun = _ctmRestoreNormalsJob;
+      jobs[i].mContext = self;
+      jobs[i].mIntData = intNormals;
+      jobs[i].mSmoothNormals = smoothNormals;
+      jobs[i].mFirst = (CTMuint) (((size_t) self->mVertexCount * i) / threadCount);
+      jobs[i].mLast = (CTMuint) (((size_t) self->mVertexCount * (i + 1)) / threadCount);
+    }
+    _ctmRunJobs(jobs, threadCount, parallel);
+  }
 
-    // Free temporary vertex attribute data
-    free((void *) intAttribs);
+  result = CTM_TRUE;
 
-    map = map->mNext;
+cleanup:
+  // Free temporary resources. Restoring the normals reused the first jobs,
+  // but left their scratch buffers alone.
+  for(i = 0; i < jobCount; ++ i)
+  {
+    _ctmScratchRelease(jobs[i].mScratch[0]);
+    _ctmScratchRelease(jobs[i].mScratch[1]);
   }
+  free((void *) jobs);
+  free((void *) smoothNormals);
+  free((void *) intNormals);
 
-  return CTM_TRUE;
+  return result;
 }
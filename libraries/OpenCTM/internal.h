@@ -28,6 +28,16 @@
 #ifndef __OPENCTM_INTERNAL_H_
 #define __OPENCTM_INTERNAL_H_
 
+#include <stddef.h>
+#include <Types.h>
+
+// SSE2 versions of the hot loops, where the compiler targets it (always the
+// case on x86-64)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _CTM_SSE2 1
+#include <emmintrin.h>
+#endif
+
 //-----------------------------------------------------------------------------
 // Constants
 //-----------------------------------------------------------------------------
@@ -104,6 +114,29 @@ typedef struct {
   void * mUserData;
 } _CTMcontext;
 
+//-----------------------------------------------------------------------------
+// _CTMscratch - Working memory for unpacking one packed data array. See
+// _ctmScratchAcquire() in stream.c.
+//-----------------------------------------------------------------------------
+typedef struct {
+  // LZMA allocator for the probability model (must be the first member)
+  ISzAlloc mAlloc;
+
+  // Packed data, as read from the stream
+  unsigned char * mPacked;
+  size_t mPackedSize;
+  size_t mPackedCapacity;
+  unsigned char mProps[5];
+
+  // Unpacked (interleaved) data
+  unsigned char * mUnpacked;
+  size_t mUnpackedCapacity;
+
+  // LZMA probability model
+  void * mProbs;
+  size_t mProbsCapacity;
+} _CTMscratch;
+
 //-----------------------------------------------------------------------------
 // Macros
 //-----------------------------------------------------------------------------
@@ -122,6 +155,10 @@ void _ctmStreamWriteFLOAT(_CTMcontext * self, CTMfloat aValue);
 void _ctmStreamReadSTRING(_CTMcontext * self, char ** aValue);
 void _ctmStreamWriteSTRING(_CTMcontext * self, const char * aValue);
 int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData, CTMuint aCount, CTMuint aSize, CTMint aSignedInts);
+_CTMscratch * _ctmScratchAcquire(void);
+void _ctmScratchRelease(_CTMscratch * aScratch);
+int _ctmStreamReadPacked(_CTMcontext * self, _CTMscratch * aScratch);
+CTMenum _ctmUnpackInts(_CTMscratch * aScratch, CTMint * aData, CTMuint aCount, CTMuint aSize, CTMint aSignedInts);
 int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData, CTMuint aCount, CTMuint aSize, CTMint aSignedInts);
 int _ctmStreamReadPackedFloats(_CTMcontext * self, CTMfloat * aData, CTMuint aCount, CTMuint aSize);
 int _ctmStreamWritePackedFloats(_CTMcontext * self, CTMfloat * aData, CTMuint aCount, CTMuint aSize);
@@ -1,6 +1,16 @@
 #include "openctmpp.h"
+#include <cstring>
 
 CTMuint CTMimporter::StreamLoaderFn(void * aBuf, CTMuint aCount, void * aUserData) {
     std::istream & instream = *(std::istream *) aUserData;
     return (CTMuint)instream.readsome((char*) aBuf, aCount);
 }
+
+CTMuint CTMimporter::MemoryLoaderFn(void * aBuf, CTMuint aCount, void * aUserData) {
+    MemoryReader & reader = *(MemoryReader *) aUserData;
+    size_t remaining = reader.mSize - reader.mPosition;
+    size_t count = aCount < remaining ? aCount : remaining;
+    memcpy(aBuf, reader.mData + reader.mPosition, count);
+    reader.mPosition += count;
+    return (CTMuint)count;
+}
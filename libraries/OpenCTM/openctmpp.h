@@ -103,6 +103,15 @@ class CTMimporter {
 
     static CTMuint CTMCALL StreamLoaderFn(void * aBuf, CTMuint aCount, void * aUserData);
 
+    /// Read cursor over a caller owned block of memory
+    struct MemoryReader {
+      const char * mData;
+      size_t mSize;
+      size_t mPosition;
+    };
+
+    static CTMuint CTMCALL MemoryLoaderFn(void * aBuf, CTMuint aCount, void * aUserData);
+
   public:
     /// Constructor
     CTMimporter()
@@ -225,6 +234,14 @@ class CTMimporter {
         LoadCustom(StreamLoaderFn, &stream);
     }
 
+    /// Wrapper for ctmLoadCustom() that reads directly from memory, without
+    /// copying the data
+    void LoadMemory(const void * aData, size_t aSize)
+    {
+        MemoryReader reader = { (const char *) aData, aSize, 0 };
+        LoadCustom(MemoryLoaderFn, &reader);
+    }
+
     // You can not copy nor assign from one CTMimporter object to another, since
     // the object contains hidden state. By declaring these dummy prototypes
     // without an implementation, you will at least get linker errors if you try
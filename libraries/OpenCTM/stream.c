@@ -28,9 +28,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <LzmaLib.h>
+#include <LzmaDec.h>
 #include "openctm.h"
 #include "internal.h"
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #ifdef __DEBUG_
 #include <stdio.h>
 #endif
@@ -168,80 +175,275 @@ void _ctmStreamWriteSTRING(_CTMcontext * self, const char * aValue)
 }
 
 //-----------------------------------------------------------------------------
-// _ctmStreamReadPackedInts() - Read an compressed binary integer data array
-// from a stream, and uncompress it.
+// Scratch buffers. Unpacking a stream needs room for the packed data, the
+// unpacked (interleaved) data and the LZMA probability model. Rather than
+// allocate all of that again for every stream of every file, released
+// scratch buffers are kept in a small pool, unless they have grown too big
+// to be worth holding on to.
 //-----------------------------------------------------------------------------
-int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
-  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+#define _CTM_SCRATCH_POOL_SIZE 8
+#define _CTM_SCRATCH_KEEP_LIMIT (16 * 1024 * 1024)
+
+static _CTMscratch * _ctmScratchPool[_CTM_SCRATCH_POOL_SIZE];
+static CTMuint _ctmScratchPoolCount = 0;
+
+#if defined(_WIN32)
+static SRWLOCK _ctmScratchLock = SRWLOCK_INIT;
+#define _CTM_SCRATCH_LOCK() AcquireSRWLockExclusive(&_ctmScratchLock)
+#define _CTM_SCRATCH_UNLOCK() ReleaseSRWLockExclusive(&_ctmScratchLock)
+#else
+static pthread_mutex_t _ctmScratchLock = PTHREAD_MUTEX_INITIALIZER;
+#define _CTM_SCRATCH_LOCK() pthread_mutex_lock(&_ctmScratchLock)
+#define _CTM_SCRATCH_UNLOCK() pthread_mutex_unlock(&_ctmScratchLock)
+#endif
+
+//-----------------------------------------------------------------------------
+// _ctmGrowBuffer() - Make sure that a scratch buffer can hold aSize bytes.
+// The old contents are not kept.
+//-----------------------------------------------------------------------------
+static void * _ctmGrowBuffer(void ** aBuffer, size_t * aCapacity, size_t aSize)
 {
-  size_t packedSize, unpackedSize;
-  CTMuint i, k, x;
-  CTMint value;
-  unsigned char * packed, * tmp;
-  unsigned char props[5];
-  int lzmaRes;
+  if(*aCapacity < aSize)
+  {
+    free(*aBuffer);
+    *aBuffer = malloc(aSize);
+    *aCapacity = *aBuffer ? aSize : 0;
+  }
+  return *aBuffer;
+}
 
-  // Read packed data size from the stream
-  packedSize = (size_t) _ctmStreamReadUINT(self);
+//-----------------------------------------------------------------------------
+// _ctmScratchAlloc() - LZMA allocator that hands out the probability buffer
+// of a scratch buffer. The buffer belongs to the scratch, so freeing it is a
+// no-op.
+//-----------------------------------------------------------------------------
+static void * _ctmScratchAlloc(void * p, size_t aSize)
+{
+  _CTMscratch * scratch = (_CTMscratch *) p;
+  return _ctmGrowBuffer(&scratch->mProbs, &scratch->mProbsCapacity, aSize);
+}
 
-  // Read LZMA compression props from the stream
-  _ctmStreamRead(self, (void *) props, 5);
+static void _ctmScratchFree(void * p, void * aAddress)
+{
+  (void) p;
+  (void) aAddress;
+}
 
-  // Allocate memory and read the packed data from the stream
-  packed = (unsigned char *) malloc(packedSize);
-  if(!packed)
+//-----------------------------------------------------------------------------
+// _ctmScratchFreeBuffers() - Free all the memory held by a scratch buffer.
+//-----------------------------------------------------------------------------
+static void _ctmScratchFreeBuffers(_CTMscratch * aScratch)
+{
+  free(aScratch->mPacked);
+  free(aScratch->mUnpacked);
+  free(aScratch->mProbs);
+  free(aScratch);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmScratchAcquire() - Get a scratch buffer, from the pool if there is
+// one there.
+//-----------------------------------------------------------------------------
+_CTMscratch * _ctmScratchAcquire(void)
+{
+  _CTMscratch * scratch = (_CTMscratch *) 0;
+
+  _CTM_SCRATCH_LOCK();
+  if(_ctmScratchPoolCount > 0)
+    scratch = _ctmScratchPool[-- _ctmScratchPoolCount];
+  _CTM_SCRATCH_UNLOCK();
+
+  if(!scratch)
   {
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
+    scratch = (_CTMscratch *) calloc(1, sizeof(_CTMscratch));
+    if(scratch)
+    {
+      // The allocator functions must come first, LZMA passes them back
+      scratch->mAlloc.Alloc = _ctmScratchAlloc;
+      scratch->mAlloc.Free = _ctmScratchFree;
+    }
   }
-  _ctmStreamRead(self, (void *) packed, packedSize);
+  return scratch;
+}
 
-  // Allocate memory for interleaved array
-  tmp = (unsigned char *) malloc(aCount * aSize * 4);
-  if(!tmp)
+//-----------------------------------------------------------------------------
+// _ctmScratchRelease() - Return a scratch buffer to the pool, or free it if
+// the pool is full or the buffer is too big to keep.
+//-----------------------------------------------------------------------------
+void _ctmScratchRelease(_CTMscratch * aScratch)
+{
+  if(!aScratch)
+    return;
+
+  if(aScratch->mPackedCapacity + aScratch->mUnpackedCapacity +
+     aScratch->mProbsCapacity <= _CTM_SCRATCH_KEEP_LIMIT)
   {
-    free(packed);
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
+    _CTM_SCRATCH_LOCK();
+    if(_ctmScratchPoolCount < _CTM_SCRATCH_POOL_SIZE)
+    {
+      _ctmScratchPool[_ctmScratchPoolCount ++] = aScratch;
+      aScratch = (_CTMscratch *) 0;
+    }
+    _CTM_SCRATCH_UNLOCK();
   }
 
-  // Uncompress
-  unpackedSize = aCount * aSize * 4;
-  lzmaRes = LzmaUncompress(tmp, &unpackedSize, packed,
-                           &packedSize, props, 5);
+  if(aScratch)
+    _ctmScratchFreeBuffers(aScratch);
+}
 
-  // Free the packed array
-  free(packed);
+//-----------------------------------------------------------------------------
+// _ctmStreamReadPacked() - Read a packed data array from a stream into a
+// scratch buffer, without unpacking it.
+//-----------------------------------------------------------------------------
+int _ctmStreamReadPacked(_CTMcontext * self, _CTMscratch * aScratch)
+{
+  // Read packed data size from the stream
+  aScratch->mPackedSize = (size_t) _ctmStreamReadUINT(self);
 
-  // Error?
-  if((lzmaRes != SZ_OK) || (unpackedSize != aCount * aSize * 4))
+  // Read LZMA compression props from the stream
+  _ctmStreamRead(self, (void *) aScratch->mProps, 5);
+
+  // Read the packed data from the stream
+  if(!_ctmGrowBuffer((void **) &aScratch->mPacked, &aScratch->mPackedCapacity,
+                     aScratch->mPackedSize))
   {
-    self->mError = CTM_LZMA_ERROR;
-    free(tmp);
+    self->mError = CTM_OUT_OF_MEMORY;
     return CTM_FALSE;
   }
+  _ctmStreamRead(self, (void *) aScratch->mPacked, aScratch->mPackedSize);
 
-  // Convert interleaved array to integers
-  for(i = 0; i < aCount; ++ i)
+  return CTM_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmUnpackInts() - Uncompress a packed integer data array that has been
+// read into a scratch buffer. Only the scratch buffer and the output array
+// are touched, so separate arrays can be unpacked on separate threads.
+// Returns CTM_NONE or an error code.
+//-----------------------------------------------------------------------------
+CTMenum _ctmUnpackInts(_CTMscratch * aScratch, CTMint * aData,
+  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  size_t packedSize, unpackedSize;
+  CTMuint i, k;
+  CTMint value, * out;
+  CTMuint x;
+  const unsigned char * tmp, * p0, * p1, * p2, * p3;
+  ELzmaStatus status;
+  int lzmaRes;
+
+  // Uncompress
+  unpackedSize = (size_t) aCount * aSize * 4;
+  if(!_ctmGrowBuffer((void **) &aScratch->mUnpacked,
+                     &aScratch->mUnpackedCapacity, unpackedSize))
+    return CTM_OUT_OF_MEMORY;
+  packedSize = aScratch->mPackedSize;
+  lzmaRes = LzmaDecode(aScratch->mUnpacked, &unpackedSize, aScratch->mPacked,
+                       &packedSize, aScratch->mProps, 5, LZMA_FINISH_ANY,
+                       &status, &aScratch->mAlloc);
+
+  // Error?
+  if((lzmaRes != SZ_OK) || (unpackedSize != (size_t) aCount * aSize * 4))
+    return CTM_LZMA_ERROR;
+
+  // Convert interleaved array to integers. Each element is split into four
+  // planes of bytes, most significant first.
+  tmp = aScratch->mUnpacked;
+  for(k = 0; k < aSize; ++ k)
   {
-    for(k = 0; k < aSize; ++ k)
+    p0 = tmp + k * aCount;
+    p1 = p0 + aCount * aSize;
+    p2 = p1 + aCount * aSize;
+    p3 = p2 + aCount * aSize;
+    out = aData + k;
+    i = 0;
+#if defined(_CTM_SSE2)
+    {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i one = _mm_set1_epi32(1);
+      __m128i low, high, values[4];
+      CTMuint j, n;
+      CTMint lanes[16];
+      for(; i + 16 <= aCount; i += 16)
+      {
+        low = _mm_unpacklo_epi8(_mm_loadu_si128((const __m128i *) (p3 + i)),
+                                _mm_loadu_si128((const __m128i *) (p2 + i)));
+        high = _mm_unpacklo_epi8(_mm_loadu_si128((const __m128i *) (p1 + i)),
+                                 _mm_loadu_si128((const __m128i *) (p0 + i)));
+        values[0] = _mm_unpacklo_epi16(low, high);
+        values[1] = _mm_unpackhi_epi16(low, high);
+        low = _mm_unpackhi_epi8(_mm_loadu_si128((const __m128i *) (p3 + i)),
+                                _mm_loadu_si128((const __m128i *) (p2 + i)));
+        high = _mm_unpackhi_epi8(_mm_loadu_si128((const __m128i *) (p1 + i)),
+                                 _mm_loadu_si128((const __m128i *) (p0 + i)));
+        values[2] = _mm_unpacklo_epi16(low, high);
+        values[3] = _mm_unpackhi_epi16(low, high);
+        for(j = 0; j < 4; ++ j)
+        {
+          // Signed magnitude to two's complement: (x >> 1) ^ -(x & 1)
+          if(aSignedInts)
+            values[j] = _mm_xor_si128(_mm_srli_epi32(values[j], 1),
+              _mm_sub_epi32(zero, _mm_and_si128(values[j], one)));
+          if(aSize == 1)
+            _mm_storeu_si128((__m128i *) (out + (i + j * 4)), values[j]);
+          else
+            _mm_storeu_si128((__m128i *) (lanes + j * 4), values[j]);
+        }
+        if(aSize != 1)
+        {
+          for(n = 0; n < 16; ++ n)
+            out[(i + n) * aSize] = lanes[n];
+        }
+      }
+    }
+#endif
+    for(; i < aCount; ++ i)
     {
-      value = (CTMint) tmp[i + k * aCount + 3 * aCount * aSize] |
-              (((CTMint) tmp[i + k * aCount + 2 * aCount * aSize]) << 8) |
-              (((CTMint) tmp[i + k * aCount + aCount * aSize]) << 16) |
-              (((CTMint) tmp[i + k * aCount]) << 24);
+      value = (CTMint) ((CTMuint) p3[i] |
+                        (((CTMuint) p2[i]) << 8) |
+                        (((CTMuint) p1[i]) << 16) |
+                        (((CTMuint) p0[i]) << 24));
       // Convert signed magnitude to two's complement?
       if(aSignedInts)
       {
         x = (CTMuint) value;
         value = (x & 1) ? -(CTMint)((x + 1) >> 1) : (CTMint)(x >> 1);
       }
-      aData[i * aSize + k] = value;
+      out[i * aSize] = value;
     }
   }
 
-  // Free the interleaved array
-  free(tmp);
+  return CTM_NONE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamReadPackedInts() - Read an compressed binary integer data array
+// from a stream, and uncompress it.
+//-----------------------------------------------------------------------------
+int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
+  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  _CTMscratch * scratch;
+  CTMenum error;
+
+  scratch = _ctmScratchAcquire();
+  if(!scratch)
+  {
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+  if(!_ctmStreamReadPacked(self, scratch))
+  {
+    _ctmScratchRelease(scratch);
+    return CTM_FALSE;
+  }
+  error = _ctmUnpackInts(scratch, aData, aCount, aSize, aSignedInts);
+  _ctmScratchRelease(scratch);
+  if(error != CTM_NONE)
+  {
+    self->mError = error;
+    return CTM_FALSE;
+  }
 
   return CTM_TRUE;
 }
@@ -351,73 +553,8 @@ int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData,
 int _ctmStreamReadPackedFloats(_CTMcontext * self, CTMfloat * aData,
   CTMuint aCount, CTMuint aSize)
 {
-  CTMuint i, k;
-  size_t packedSize, unpackedSize;
-  union {
-    CTMfloat f;
-    CTMint i;
-  } value;
-  unsigned char * packed, * tmp;
-  unsigned char props[5];
-  int lzmaRes;
-
-  // Read packed data size from the stream
-  packedSize = (size_t) _ctmStreamReadUINT(self);
-
-  // Read LZMA compression props from the stream
-  _ctmStreamRead(self, (void *) props, 5);
-
-  // Allocate memory and read the packed data from the stream
-  packed = (unsigned char *) malloc(packedSize);
-  if(!packed)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
-  _ctmStreamRead(self, (void *) packed, packedSize);
-
-  // Allocate memory for interleaved array
-  tmp = (unsigned char *) malloc(aCount * aSize * 4);
-  if(!tmp)
-  {
-    free(packed);
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
-
-  // Uncompress
-  unpackedSize = aCount * aSize * 4;
-  lzmaRes = LzmaUncompress(tmp, &unpackedSize, packed,
-                           &packedSize, props, 5);
-
-  // Free the packed array
-  free(packed);
-
-  // Error?
-  if((lzmaRes != SZ_OK) || (unpackedSize != aCount * aSize * 4))
-  {
-    self->mError = CTM_LZMA_ERROR;
-    free(tmp);
-    return CTM_FALSE;
-  }
-
-  // Convert interleaved array to floats
-  for(i = 0; i < aCount; ++ i)
-  {
-    for(k = 0; k < aSize; ++ k)
-    {
-      value.i = (CTMint) tmp[i + k * aCount + 3 * aCount * aSize] |
-                (((CTMint) tmp[i + k * aCount + 2 * aCount * aSize]) << 8) |
-                (((CTMint) tmp[i + k * aCount + aCount * aSize]) << 16) |
-                (((CTMint) tmp[i + k * aCount]) << 24);
-      aData[i * aSize + k] = value.f;
-    }
-  }
-
-  // Free the interleaved array
-  free(tmp);
-
-  return CTM_TRUE;
+  // The bytes of the floats are packed exactly like those of unsigned ints
+  return _ctmStreamReadPackedInts(self, (CTMint *) aData, aCount, aSize, CTM_FALSE);
 }
 
 //-----------------------------------------------------------------------------